@@ -47,7 +47,7 @@
 #define LLPC_INTERFACE_MAJOR_VERSION 45
 
 /// LLPC minor interface version.
-#define LLPC_INTERFACE_MINOR_VERSION 2
+#define LLPC_INTERFACE_MINOR_VERSION 5
 
 #ifndef LLPC_CLIENT_INTERFACE_MAJOR_VERSION
 #if VFX_INSIDE_SPVGEN
@@ -71,6 +71,9 @@
 //* %Version History
 //* | %Version | Change Description                                                                                    |
 //* | -------- | ----------------------------------------------------------------------------------------------------- |
+//* |     45.5 | Add priority to GraphicsPipelineBuildInfo/ComputePipelineBuildInfo                                    |
+//* |     45.4 | Add cancellation to Graphics/ComputePipelineBuildInfo, and Result::ErrorCancelled                     |
+//* |     45.3 | Add tieredCompile to GraphicsPipelineBuildInfo/ComputePipelineBuildInfo                              |
 //* |     45.2 | Add GFX IP plus checker to GfxIpVersion                                                               |
 //* |     45.1 | Add pipelineCacheAccess, stageCacheAccess(es) to GraphicsPipelineBuildOut/ComputePipelineBuildOut     |
 //* |     45.0 | Remove the member 'enableFastLaunch' of NGG state                                                     |
@@ -151,6 +154,8 @@ enum class Result : int {
   ErrorInvalidPointer = -(0x00000005),
   /// The operaton encountered an unknown error
   ErrorUnknown = -(0x00000006),
+  /// The operation was cancelled, or ran past its time limit
+  ErrorCancelled = -(0x00000007),
 };
 
 /// Represents the base data type
@@ -672,6 +677,46 @@ struct ColorTarget {
   VkFormat format;           ///< Color attachment format
 };
 
+/// Prototype of callback used to deliver the fully optimized binary of a tiered pipeline compile. It is called from
+/// a compiler background thread. The pipeline binary is only valid for the duration of the call.
+typedef void(VKAPI_CALL *OptimizedPipelineFunc)(void *pUserData, Result result, const BinaryData *pPipelineBin);
+
+/// Represents the options of a tiered pipeline compile
+///
+/// If pfnOptimizedPipeline is set and the pipeline is not found in the cache, the pipeline is first built quickly
+/// with a minimal optimization set, and a fully optimized rebuild is scheduled in the background. The rebuild is stored
+/// in the cache under the normal key, and delivered through pfnOptimizedPipeline. The cancellation options of the build
+/// only apply to the quick build, not the rebuild. The pipeline build info, and all the data it points to, must stay
+/// valid until pfnOptimizedPipeline has been called.
+struct TieredCompileInfo {
+  OptimizedPipelineFunc pfnOptimizedPipeline; ///< Callback to deliver the fully optimized pipeline binary, or null to
+                                              ///  build a fully optimized pipeline straight away
+  void *pUserData;                            ///< User data passed to pfnOptimizedPipeline
+};
+
+/// Enumerates the priorities of pipeline builds. When several builds run at once, the ones with higher priority are
+/// given compiler contexts first, and the number of low priority builds run at the same time is limited.
+enum class CompilePriority : int {
+  Low = -1,   ///< Background build, such as a precompile that nothing is waiting for yet
+  Normal = 0, ///< Default priority
+  High = 1,   ///< Build that the application is waiting for, such as one needed to draw the next frame
+};
+
+/// Prototype of callback used to poll whether a pipeline build has been cancelled. It is called from the thread doing
+/// the build, and should return quickly.
+typedef bool(VKAPI_CALL *CancelCheckFunc)(void *pUserData);
+
+/// Represents the cancellation options of a pipeline build
+///
+/// The build is abandoned, and returns Result::ErrorCancelled, once timeLimitMs milliseconds have passed since it
+/// started, or once pfnIsCancelled returns true. The check is made between compiler passes and stages, so a build may
+/// run for a little longer than the time limit before it returns.
+struct CancellationInfo {
+  unsigned timeLimitMs;           ///< Time limit of the build in milliseconds, or 0 for no limit
+  CancelCheckFunc pfnIsCancelled; ///< Callback to poll whether the build has been cancelled, or null
+  void *pUserData;                ///< User data passed to pfnIsCancelled
+};
+
 /// Represents info to build a graphics pipeline.
 struct GraphicsPipelineBuildInfo {
   void *pInstance;                ///< Vulkan instance object
@@ -732,9 +777,12 @@ struct GraphicsPipelineBuildInfo {
     ColorTarget target[MaxColorTargets]; ///< Per-MRT color target info
   } cbState;                             ///< Color target state
 
-  NggState nggState;       ///< NGG state used for tuning and debugging
-  PipelineOptions options; ///< Per pipeline tuning/debugging options
-  bool unlinked;           ///< True to build an "unlinked" half-pipeline ELF
+  NggState nggState;               ///< NGG state used for tuning and debugging
+  PipelineOptions options;         ///< Per pipeline tuning/debugging options
+  bool unlinked;                   ///< True to build an "unlinked" half-pipeline ELF
+  TieredCompileInfo tieredCompile; ///< Tiered compile options
+  CancellationInfo cancellation;   ///< Deadline and cancellation token of the build
+  CompilePriority priority;        ///< Priority of the build relative to concurrent builds
 };
 
 /// Represents info to build a compute pipeline.
@@ -751,8 +799,11 @@ struct ComputePipelineBuildInfo {
 #if LLPC_CLIENT_INTERFACE_MAJOR_VERSION >= 41
   ResourceMappingData resourceMapping; ///< Resource mapping graph and static descriptor values
 #endif
-  PipelineOptions options; ///< Per pipeline tuning options
-  bool unlinked;           ///< True to build an "unlinked" half-pipeline ELF
+  PipelineOptions options;         ///< Per pipeline tuning options
+  bool unlinked;                   ///< True to build an "unlinked" half-pipeline ELF
+  TieredCompileInfo tieredCompile; ///< Tiered compile options
+  CancellationInfo cancellation;   ///< Deadline and cancellation token of the build
+  CompilePriority priority;        ///< Priority of the build relative to concurrent builds
 };
 
 // =====================================================================================================================
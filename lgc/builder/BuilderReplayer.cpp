@@ -83,6 +83,41 @@ ModulePass *lgc::createBuilderReplayer(Pipeline *pipeline) {
   return new BuilderReplayer(pipeline);
 }
 
+// =====================================================================================================================
+// Count the recorded Builder calls that BuilderReplayer may expand into a loop: an image operation on a non-uniform
+// descriptor gets a waterfall loop, and so does a subgroup shuffle on a target without ds_bpermute. The optimization
+// pass schedule is picked before the replay, so it adds these to the loops it finds in the IR.
+//
+// @param module : Module with recorded Builder calls
+unsigned lgc::countBuilderReplayerLoops(const Module &module) {
+  unsigned loopCount = 0;
+  for (const Function &func : module) {
+    if (!func.isDeclaration() || !func.getName().startswith(BuilderCallPrefix))
+      continue;
+
+    BuilderRecorder::Opcode opcode = BuilderRecorder::getOpcodeFromName(func.getName());
+    if (opcode >= BuilderRecorder::SubgroupShuffle && opcode <= BuilderRecorder::SubgroupShuffleDown) {
+      loopCount += func.getNumUses();
+      continue;
+    }
+    if (opcode < BuilderRecorder::ImageLoad || opcode > BuilderRecorder::ImageGetLod)
+      continue;
+
+    // The flags are the second argument, after the dimension, except in an image atomic, where the atomic operation
+    // comes first.
+    unsigned flagsArgIndex = opcode == BuilderRecorder::ImageAtomic ? 2 : 1;
+    for (const User *user : func.users()) {
+      const auto *call = dyn_cast<CallInst>(user);
+      if (!call)
+        continue;
+      unsigned flags = cast<ConstantInt>(call->getArgOperand(flagsArgIndex))->getZExtValue();
+      if (flags & (Builder::ImageFlagNonUniformImage | Builder::ImageFlagNonUniformSampler))
+        ++loopCount;
+    }
+  }
+  return loopCount;
+}
+
 // =====================================================================================================================
 // Constructor
 //
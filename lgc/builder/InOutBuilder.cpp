@@ -311,7 +311,7 @@ void InOutBuilder::markGenericInputOutputUsage(bool isOutput, unsigned location,
   if (!isOutput || m_shaderStage != ShaderStageGeometry) {
     bool keepAllLocations = false;
     if (getPipelineState()->isUnlinked()) {
-      if (m_shaderStage == ShaderStageVertex && isOutput)
+      if (m_shaderStage == getPipelineState()->getLastVertexProcessingStage() && isOutput)
         keepAllLocations = true;
       if (m_shaderStage == ShaderStageFragment && !isOutput)
         keepAllLocations = true;
@@ -651,9 +651,9 @@ void ElfLinkerImpl::writePalMetadata() {
   palMetadata->fixUpRegisters();
   // Finalize the PAL metadata, writing pipeline state items into it.
   palMetadata->finalizePipeline();
-  // Write the MsgPack document into a blob.
+  // Write the MsgPack document, with the registers, into a blob.
   std::string blob;
-  palMetadata->getDocument()->writeToBlob(blob);
+  palMetadata->writeToBlob(blob);
   // Write the note header.
   StringRef noteName = Util::Abi::AmdGpuArchName;
   typedef object::Elf_Nhdr_Impl<object::ELF64LE> NoteHeader;
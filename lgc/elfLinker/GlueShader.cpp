@@ -214,17 +214,20 @@ Module *FetchShader::generate() {
   Value *result = ret->getOperand(0);
   BuilderBase builder(ret);
 
-  for (unsigned idx = 0; idx != m_fetches.size(); ++idx) {
-    const auto &fetch = m_fetches[idx];
-    const VertexInputDescription *description = m_fetchDescriptions[idx];
+  // Fetch the vertices, all together so that fetches of adjacent inputs can be coalesced. The types to fetch are
+  // the ones in the return value.
+  SmallVector<VertexFetchInfo, 8> fetches(m_fetches.begin(), m_fetches.end());
+  for (unsigned idx = 0; idx != fetches.size(); ++idx) {
     unsigned structIdx = idx + m_vsEntryRegInfo.sgprCount + m_vsEntryRegInfo.vgprCount;
-    Type *ty = cast<StructType>(result->getType())->getElementType(structIdx);
+    fetches[idx].ty = cast<StructType>(result->getType())->getElementType(structIdx);
+  }
+  SmallVector<Value *, 8> vertices;
+  vertexFetch->fetchVertices(fetches, m_fetchDescriptions, vertices, builder);
 
-    if (description) {
-      // Fetch the vertex.
-      Value *vertex = vertexFetch->fetchVertex(ty, description, fetch.location, fetch.component, builder);
-      result = builder.CreateInsertValue(result, vertex, structIdx);
-    }
+  for (unsigned idx = 0; idx != m_fetches.size(); ++idx) {
+    unsigned structIdx = idx + m_vsEntryRegInfo.sgprCount + m_vsEntryRegInfo.vgprCount;
+    if (vertices[idx])
+      result = builder.CreateInsertValue(result, vertices[idx], structIdx);
   }
   ret->setOperand(0, result);
 
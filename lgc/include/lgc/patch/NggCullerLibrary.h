@@ -0,0 +1,74 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  NggCullerLibrary.h
+ * @brief LLPC header file: contains declaration of class lgc::NggCullerLibrary.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include <memory>
+
+namespace llvm {
+
+class Function;
+class Module;
+
+} // namespace llvm
+
+namespace lgc {
+
+class LgcContext;
+
+// =====================================================================================================================
+// Library of NGG culler functions, shared by all pipeline compiles that use the same LgcContext (and therefore the
+// same GFX IP). Each culler is constructed and simplified once into a library module, and thereafter is cloned into
+// the pipeline module of each NGG compile that needs it, rather than being rebuilt from scratch every time.
+class NggCullerLibrary {
+public:
+  NggCullerLibrary(LgcContext *lgcContext);
+  ~NggCullerLibrary();
+
+  // Get the culler function in the specified pipeline module, cloning it from the library
+  llvm::Function *getCuller(llvm::Module *module, llvm::StringRef name, llvm::StringRef variant,
+                            llvm::function_ref<llvm::Function *(llvm::Module *)> createCuller);
+
+private:
+  NggCullerLibrary() = delete;
+  NggCullerLibrary(const NggCullerLibrary &) = delete;
+  NggCullerLibrary &operator=(const NggCullerLibrary &) = delete;
+
+  llvm::Module *getLibraryModule();
+  void simplifyCuller(llvm::Function *func);
+  llvm::Function *cloneCuller(llvm::Function *libFunc, llvm::Module *module, llvm::StringRef name);
+
+  LgcContext *m_lgcContext;               // LGC context
+  std::unique_ptr<llvm::Module> m_module; // Library module holding the cullers built so far
+};
+
+} // namespace lgc
@@ -32,10 +32,13 @@
 
 #include "lgc/Pipeline.h"
 #include "llvm/Analysis/LoopPass.h"
+#include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CodeGen.h"
 
 namespace llvm {
 
+class Module;
 class PassRegistry;
 
 namespace legacy {
@@ -46,19 +49,23 @@ class PassManager;
 
 void initializeLowerFragColorExportPass(PassRegistry &);
 void initializeLowerVertexFetchPass(PassRegistry &);
+void initializePatchBufferCoalescePass(PassRegistry &);
 void initializePatchBufferOpPass(PassRegistry &);
 void initializePatchCheckShaderCachePass(PassRegistry &);
 void initializePatchCopyShaderPass(PassRegistry &);
+void initializePatchDescriptorHoistPass(PassRegistry &);
 void initializePatchEntryPointMutatePass(PassRegistry &);
 void initializePatchInOutImportExportPass(PassRegistry &);
 void initializePatchLlvmIrInclusionPass(PassRegistry &);
 void initializePatchLoadScalarizerPass(PassRegistry &);
 void initializePatchLoopMetadataPass(PassRegistry &);
+void initializePatchNewPmOptPass(PassRegistry &);
 void initializePatchNullFragShaderPass(PassRegistry &);
 void initializePatchPeepholeOptPass(PassRegistry &);
 void initializePatchPreparePipelineAbiPass(PassRegistry &);
 void initializePatchResourceCollectPass(PassRegistry &);
 void initializePatchSetupTargetFeaturesPass(PassRegistry &);
+void initializePatchWaterfallCoalescePass(PassRegistry &);
 void initializePatchWorkaroundsPass(PassRegistry &);
 void initializePatchReadFirstLanePass(PassRegistry &);
 
@@ -74,43 +81,63 @@ class PatchCheckShaderCache;
 inline static void initializePatchPasses(llvm::PassRegistry &passRegistry) {
   initializeLowerFragColorExportPass(passRegistry);
   initializeLowerVertexFetchPass(passRegistry);
+  initializePatchBufferCoalescePass(passRegistry);
   initializePatchBufferOpPass(passRegistry);
   initializePatchCheckShaderCachePass(passRegistry);
   initializePatchCopyShaderPass(passRegistry);
+  initializePatchDescriptorHoistPass(passRegistry);
   initializePatchEntryPointMutatePass(passRegistry);
   initializePatchInOutImportExportPass(passRegistry);
   initializePatchLlvmIrInclusionPass(passRegistry);
   initializePatchLoadScalarizerPass(passRegistry);
   initializePatchLoopMetadataPass(passRegistry);
+  initializePatchNewPmOptPass(passRegistry);
   initializePatchNullFragShaderPass(passRegistry);
   initializePatchPeepholeOptPass(passRegistry);
   initializePatchPreparePipelineAbiPass(passRegistry);
   initializePatchResourceCollectPass(passRegistry);
   initializePatchSetupTargetFeaturesPass(passRegistry);
+  initializePatchWaterfallCoalescePass(passRegistry);
   initializePatchWorkaroundsPass(passRegistry);
   initializePatchReadFirstLanePass(passRegistry);
 }
 
 llvm::ModulePass *createLowerFragColorExport();
 llvm::ModulePass *createLowerVertexFetch();
+llvm::FunctionPass *createPatchBufferCoalesce();
 llvm::FunctionPass *createPatchBufferOp();
 PatchCheckShaderCache *createPatchCheckShaderCache();
 llvm::ModulePass *createPatchCopyShader();
+llvm::FunctionPass *createPatchDescriptorHoist();
 llvm::ModulePass *createPatchEntryPointMutate();
 llvm::ModulePass *createPatchInOutImportExport();
 llvm::ModulePass *createPatchLlvmIrInclusion();
 llvm::FunctionPass *createPatchLoadScalarizer();
 llvm::LoopPass *createPatchLoopMetadata();
+struct OptimizationSchedule;
+llvm::ModulePass *createPatchNewPmOpt(unsigned part, const OptimizationSchedule &optSchedule);
 llvm::ModulePass *createPatchNullFragShader();
 llvm::FunctionPass *createPatchPeepholeOpt();
 llvm::ModulePass *createPatchPreparePipelineAbi(bool onlySetCallingConvs);
 llvm::ModulePass *createPatchResourceCollect();
 llvm::ModulePass *createPatchSetupTargetFeatures();
+llvm::FunctionPass *createPatchWaterfallCoalesce();
 llvm::ModulePass *createPatchWorkarounds();
 llvm::FunctionPass *createPatchReadFirstLane();
 
 class PipelineState;
 
+// =====================================================================================================================
+// Optimization pass schedule for a pipeline module, picked from features measured on the module before patching.
+struct OptimizationSchedule {
+  unsigned instCount = 0;        // Number of instructions in the module
+  unsigned maxFuncInstCount = 0; // Number of instructions in the largest function
+  unsigned loopCount = 0;        // Number of loops (CFG back edges) in the module
+  bool noLoops = false;          // Module without loops: skip the loop passes
+  bool trivial = false;          // Trivial module: skip the second LICM and AggressiveInstCombine
+  bool huge = false;             // Module with a huge function: cap loop unrolling
+};
+
 // =====================================================================================================================
 // Represents the pass of LLVM patching operations, as the base class.
 class Patch : public llvm::ModulePass {
@@ -121,9 +148,15 @@ public:
   virtual ~Patch() {}
 
   static void addPasses(PipelineState *pipelineState, llvm::legacy::PassManager &passMgr,
-                        llvm::ModulePass *replayerPass, llvm::Timer *patchTimer, llvm::Timer *optTimer,
+                        const OptimizationSchedule &optSchedule, llvm::ModulePass *replayerPass,
+                        llvm::Timer *patchTimer, llvm::Timer *optTimer,
                         Pipeline::CheckShaderCacheFunc checkShaderCacheFunc);
 
+  static OptimizationSchedule getOptimizationSchedule(const llvm::Module &module, unsigned pendingLoopCount = 0);
+
+  static void addOptimizationPasses(llvm::ModulePassManager &passMgr, PipelineState *pipelineState,
+                                    const OptimizationSchedule &optSchedule, unsigned part);
+
   static llvm::GlobalVariable *getLdsVariable(PipelineState *pipelineState, llvm::Module *module);
 
 protected:
@@ -135,7 +168,8 @@ protected:
   llvm::Function *m_entryPoint; // Entry-point
 
 private:
-  static void addOptimizationPasses(llvm::legacy::PassManager &passMgr);
+  static void addOptimizationPasses(llvm::legacy::PassManager &passMgr, llvm::CodeGenOpt::Level optLevel,
+                                    const OptimizationSchedule &optSchedule);
 
   Patch() = delete;
   Patch(const Patch &) = delete;
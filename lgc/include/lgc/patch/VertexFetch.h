@@ -31,10 +31,13 @@
 #pragma once
 
 #include "lgc/Pipeline.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 
 namespace lgc {
 
 class BuilderBase;
+struct VertexFetchInfo;
 
 // =====================================================================================================================
 // Public interface to vertex fetch manager.
@@ -48,6 +51,12 @@ public:
   // Generate code to fetch a vertex value
   virtual llvm::Value *fetchVertex(llvm::Type *inputTy, const VertexInputDescription *description, unsigned location,
                                    unsigned compIdx, BuilderBase &builder) = 0;
+
+  // Generate code to fetch several vertex values, coalescing the fetches of inputs that are adjacent in the same
+  // vertex buffer. Each vertex value is nullptr if its input has no description.
+  virtual void fetchVertices(llvm::ArrayRef<VertexFetchInfo> fetches,
+                             llvm::ArrayRef<const VertexInputDescription *> descriptions,
+                             llvm::SmallVectorImpl<llvm::Value *> &vertices, BuilderBase &builder) = 0;
 };
 
 } // namespace lgc
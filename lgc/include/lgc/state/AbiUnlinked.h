@@ -122,6 +122,7 @@ namespace PipelineMetadataKey {
 
 static const char VertexInputs[] = ".vertexInputs";
 static const char ColorExports[] = ".colorExports";
+static const char ParamInterface[] = ".paramInterface";
 
 } // namespace PipelineMetadataKey
 
@@ -38,7 +38,9 @@
 #include "lgc/CommonDefs.h"
 #include "lgc/Pipeline.h"
 #include "lgc/state/AbiMetadata.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/BinaryFormat/MsgPackDocument.h"
+#include <map>
 
 namespace llvm {
 class Module;
@@ -80,6 +82,15 @@ struct ColorExportInfo {
   llvm::Type *ty;
 };
 
+// =====================================================================================================================
+// Struct with the information for one attribute passed between the two halves of a pipeline, as recorded in the
+// PAL metadata of an unlinked vertex-processing half-pipeline ELF
+struct ParamInterfaceInfo {
+  unsigned location; // Original location of a generic attribute, or BuiltInKind if isBuiltIn
+  bool isBuiltIn;    // Whether this is a built-in mapped to a generic attribute
+  unsigned param;    // Parameter export index
+};
+
 // =====================================================================================================================
 // Class for manipulating PAL metadata through LGC
 class PalMetadata {
@@ -99,7 +110,11 @@ public:
   // Record the PAL metadata into IR metadata in the specified module.
   void record(llvm::Module *module);
 
-  // Get the MsgPack document for explicit manipulation. Only ConfigBuilder* uses this.
+  // Write the PAL metadata, including the registers, as a MsgPack blob.
+  void writeToBlob(std::string &blob);
+
+  // Get the MsgPack document for explicit manipulation of anything other than registers. Only ConfigBuilder* uses
+  // this.
   llvm::msgpack::Document *getDocument() { return m_document; }
 
   // Set the PAL metadata SPI register for one user data entry
@@ -120,6 +135,9 @@ public:
   // Get a register value in PAL metadata.
   unsigned getRegister(unsigned regNum);
 
+  // Check whether a register is set in PAL metadata.
+  bool hasRegister(unsigned regNum) const;
+
   // Set a register value in PAL metadata. If the register is already set, this ORs in the value.
   void setRegister(unsigned regNum, unsigned value);
 
@@ -147,6 +165,12 @@ public:
   // Erase the color export info
   void eraseColorExportInfo();
 
+  // Store the attribute interface of an unlinked half-pipeline in the PAL metadata
+  void addParamInterfaceInfo(llvm::ArrayRef<ParamInterfaceInfo> params);
+
+  // Get the attribute interface of an unlinked half-pipeline out of PAL metadata. Returns false if there is none.
+  bool getParamInterfaceInfo(llvm::SmallVectorImpl<ParamInterfaceInfo> &params);
+
   // Finalize PAL metadata for pipeline.
   // TODO Shader compilation: The idea is that this will be called at the end of a pipeline compilation, or in
   // an ELF link, but not at the end of a shader/half-pipeline compile.
@@ -168,6 +192,25 @@ private:
   // Set userDataLimit to maximum
   void setUserDataLimit();
 
+  // Get the index of a register in the dense register table, or -1 if it is outside the ranges the table holds.
+  static int getRegIndex(unsigned regNum);
+
+  // Set a register value, overwriting any value it already has.
+  void storeRegister(unsigned regNum, unsigned value);
+
+  // Merge the registers in the MsgPack document into the register table, and empty them from the document.
+  void readRegisters(bool isGlueCode);
+
+  // Merge one register value read from MsgPack PAL metadata into the register table.
+  void mergeRegister(unsigned regNum, unsigned value, bool isGlueCode);
+
+  // Write the register table into the MsgPack document.
+  void writeRegisters();
+
+  // The register table covers the SH, context and uconfig register ranges, each this many registers.
+  static constexpr unsigned RegRangeCount = 3;
+  static constexpr unsigned RegRangeSize = 0x400;
+
   PipelineState *m_pipelineState;             // PipelineState
   llvm::msgpack::Document *m_document;        // The MsgPack document
   llvm::msgpack::MapDocNode m_pipelineNode;   // MsgPack map node for amdpal.pipelines[0]
@@ -178,6 +221,13 @@ private:
   unsigned m_userDataRegMapping[ShaderStageCountInternal] = {};
   llvm::msgpack::DocNode *m_userDataLimit;  // Maximum so far number of user data dwords used
   llvm::msgpack::DocNode *m_spillThreshold; // Minimum so far dword offset used in user data spill table
+
+  // The registers are held in this table while LGC works on them, and only written into the MsgPack document when
+  // the PAL metadata is serialized. A register in one of the ranges of the dense table is at getRegIndex in
+  // m_regValues, and is set if that bit of m_regSet is; any other register is in m_otherRegs.
+  unsigned m_regValues[RegRangeCount * RegRangeSize];
+  llvm::BitVector m_regSet;
+  std::map<unsigned, unsigned> m_otherRegs;
 };
 
 } // namespace lgc
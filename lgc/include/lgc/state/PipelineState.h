@@ -33,6 +33,7 @@
 #include "lgc/Pipeline.h"
 #include "lgc/state/Abi.h"
 #include "lgc/state/Defs.h"
+#include "lgc/state/PalMetadata.h"
 #include "lgc/state/ResourceUsage.h"
 #include "lgc/state/ShaderModes.h"
 #include "lgc/state/ShaderStage.h"
@@ -58,8 +59,9 @@ void initializePipelineStateWrapperPass(PassRegistry &);
 namespace lgc {
 
 class ElfLinker;
-class PalMetadata;
 class PipelineState;
+class StateBlobReader;
+class StateBlobWriter;
 class TargetInfo;
 
 llvm::ModulePass *createPipelineStateClearer();
@@ -192,6 +194,15 @@ public:
   // Return the "unlinked" flag, true if generating an unlinked half-pipeline ELF.
   bool isUnlinked() const { return m_unlinked; }
 
+  // Set the attribute interface of the other half-pipeline from its ELF, when compiling an unlinked half-pipeline
+  // against it. Returns false (with an error set) if the ELF does not contain the interface.
+  bool setOtherPartElf(llvm::MemoryBufferRef otherElf);
+
+  // Whether an unlinked half-pipeline is being compiled against the ELF of the other half-pipeline, and if so, the
+  // attribute interface recorded in that ELF.
+  bool hasOtherPartInterface() const { return m_hasOtherPartInterface; }
+  llvm::ArrayRef<ParamInterfaceInfo> getOtherPartInterface() const { return m_otherPartInterface; }
+
   // Clear the pipeline state IR metadata.
   void clear(llvm::Module *module);
 
@@ -382,36 +393,50 @@ private:
   // Read shaderStageMask from IR
   void readShaderStageMask(llvm::Module *module);
 
+  // Pipeline state blob handling
+  void recordState(llvm::Module *module);
+  void readStateBlob(llvm::NamedMDNode *blobMetaNode);
+
   // Options handling
-  void recordOptions(llvm::Module *module);
+  void writeOptions(StateBlobWriter &writer);
+  void readOptions(StateBlobReader &reader);
   void readOptions(llvm::Module *module);
 
   // User data nodes handling
   void setUserDataNodesTable(llvm::ArrayRef<ResourceNode> nodes, ResourceNode *destTable,
                              ResourceNode *&destInnerTable);
-  void recordUserDataNodes(llvm::Module *module);
-  void recordUserDataTable(llvm::ArrayRef<ResourceNode> nodes, llvm::NamedMDNode *userDataMetaNode);
+  void writeUserDataNodes(StateBlobWriter &writer);
+  void writeUserDataTable(llvm::ArrayRef<ResourceNode> nodes, StateBlobWriter &writer);
+  void readUserDataNodes(StateBlobReader &reader);
+  void readUserDataTable(StateBlobReader &reader, llvm::MutableArrayRef<ResourceNode> destTable,
+                         ResourceNode *&destInnerTable, ResourceNode *innerTableLimit);
   void readUserDataNodes(llvm::Module *module);
+  void buildResourceNodeIndex();
   llvm::ArrayRef<llvm::MDString *> getResourceTypeNames();
-  llvm::MDString *getResourceTypeName(ResourceNodeType type);
   ResourceNodeType getResourceTypeFromName(llvm::MDString *typeName);
 
   // Device index handling
-  void recordDeviceIndex(llvm::Module *module);
   void readDeviceIndex(llvm::Module *module);
 
   // Vertex input descriptions handling
-  void recordVertexInputDescriptions(llvm::Module *module);
+  void writeVertexInputDescriptions(StateBlobWriter &writer);
+  void readVertexInputDescriptions(StateBlobReader &reader);
   void readVertexInputDescriptions(llvm::Module *module);
 
   // Color export state handling
-  void recordColorExportState(llvm::Module *module);
+  void writeColorExportState(StateBlobWriter &writer);
+  void readColorExportState(StateBlobReader &reader);
   void readColorExportState(llvm::Module *module);
 
   // Graphics state (iastate, vpstate, rsstate) handling
-  void recordGraphicsState(llvm::Module *module);
+  void writeGraphicsState(StateBlobWriter &writer);
+  void readGraphicsState(StateBlobReader &reader);
   void readGraphicsState(llvm::Module *module);
 
+  // Other half-pipeline attribute interface handling
+  void recordOtherPartInterface(llvm::Module *module);
+  void readOtherPartInterface(llvm::Module *module);
+
   std::string m_lastError;                              // Error to be reported by getLastError()
   bool m_noReplayer = false;                            // True if no BuilderReplayer needed
   bool m_emitLgc = false;                               // Whether -emit-lgc is on
@@ -422,6 +447,13 @@ private:
   std::vector<ShaderOptions> m_shaderOptions;           // Per-shader options
   std::unique_ptr<ResourceNode[]> m_allocUserDataNodes; // Allocated buffer for user data
   llvm::ArrayRef<ResourceNode> m_userDataNodes;         // Top-level user data node table
+  // Index from {set,binding} to the {topNode,node} pairs of the user data nodes with that set and binding, in the
+  // order they appear in the user data node tables. (Not a DenseMap, as the internal descriptor set and any binding
+  // value must be valid keys.)
+  std::map<std::pair<unsigned, unsigned>, llvm::SmallVector<std::pair<const ResourceNode *, const ResourceNode *>, 1>>
+      m_resourceNodeIndex;
+  // Index from descriptor set to the first DescriptorTableVaPtr node for that set
+  std::map<unsigned, const ResourceNode *> m_descTableIndex;
   llvm::MDString *m_resourceNodeTypeNames[unsigned(ResourceNodeType::Count)] = {};
   // Cached MDString for each resource node type
 
@@ -439,6 +471,8 @@ private:
   std::unique_ptr<ResourceUsage> m_resourceUsage[ShaderStageCompute + 1] = {}; // Per-shader ResourceUsage
   std::unique_ptr<InterfaceData> m_interfaceData[ShaderStageCompute + 1] = {}; // Per-shader InterfaceData
   PalMetadata *m_palMetadata = nullptr;                                        // PAL metadata object
+  bool m_hasOtherPartInterface = false; // Whether compiling against the other half-pipeline ELF
+  llvm::SmallVector<ParamInterfaceInfo, 8> m_otherPartInterface; // Attribute interface of other half-pipeline
 };
 
 // =====================================================================================================================
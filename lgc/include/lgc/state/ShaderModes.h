@@ -34,6 +34,9 @@
 
 namespace lgc {
 
+class StateBlobReader;
+class StateBlobWriter;
+
 // =====================================================================================================================
 // Shader modes from input language. The front-end calls Set*Mode methods in Builder, which forward to here.
 // The middle-end gets these modes by calling PipelineState::GetShaderModes then calling a Get*Mode method here.
@@ -88,6 +91,10 @@ public:
   // Read shader modes from IR metadata in a pipeline
   void readModesFromPipeline(llvm::Module *module);
 
+  // Write modes to, and read them from, the pipeline state blob
+  void writeState(StateBlobWriter &writer) const;
+  void readState(StateBlobReader &reader);
+
 private:
   bool m_anySet = false;                                             // Whether any Set*Mode method called
   CommonShaderMode m_commonShaderModes[ShaderStageCompute + 1] = {}; // Per-shader FP modes
@@ -0,0 +1,132 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  StateBlob.h
+ * @brief LLPC header file: contains declaration of classes lgc::StateBlobWriter and lgc::StateBlobReader
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+namespace lgc {
+
+// =====================================================================================================================
+// Writer of the binary blob that pipeline state is recorded in. Each value is written as ULEB128, so the small values
+// that make up most of the state take one byte each. A struct is written as its count of dwords then the dwords, with
+// trailing zero dwords trimmed, so a reader whose version of the struct has more fields reads the new fields as zero.
+class StateBlobWriter {
+public:
+  StateBlobWriter() : m_stream(m_blob) {}
+
+  // Write one value
+  void writeWord(uint64_t value) { llvm::encodeULEB128(value, m_stream); }
+
+  // Write a value of any type that consists of dwords
+  template <typename T> void writeArrayOfInt32(const T &value) {
+    llvm::ArrayRef<unsigned> values(reinterpret_cast<const unsigned *>(&value), sizeof(value) / sizeof(unsigned));
+    while (!values.empty() && values.back() == 0)
+      values = values.drop_back();
+    writeWord(values.size());
+    for (unsigned word : values)
+      writeWord(word);
+  }
+
+  // Get the blob written so far
+  llvm::StringRef getBlob() const { return m_blob; }
+
+private:
+  StateBlobWriter(const StateBlobWriter &) = delete;
+  StateBlobWriter &operator=(const StateBlobWriter &) = delete;
+
+  llvm::SmallString<256> m_blob;      // The blob
+  llvm::raw_svector_ostream m_stream; // Stream writing to m_blob
+};
+
+// =====================================================================================================================
+// Reader of the binary blob written by StateBlobWriter. A read past the end of the blob, or of a malformed value, sets
+// the error flag and returns zero, so the caller can read a whole blob and check for an error once at the end.
+class StateBlobReader {
+public:
+  StateBlobReader(llvm::StringRef blob) : m_pos(blob.bytes_begin()), m_end(blob.bytes_end()) {}
+
+  // Read one value
+  uint64_t readWord() {
+    if (m_error)
+      return 0;
+    unsigned length = 0;
+    const char *error = nullptr;
+    uint64_t value = llvm::decodeULEB128(m_pos, &length, m_end, &error);
+    if (error) {
+      m_error = true;
+      return 0;
+    }
+    m_pos += length;
+    return value;
+  }
+
+  // Read a count of the items that follow. Each item takes at least one byte, so a count greater than the number of
+  // bytes left is an error.
+  unsigned readCount() {
+    uint64_t count = readWord();
+    if (count > static_cast<uint64_t>(m_end - m_pos)) {
+      m_error = true;
+      return 0;
+    }
+    return count;
+  }
+
+  // Read a value of any type that consists of dwords. Dwords not in the blob are set to zero, and dwords in the blob
+  // beyond the size of the type are skipped.
+  template <typename T> void readArrayOfInt32(T &value) {
+    llvm::MutableArrayRef<unsigned> values(reinterpret_cast<unsigned *>(&value), sizeof(value) / sizeof(unsigned));
+    std::fill(values.begin(), values.end(), 0);
+    unsigned count = readCount();
+    for (unsigned index = 0; index != count; ++index) {
+      unsigned word = readWord();
+      if (index < values.size())
+        values[index] = word;
+    }
+  }
+
+  // Set the error flag
+  void setError() { m_error = true; }
+
+  // Check whether any read failed
+  bool hasError() const { return m_error; }
+
+private:
+  const uint8_t *m_pos; // Current read position
+  const uint8_t *m_end; // End of the blob
+  bool m_error = false; // Whether any read failed
+};
+
+} // namespace lgc
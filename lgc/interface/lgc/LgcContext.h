@@ -31,11 +31,14 @@
 #pragma once
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CodeGen.h"
+#include <functional>
 
 namespace llvm {
 
 class LLVMContext;
 class ModulePass;
+class OptPassGate;
 class raw_pwrite_stream;
 class TargetMachine;
 class Timer;
@@ -51,6 +54,9 @@ class PassManager;
 namespace lgc {
 
 class Builder;
+class CancelPassGate;
+class NewPassManager;
+class NggCullerLibrary;
 class PassManager;
 class PassManagerCache;
 class Pipeline;
@@ -89,6 +95,32 @@ public:
   // Get the target machine.
   llvm::TargetMachine *getTargetMachine() const { return m_targetMachine; }
 
+  // Get the optimization level used by the middle-end optimizations and code generation.
+  llvm::CodeGenOpt::Level getOptimizationLevel() const { return m_optLevel; }
+
+  // Set the optimization level used by the middle-end optimizations and code generation of subsequent compiles.
+  // CodeGenOpt::None gives a minimal optimization set, for a quick compile.
+  //
+  // @param level : Optimization level
+  void setOptimizationLevel(llvm::CodeGenOpt::Level level);
+
+  // Get the default optimization level, as set by the -opt option
+  static llvm::CodeGenOpt::Level getDefaultOptimizationLevel();
+
+  // Set the function used to poll whether the current compile has been cancelled, or clear it with an empty function.
+  // While it is set, pass managers created with this LgcContext and populated after this call poll it between passes,
+  // and optional passes are skipped once the compile has been cancelled.
+  //
+  // @param isCancelled : Function returning true if the compile has been cancelled
+  void setCancelCheck(std::function<bool()> isCancelled);
+
+  // Check whether a cancel check is set for the current compile.
+  bool hasCancelCheck() const { return bool(m_isCancelled); }
+
+  // Check whether the current compile has been cancelled. Once this has returned true, it keeps returning true
+  // without polling again until the cancel check is next set.
+  bool isCancelled();
+
   // Get targetinfo
   const TargetInfo &getTargetInfo() const { return *m_targetInfo; }
 
@@ -111,6 +143,12 @@ public:
   // @param [in/out] passMgr : Pass manager
   void preparePassManager(llvm::legacy::PassManager *passMgr);
 
+  // Prepare a new pass manager. This sets a target-aware TLI, so middle-end optimizations do not think that we
+  // have library functions, and makes it skip optional passes once the compile has been cancelled.
+  //
+  // @param [in/out] passMgr : Pass manager
+  void preparePassManager(NewPassManager *passMgr);
+
   // Adds target passes to pass manager, depending on "-filetype" and "-emit-llvm" options
   void addTargetPasses(lgc::PassManager &passMgr, llvm::Timer *codeGenTimer, llvm::raw_pwrite_stream &outStream);
 
@@ -128,6 +166,9 @@ public:
   // Get pass manager cache
   PassManagerCache *getPassManagerCache();
 
+  // Get NGG culler library
+  NggCullerLibrary *getNggCullerLibrary();
+
 private:
   LgcContext() = delete;
   LgcContext(const LgcContext &) = delete;
@@ -135,12 +176,18 @@ private:
 
   LgcContext(llvm::LLVMContext &context, unsigned palAbiVersion);
 
-  static llvm::raw_ostream *m_llpcOuts;           // nullptr or stream for LLPC_OUTS
-  llvm::LLVMContext &m_context;                   // LLVM context
-  llvm::TargetMachine *m_targetMachine = nullptr; // Target machine
-  TargetInfo *m_targetInfo = nullptr;             // Target info
-  unsigned m_palAbiVersion = 0xFFFFFFFF;          // PAL pipeline ABI version to compile for
-  PassManagerCache *m_passManagerCache = nullptr; // Pass manager cache and creator
+  static llvm::raw_ostream *m_llpcOuts;                           // nullptr or stream for LLPC_OUTS
+  llvm::LLVMContext &m_context;                                   // LLVM context
+  llvm::TargetMachine *m_targetMachine = nullptr;                 // Target machine
+  TargetInfo *m_targetInfo = nullptr;                             // Target info
+  unsigned m_palAbiVersion = 0xFFFFFFFF;                          // PAL pipeline ABI version to compile for
+  llvm::CodeGenOpt::Level m_optLevel = llvm::CodeGenOpt::Default; // Optimization level
+  PassManagerCache *m_passManagerCache = nullptr;                 // Pass manager cache and creator
+  NggCullerLibrary *m_nggCullerLibrary = nullptr;                 // Library of NGG cullers shared between compiles
+  std::function<bool()> m_isCancelled;                            // Cancel check of the current compile
+  bool m_cancelled = false;                                       // Whether the current compile has been cancelled
+  CancelPassGate *m_cancelPassGate = nullptr;                     // Pass gate installed while m_isCancelled is set
+  llvm::OptPassGate *m_prevPassGate = nullptr;                    // Pass gate to restore when m_isCancelled is cleared
 };
 
 } // namespace lgc
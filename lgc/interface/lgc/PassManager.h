@@ -25,23 +25,54 @@
 /**
  ***********************************************************************************************************************
  * @file  PassManager.h
- * @brief LLPC header file: contains declaration of class lgc::PassManager.
+ * @brief LLPC header file: contains declaration of classes lgc::PassManager and lgc::NewPassManager.
  ***********************************************************************************************************************
  */
 #pragma once
 
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/PassManager.h"
+
+namespace llvm {
+
+class PassInstrumentationCallbacks;
+class TargetLibraryInfoImpl;
+class TargetMachine;
+
+} // namespace llvm
 
 namespace lgc {
 
+class LgcContext;
+
 // =====================================================================================================================
 // Public interface of LLPC middle-end's legacy::PassManager override
 class PassManager : public llvm::legacy::PassManager {
 public:
-  static PassManager *Create();
+  // Create a pass manager. If lgcContext is given and has a cancel check set, a pass polling the cancel check is added
+  // after each module and function pass.
+  static PassManager *Create(LgcContext *lgcContext = nullptr);
   virtual ~PassManager() {}
   virtual void stop() = 0;
   virtual void setPassIndex(unsigned *passIndex) = 0;
 };
 
+// =====================================================================================================================
+// Public interface of LLPC middle-end's new pass manager (llvm::ModulePassManager) override. It owns the analysis
+// managers, so an analysis is computed once and then shared by the passes run in it until one of them invalidates it.
+class NewPassManager : public llvm::ModulePassManager {
+public:
+  static NewPassManager *Create(llvm::TargetMachine *targetMachine);
+  virtual ~NewPassManager() {}
+
+  // Set the target library info used by analyses and optimizations. This must be called before run().
+  virtual void setTargetLibraryInfo(const llvm::TargetLibraryInfoImpl &targetLibInfo) = 0;
+
+  // Get the callbacks run around each pass.
+  virtual llvm::PassInstrumentationCallbacks &getInstrumentationCallbacks() = 0;
+
+  // Run the passes on the module.
+  virtual void run(llvm::Module &module) = 0;
+};
+
 } // namespace lgc
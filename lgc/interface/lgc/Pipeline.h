@@ -642,9 +642,9 @@ public:
   //                 timers[0]: patch passes
   //                 timers[1]: LLVM optimizations
   //                 timers[2]: codegen
-  // @param otherElf : Optional ELF for the other half-pipeline when compiling an unlinked half-pipeline ELF.
-  //                   Supplying this could allow more optimal code for writing/reading attribute values between
-  //                   the two pipeline halves
+  // @param otherElf : Optional ELF for the vertex-processing half-pipeline when compiling an unlinked fragment
+  //                   half-pipeline ELF. The attribute interface is read from its PAL metadata, so the fragment
+  //                   half reads each attribute from where the vertex-processing half exports it
   // @returns : True for success.
   //           False if irLink asked for an "unlinked" shader or half-pipeline, and there is some reason why the
   //           module cannot be compiled that way.  The client typically then does a whole-pipeline compilation
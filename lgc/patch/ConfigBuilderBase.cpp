@@ -29,6 +29,7 @@
  ***********************************************************************************************************************
  */
 #include "ConfigBuilderBase.h"
+#include "lgc/BuiltIns.h"
 #include "lgc/state/PalMetadata.h"
 #include "lgc/state/PipelineState.h"
 #include "lgc/state/TargetInfo.h"
@@ -326,21 +327,94 @@ bool ConfigBuilderBase::usesViewportArrayIndex() {
   return m_pipelineNode[Util::Abi::PipelineMetadataKey::UsesViewportArrayIndex].getBool();
 }
 
+// =====================================================================================================================
+// When compiling the fragment half-pipeline against the vertex-processing half-pipeline ELF, get the parameter
+// export that each mapped fragment shader input location reads from. An input that the vertex-processing
+// half-pipeline does not export gets the "use default value" offset. Returns an empty vector if not compiling
+// against the other half-pipeline ELF.
+//
+// @param [out] paramOffsets : SPI_PS_INPUT_CNTL offset for each mapped fragment shader input location
+void ConfigBuilderBase::getOtherPartParamOffsets(SmallVectorImpl<unsigned> &paramOffsets) {
+  if (!m_pipelineState->hasOtherPartInterface())
+    return;
+
+  // NOTE: Setting the offset to this value forces hardware to select input defaults.
+  constexpr unsigned UseDefaultVal = (1 << 5);
+
+  std::map<std::pair<bool, unsigned>, unsigned> otherPartParams;
+  for (const ParamInterfaceInfo &param : m_pipelineState->getOtherPartInterface())
+    otherPartParams[{param.isBuiltIn, param.location}] = param.param;
+
+  const auto &inOutUsage = m_pipelineState->getShaderResourceUsage(ShaderStageFragment)->inOutUsage;
+  auto setParamOffset = [&](bool isBuiltIn, unsigned location, unsigned mappedLoc, unsigned locCount) {
+    if (paramOffsets.size() < mappedLoc + locCount)
+      paramOffsets.resize(mappedLoc + locCount, UseDefaultVal);
+    auto it = otherPartParams.find({isBuiltIn, location});
+    for (unsigned i = 0; i != locCount; ++i)
+      paramOffsets[mappedLoc + i] = it != otherPartParams.end() ? it->second + i : UseDefaultVal;
+  };
+
+  for (const auto &locInfoPair : inOutUsage.inputLocInfoMap)
+    setParamOffset(false, locInfoPair.first.getLocation(), locInfoPair.second.getLocation(), 1);
+  for (const auto &locPair : inOutUsage.builtInInputLocMap) {
+    // Clip and cull distances may occupy two locations.
+    unsigned locCount = 1;
+    if (locPair.first == BuiltInClipDistance || locPair.first == BuiltInCullDistance) {
+      const auto &builtInUsage = m_pipelineState->getShaderResourceUsage(ShaderStageFragment)->builtInUsage.fs;
+      if (builtInUsage.clipDistance + builtInUsage.cullDistance > 4)
+        locCount = 2;
+    }
+    setParamOffset(true, locPair.first, locPair.second, locCount);
+  }
+}
+
+// =====================================================================================================================
+// Record the attribute interface of an unlinked vertex-processing half-pipeline in the PAL metadata, so the fragment
+// half-pipeline can later be compiled against this ELF: the parameter export of each output of the last
+// vertex-processing stage. The fragment half-pipeline records nothing, as nothing is compiled against it.
+void ConfigBuilderBase::addParamInterfaceInfo() {
+  if (m_pipelineState->hasShaderStage(ShaderStageFragment))
+    return;
+  ShaderStage lastStage = m_pipelineState->getLastVertexProcessingStage();
+  if (lastStage == ShaderStageInvalid)
+    return;
+  if (lastStage == ShaderStageCopyShader)
+    lastStage = ShaderStageGeometry;
+
+  SmallVector<ParamInterfaceInfo, 8> params;
+  const auto &inOutUsage = m_pipelineState->getShaderResourceUsage(lastStage)->inOutUsage;
+  for (const auto &locInfoPair : inOutUsage.outputLocInfoMap) {
+    // Only the rasterization stream of a geometry shader is exported to parameters by the copy shader.
+    if (lastStage == ShaderStageGeometry && locInfoPair.first.getStreamId() != inOutUsage.gs.rasterStream)
+      continue;
+    params.push_back({locInfoPair.first.getLocation(), false, locInfoPair.second.getLocation()});
+  }
+  if (lastStage == ShaderStageGeometry) {
+    for (const auto &locPair : inOutUsage.gs.builtInOutLocs)
+      params.push_back({locPair.first, true, locPair.second});
+  } else {
+    for (const auto &locPair : inOutUsage.builtInOutputLocMap)
+      params.push_back({locPair.first, true, locPair.second});
+  }
+  m_pipelineState->getPalMetadata()->addParamInterfaceInfo(params);
+}
+
 // =====================================================================================================================
 // Finish ConfigBuilder processing by writing into the PalMetadata document
 void ConfigBuilderBase::writePalMetadata() {
-  // Generating MsgPack metadata.
-  // Add the register values to the MsgPack document. The value is ORed in because an earlier pass may have
-  // already set some bits in the same register.
-  msgpack::MapDocNode registers = m_pipelineNode[".registers"].getMap(true);
+  // An unlinked vertex-processing half-pipeline records its attribute interface, so the fragment half-pipeline can
+  // be compiled against this ELF.
+  if (m_pipelineState->isUnlinked() && m_pipelineState->isGraphics())
+    addParamInterfaceInfo();
+
+  // Add the register values to the PAL metadata register table, which is written into the MsgPack document when
+  // the PAL metadata is serialized. A register that an earlier pass, or an earlier entry, has already set keeps
+  // its value.
+  PalMetadata *palMetadata = m_pipelineState->getPalMetadata();
   for (const auto &entry : m_config) {
     assert(entry.key != InvalidMetadataKey);
-    auto key = entry.key;
-    auto &regEntry = registers[key];
-    unsigned oredValue = entry.value;
-    if (regEntry.getKind() == msgpack::Type::UInt)
-      oredValue = regEntry.getUInt();
-    regEntry = oredValue;
+    if (!palMetadata->hasRegister(entry.key))
+      palMetadata->setRegister(entry.key, entry.value);
   }
 }
 
@@ -87,6 +87,7 @@ protected:
   void appendConfig(unsigned key, unsigned value);
 
   bool usesViewportArrayIndex();
+  void getOtherPartParamOffsets(llvm::SmallVectorImpl<unsigned> &paramOffsets);
 
   template <typename T> void appendConfig(const T &config) {
     static_assert(T::ContainsPalAbiMetadataOnly, "may only be used with structs that are fully metadata notes");
@@ -107,6 +108,9 @@ protected:
   bool m_hasGs;  // Whether the pipeline has geometry shader
 
 private:
+  // Record the attribute interface of an unlinked vertex-processing half-pipeline in the PAL metadata
+  void addParamInterfaceInfo();
+
   // Get the MsgPack map node for the specified API shader in the ".shaders" map
   llvm::msgpack::MapDocNode getApiShaderNode(unsigned apiStage);
   // Get the MsgPack map node for the specified HW shader in the ".hardware_stages" map
@@ -948,12 +948,18 @@ void ConfigBuilder::buildPsRegConfig(ShaderStage shaderStage, T *pConfig) {
   const auto &fsInterpInfo = resUsage->inOutUsage.fs.interpInfo;
   const auto *interpInfo = fsInterpInfo.size() == 0 ? &dummyInterpInfo : &fsInterpInfo;
 
+  // When compiling against the vertex-processing half-pipeline ELF, read each input from where that exports it.
+  SmallVector<unsigned, 8> otherPartParamOffsets;
+  getOtherPartParamOffsets(otherPartParamOffsets);
+
   for (unsigned i = 0; i < interpInfo->size(); ++i) {
-    const auto &interpInfoElem = (*interpInfo)[i];
+    auto interpInfoElem = (*interpInfo)[i];
     if (m_pipelineState->isUnlinked() && interpInfoElem.loc == InvalidFsInterpInfo.loc) {
-      appendConfig(mmSPI_PS_INPUT_CNTL_0 + i, i);
+      appendConfig(mmSPI_PS_INPUT_CNTL_0 + i, i < otherPartParamOffsets.size() ? otherPartParamOffsets[i] : i);
       continue;
     }
+    if (i < otherPartParamOffsets.size())
+      interpInfoElem.loc = otherPartParamOffsets[i];
     assert((interpInfoElem.loc == InvalidFsInterpInfo.loc && interpInfoElem.flat == InvalidFsInterpInfo.flat &&
             interpInfoElem.custom == InvalidFsInterpInfo.custom &&
             interpInfoElem.is16bit == InvalidFsInterpInfo.is16bit &&
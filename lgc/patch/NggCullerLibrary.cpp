@@ -0,0 +1,149 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  NggCullerLibrary.cpp
+ * @brief LLPC source file: contains implementation of class lgc::NggCullerLibrary.
+ ***********************************************************************************************************************
+ */
+#include "lgc/patch/NggCullerLibrary.h"
+#include "lgc/LgcContext.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#define DEBUG_TYPE "lgc-ngg-culler-library"
+
+using namespace lgc;
+using namespace llvm;
+
+// =====================================================================================================================
+//
+// @param lgcContext : LGC context
+NggCullerLibrary::NggCullerLibrary(LgcContext *lgcContext) : m_lgcContext(lgcContext) {
+}
+
+// =====================================================================================================================
+NggCullerLibrary::~NggCullerLibrary() {
+}
+
+// =====================================================================================================================
+// Get the culler function in the specified pipeline module. If the pipeline module does not yet contain it, it is
+// cloned from the library. If the library does not yet contain it either, it is first constructed into the library
+// module with the supplied callback and simplified there, so that the construction and simplification cost is paid
+// once per LgcContext rather than once per pipeline.
+//
+// @param module : Pipeline module that needs the culler
+// @param name : Name of the culler function in the pipeline module
+// @param variant : Suffix distinguishing different codegen variants of the same culler; empty if there is only one
+// @param createCuller : Callback that constructs the culler (named as specified) into a given module
+// @returns : The culler function in the pipeline module
+Function *NggCullerLibrary::getCuller(Module *module, StringRef name, StringRef variant,
+                                      function_ref<Function *(Module *)> createCuller) {
+  if (Function *func = module->getFunction(name))
+    return func;
+
+  Module *libModule = getLibraryModule();
+  std::string libName = (name + variant).str();
+  Function *libFunc = libModule->getFunction(libName);
+  if (!libFunc) {
+    LLVM_DEBUG(dbgs() << "Building NGG culler " << libName << " into library\n");
+    libFunc = createCuller(libModule);
+    libFunc->setName(libName);
+    simplifyCuller(libFunc);
+  }
+
+  return cloneCuller(libFunc, module, name);
+}
+
+// =====================================================================================================================
+// Get (create if necessary) the library module
+Module *NggCullerLibrary::getLibraryModule() {
+  if (!m_module) {
+    TargetMachine *targetMachine = m_lgcContext->getTargetMachine();
+    m_module.reset(new Module("nggCullerLibrary", m_lgcContext->getContext()));
+    m_module->setTargetTriple(targetMachine->getTargetTriple().getTriple());
+    m_module->setDataLayout(targetMachine->createDataLayout());
+  }
+  return &*m_module;
+}
+
+// =====================================================================================================================
+// Run a few cheap function-level optimizations on a newly constructed culler in the library. The pipeline still
+// optimizes the culler after it is inlined, but starts from already-simplified IR.
+//
+// @param func : Culler function in the library module
+void NggCullerLibrary::simplifyCuller(Function *func) {
+  legacy::FunctionPassManager passMgr(func->getParent());
+  passMgr.add(createTargetTransformInfoWrapperPass(m_lgcContext->getTargetMachine()->getTargetIRAnalysis()));
+  passMgr.add(createInstructionCombiningPass(1));
+  passMgr.add(createEarlyCSEPass(true));
+  passMgr.add(createCFGSimplificationPass());
+  passMgr.doInitialization();
+  passMgr.run(*func);
+  passMgr.doFinalization();
+}
+
+// =====================================================================================================================
+// Clone a culler function from the library module into the pipeline module. Functions called by the culler (which
+// are intrinsic declarations) are mapped onto declarations in the pipeline module.
+//
+// @param libFunc : Culler function in the library module
+// @param module : Pipeline module
+// @param name : Name to give the culler function in the pipeline module
+// @returns : The cloned culler function
+Function *NggCullerLibrary::cloneCuller(Function *libFunc, Module *module, StringRef name) {
+  Function *func = Function::Create(libFunc->getFunctionType(), libFunc->getLinkage(), name, module);
+
+  ValueToValueMapTy valueMap;
+  auto argIt = func->arg_begin();
+  for (Argument &libArg : libFunc->args()) {
+    argIt->setName(libArg.getName());
+    valueMap[&libArg] = &*argIt++;
+  }
+
+  for (Instruction &inst : instructions(libFunc)) {
+    auto call = dyn_cast<CallInst>(&inst);
+    if (!call)
+      continue;
+    Function *callee = call->getCalledFunction();
+    assert(callee && callee->isDeclaration() && "NGG culler can only call declarations");
+    if (valueMap.count(callee))
+      continue;
+    valueMap[callee] =
+        module->getOrInsertFunction(callee->getName(), callee->getFunctionType(), callee->getAttributes()).getCallee();
+  }
+
+  SmallVector<ReturnInst *, 8> retInsts;
+  CloneFunctionInto(func, libFunc, valueMap, false, retInsts);
+  return func;
+}
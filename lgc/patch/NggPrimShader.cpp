@@ -32,6 +32,8 @@
 #include "Gfx9Chip.h"
 #include "NggLdsManager.h"
 #include "ShaderMerger.h"
+#include "lgc/LgcContext.h"
+#include "lgc/patch/NggCullerLibrary.h"
 #include "lgc/state/PalMetadata.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/InlineAsm.h"
@@ -3761,9 +3763,7 @@ Value *NggPrimShader::doBackfaceCulling(Module *module, Value *cullFlag, Value *
                                         Value *vertex2) {
   assert(m_nggControl->enableBackfaceCulling);
 
-  auto backfaceCuller = module->getFunction(lgcName::NggCullingBackface);
-  if (!backfaceCuller)
-    backfaceCuller = createBackfaceCuller(module);
+  auto backfaceCuller = getCuller(module, lgcName::NggCullingBackface, &NggPrimShader::createBackfaceCuller);
 
   // Get register PA_SU_SC_MODE_CNTL
   Value *paSuScModeCntl = nullptr;
@@ -3796,9 +3796,7 @@ Value *NggPrimShader::doFrustumCulling(Module *module, Value *cullFlag, Value *v
                                        Value *vertex2) {
   assert(m_nggControl->enableFrustumCulling);
 
-  auto frustumCuller = module->getFunction(lgcName::NggCullingFrustum);
-  if (!frustumCuller)
-    frustumCuller = createFrustumCuller(module);
+  auto frustumCuller = getCuller(module, lgcName::NggCullingFrustum, &NggPrimShader::createFrustumCuller);
 
   // Get register PA_CL_CLIP_CNTL
   Value *paClClipCntl = nullptr;
@@ -3830,9 +3828,7 @@ Value *NggPrimShader::doBoxFilterCulling(Module *module, Value *cullFlag, Value
                                          Value *vertex2) {
   assert(m_nggControl->enableBoxFilterCulling);
 
-  auto boxFilterCuller = module->getFunction(lgcName::NggCullingBoxFilter);
-  if (!boxFilterCuller)
-    boxFilterCuller = createBoxFilterCuller(module);
+  auto boxFilterCuller = getCuller(module, lgcName::NggCullingBoxFilter, &NggPrimShader::createBoxFilterCuller);
 
   // Get register PA_CL_VTE_CNTL
   Value *paClVteCntl = m_builder->getInt32(m_nggControl->primShaderTable.pipelineStateCb.paClVteCntl);
@@ -3866,9 +3862,7 @@ Value *NggPrimShader::doBoxFilterCulling(Module *module, Value *cullFlag, Value
 Value *NggPrimShader::doSphereCulling(Module *module, Value *cullFlag, Value *vertex0, Value *vertex1, Value *vertex2) {
   assert(m_nggControl->enableSphereCulling);
 
-  auto sphereCuller = module->getFunction(lgcName::NggCullingSphere);
-  if (!sphereCuller)
-    sphereCuller = createSphereCuller(module);
+  auto sphereCuller = getCuller(module, lgcName::NggCullingSphere, &NggPrimShader::createSphereCuller);
 
   // Get register PA_CL_VTE_CNTL
   Value *paClVteCntl = m_builder->getInt32(m_nggControl->primShaderTable.pipelineStateCb.paClVteCntl);
@@ -3903,9 +3897,10 @@ Value *NggPrimShader::doSmallPrimFilterCulling(Module *module, Value *cullFlag,
                                                Value *vertex2) {
   assert(m_nggControl->enableSmallPrimFilter);
 
-  auto smallPrimFilterCuller = module->getFunction(lgcName::NggCullingSmallPrimFilter);
-  if (!smallPrimFilterCuller)
-    smallPrimFilterCuller = createSmallPrimFilterCuller(module);
+  // The culler is built differently depending on whether frustum culling is also enabled.
+  StringRef variant = m_nggControl->enableFrustumCulling ? ".frustum" : "";
+  auto smallPrimFilterCuller =
+      getCuller(module, lgcName::NggCullingSmallPrimFilter, &NggPrimShader::createSmallPrimFilterCuller, variant);
 
   // Get register PA_CL_VTE_CNTL
   Value *paClVteCntl = m_builder->getInt32(m_nggControl->primShaderTable.pipelineStateCb.paClVteCntl);
@@ -3944,9 +3939,8 @@ Value *NggPrimShader::doCullDistanceCulling(Module *module, Value *cullFlag, Val
                                             Value *signMask2) {
   assert(m_nggControl->enableCullDistanceCulling);
 
-  auto cullDistanceCuller = module->getFunction(lgcName::NggCullingCullDistance);
-  if (!cullDistanceCuller)
-    cullDistanceCuller = createCullDistanceCuller(module);
+  auto cullDistanceCuller =
+      getCuller(module, lgcName::NggCullingCullDistance, &NggPrimShader::createCullDistanceCuller);
 
   // Do cull distance culling
   return m_builder->CreateCall(cullDistanceCuller, {cullFlag, signMask0, signMask1, signMask2});
@@ -3967,6 +3961,21 @@ Value *NggPrimShader::fetchCullingControlRegister(Module *module, unsigned regOf
       {m_nggFactor.primShaderTableAddrLow, m_nggFactor.primShaderTableAddrHigh, m_builder->getInt32(regOffset)});
 }
 
+// =====================================================================================================================
+// Gets the culler function in the pipeline module. The culler is cloned from the NGG culler library of the LGC
+// context, which constructs it with the supplied creator the first time any pipeline needs it.
+//
+// @param module : LLVM module
+// @param cullerName : Name of the culler function
+// @param createCuller : Member function that constructs the culler into a given module
+// @param variant : Suffix distinguishing codegen variants of the culler in the library
+Function *NggPrimShader::getCuller(Module *module, StringRef cullerName,
+                                   Function *(NggPrimShader::*createCuller)(Module *), StringRef variant) {
+  NggCullerLibrary *cullerLibrary = m_pipelineState->getLgcContext()->getNggCullerLibrary();
+  return cullerLibrary->getCuller(module, cullerName, variant,
+                                  [this, createCuller](Module *libModule) { return (this->*createCuller)(libModule); });
+}
+
 // =====================================================================================================================
 // Creates the function that does backface culling.
 //
@@ -232,6 +232,10 @@ private:
 
   llvm::Value *fetchCullingControlRegister(llvm::Module *module, unsigned regOffset);
 
+  llvm::Function *getCuller(llvm::Module *module, llvm::StringRef cullerName,
+                            llvm::Function *(NggPrimShader::*createCuller)(llvm::Module *),
+                            llvm::StringRef variant = "");
+
   llvm::Function *createBackfaceCuller(llvm::Module *module);
   llvm::Function *createFrustumCuller(llvm::Module *module);
   llvm::Function *createBoxFilterCuller(llvm::Module *module);
@@ -30,10 +30,13 @@
  */
 #include "lgc/patch/Patch.h"
 #include "PatchCheckShaderCache.h"
+#include "PatchLoadScalarizer.h"
+#include "PatchPeepholeOpt.h"
 #include "lgc/LgcContext.h"
 #include "lgc/state/PipelineState.h"
 #include "lgc/state/TargetInfo.h"
 #include "lgc/util/Debug.h"
+#include "llvm/Analysis/CFG.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
@@ -41,15 +44,42 @@
 #include "llvm/Transforms/AggressiveInstCombine/AggressiveInstCombine.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
+#include "llvm/Transforms/IPO/CalledValuePropagation.h"
+#include "llvm/Transforms/IPO/ConstantMerge.h"
 #include "llvm/Transforms/IPO/ForceFunctionAttrs.h"
+#include "llvm/Transforms/IPO/GlobalDCE.h"
+#include "llvm/Transforms/IPO/GlobalOpt.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/IPO/SCCP.h"
+#include "llvm/Transforms/IPO/StripDeadPrototypes.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/ADCE.h"
+#include "llvm/Transforms/Scalar/BDCE.h"
+#include "llvm/Transforms/Scalar/CorrelatedValuePropagation.h"
+#include "llvm/Transforms/Scalar/DivRemPairs.h"
+#include "llvm/Transforms/Scalar/EarlyCSE.h"
+#include "llvm/Transforms/Scalar/Float2Int.h"
 #include "llvm/Transforms/Scalar/GVN.h"
+#include "llvm/Transforms/Scalar/IndVarSimplify.h"
 #include "llvm/Transforms/Scalar/InstSimplifyPass.h"
+#include "llvm/Transforms/Scalar/LICM.h"
+#include "llvm/Transforms/Scalar/LoopDeletion.h"
+#include "llvm/Transforms/Scalar/LoopIdiomRecognize.h"
+#include "llvm/Transforms/Scalar/LoopPassManager.h"
+#include "llvm/Transforms/Scalar/LoopRotation.h"
+#include "llvm/Transforms/Scalar/LoopSink.h"
+#include "llvm/Transforms/Scalar/LoopUnrollPass.h"
+#include "llvm/Transforms/Scalar/MergedLoadStoreMotion.h"
 #include "llvm/Transforms/Scalar/NewGVN.h"
+#include "llvm/Transforms/Scalar/Reassociate.h"
+#include "llvm/Transforms/Scalar/SCCP.h"
+#include "llvm/Transforms/Scalar/SROA.h"
 #include "llvm/Transforms/Scalar/Scalarizer.h"
+#include "llvm/Transforms/Scalar/SimplifyCFG.h"
+#include "llvm/Transforms/Scalar/SpeculativeExecution.h"
 #include "llvm/Transforms/Utils.h"
+#include "llvm/Transforms/Utils/Mem2Reg.h"
 
 #define DEBUG_TYPE "lgc-patch"
 
@@ -73,6 +103,34 @@ opt<CodeGenOpt::Level> OptLevel("opt", desc("Set the optimization level:"), init
                                        clEnumValN(CodeGenOpt::Default, "default", "default optimizations"),
                                        clEnumValN(CodeGenOpt::Aggressive, "fast", "fast execution time")));
 
+// -disable-adaptive-opt: disable picking the optimization pass schedule from the size of the pipeline module
+opt<bool> DisableAdaptiveOpt("disable-adaptive-opt",
+                             desc("Disable picking the optimization pass schedule from the size of the pipeline"),
+                             init(false));
+
+// -opt-trivial-inst-count: pipeline modules with at most this many instructions get the trivial schedule
+opt<unsigned> OptTrivialInstCount("opt-trivial-inst-count",
+                                  desc("Pipeline modules with at most this many instructions get the trivial "
+                                       "optimization pass schedule"),
+                                  init(250));
+
+// -opt-huge-inst-count: pipeline modules with a function of more than this many instructions get capped unrolling
+opt<unsigned> OptHugeInstCount("opt-huge-inst-count",
+                               desc("Pipeline modules with a function of more than this many instructions get capped "
+                                    "loop unrolling"),
+                               init(20000));
+
+// -opt-huge-unroll-threshold: loop unroll threshold for pipeline modules with a huge function
+opt<unsigned> OptHugeUnrollThreshold("opt-huge-unroll-threshold",
+                                     desc("Loop unroll threshold for pipeline modules with a huge function"),
+                                     init(150));
+
+// -lgc-new-pass-manager: Experimental: run the curated optimization set in the new pass manager
+opt<bool> NewPassManager("lgc-new-pass-manager",
+                         desc("Experimental: run the curated optimization set in the new pass manager (the other "
+                              "patch passes stay in the legacy pass manager)"),
+                         init(false));
+
 } // namespace cl
 
 } // namespace llvm
@@ -84,11 +142,13 @@ namespace lgc {
 //
 // @param pipelineState : Pipeline state
 // @param [in/out] passMgr : Pass manager to add passes to
+// @param optSchedule : Optimization pass schedule, from getOptimizationSchedule
 // @param replayerPass : BuilderReplayer pass, or nullptr if not needed
 // @param patchTimer : Timer to time patch passes with, nullptr if not timing
 // @param optTimer : Timer to time LLVM optimization passes with, nullptr if not timing
-void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr, ModulePass *replayerPass,
-                      Timer *patchTimer, Timer *optTimer, Pipeline::CheckShaderCacheFunc checkShaderCacheFunc)
+void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr,
+                      const OptimizationSchedule &optSchedule, ModulePass *replayerPass, Timer *patchTimer,
+                      Timer *optTimer, Pipeline::CheckShaderCacheFunc checkShaderCacheFunc)
 // Callback function to check shader cache
 {
   // Start timer for patching passes.
@@ -160,7 +220,7 @@ void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr
   passMgr.add(createPromoteMemoryToRegisterPass());
 
   if (!cl::DisablePatchOpt)
-    addOptimizationPasses(passMgr);
+    addOptimizationPasses(passMgr, pipelineState->getLgcContext()->getOptimizationLevel(), optSchedule);
 
   // Stop timer for optimization passes and restart timer for patching passes.
   if (patchTimer) {
@@ -172,6 +232,16 @@ void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr
   passMgr.add(createPatchBufferOp());
   passMgr.add(createInstructionCombiningPass(2));
 
+  // Hoist descriptor loads to the entry block and merge identical ones (must be after PatchBufferOp, and before the
+  // coalescing passes, which compare descriptors)
+  passMgr.add(createPatchDescriptorHoist());
+
+  // Merge adjacent buffer loads and stores (must be after the offsets are simplified)
+  passMgr.add(createPatchBufferCoalesce());
+
+  // Merge adjacent waterfall loops on the same non-uniform index (must be after the indices are CSEd)
+  passMgr.add(createPatchWaterfallCoalesce());
+
   // Fully prepare the pipeline ABI (must be after optimizations)
   passMgr.add(createPatchPreparePipelineAbi(/* onlySetCallingConvs = */ false));
 
@@ -220,15 +290,78 @@ void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr
   }
 }
 
+// =====================================================================================================================
+// Pick the optimization pass schedule for a pipeline module from features measured on it. The pass costs are
+// dominated by a few huge shaders, while small shaders mostly pay the fixed cost of each pass, so:
+// - a module without loops skips the loop passes;
+// - a trivial module also skips the second LICM and AggressiveInstCombine;
+// - a module with a huge function gets capped loop unrolling.
+//
+// @param module : Pipeline module, before patching
+// @param pendingLoopCount : Number of loops that passes before the optimizations will add (waterfall loops created by
+//                           BuilderReplayer)
+OptimizationSchedule Patch::getOptimizationSchedule(const Module &module, unsigned pendingLoopCount) {
+  OptimizationSchedule optSchedule;
+  optSchedule.loopCount = pendingLoopCount;
+  SmallVector<std::pair<const BasicBlock *, const BasicBlock *>, 8> backEdges;
+  for (const Function &func : module) {
+    if (func.isDeclaration())
+      continue;
+    unsigned funcInstCount = func.getInstructionCount();
+    optSchedule.instCount += funcInstCount;
+    optSchedule.maxFuncInstCount = std::max(optSchedule.maxFuncInstCount, funcInstCount);
+
+    backEdges.clear();
+    FindFunctionBackedges(func, backEdges);
+    optSchedule.loopCount += backEdges.size();
+  }
+
+  if (!cl::DisableAdaptiveOpt) {
+    optSchedule.noLoops = optSchedule.loopCount == 0;
+    optSchedule.trivial = optSchedule.instCount <= cl::OptTrivialInstCount;
+    optSchedule.huge = optSchedule.maxFuncInstCount > cl::OptHugeInstCount;
+  }
+  return optSchedule;
+}
+
 // =====================================================================================================================
 // Add optimization passes to pass manager
 //
 // @param [in/out] passMgr : Pass manager to add passes to
-void Patch::addOptimizationPasses(legacy::PassManager &passMgr) {
-  LLPC_OUTS("PassManager optimization level = " << cl::OptLevel << "\n");
+// @param optLevel : Optimization level
+// @param optSchedule : Optimization pass schedule
+void Patch::addOptimizationPasses(legacy::PassManager &passMgr, CodeGenOpt::Level optLevel,
+                                  const OptimizationSchedule &optSchedule) {
+  LLPC_OUTS("PassManager optimization level = " << optLevel << "\n");
+  LLPC_OUTS("PassManager optimization schedule: " << optSchedule.instCount << " instructions, "
+                                                  << optSchedule.loopCount << " loops"
+                                                  << (optSchedule.noLoops ? ", no loop passes" : "")
+                                                  << (optSchedule.trivial ? ", trivial" : "")
+                                                  << (optSchedule.huge ? ", huge" : "") << "\n");
+
+  if (optLevel == CodeGenOpt::None) {
+    // Minimal optimization set, for a quick compile. Clean up the IR from the front-end, then scalarize, as that
+    // keeps the register pressure in the backend down.
+    passMgr.add(createPatchPeepholeOpt());
+    passMgr.add(createInstSimplifyLegacyPass());
+    passMgr.add(createEarlyCSEPass());
+    passMgr.add(createCFGSimplificationPass());
+    passMgr.add(createScalarizerPass());
+    passMgr.add(createInstSimplifyLegacyPass());
+    passMgr.add(createAggressiveDCEPass());
+    return;
+  }
 
   // Set up standard optimization passes.
-  if (!cl::UseLlvmOpt) {
+  if (!cl::UseLlvmOpt && cl::NewPassManager) {
+    // Experimental: run the curated optimization set in the new pass manager, split in two parts around
+    // PatchReadFirstLane, which needs the legacy divergence analysis. Of the LGC passes, only PatchPeepholeOpt and
+    // PatchLoadScalarizer have been ported. The rest of the patch pipeline, and SpirvLower, stay in the legacy pass
+    // manager until pipeline state is available as a new pass manager analysis.
+    passMgr.add(createPatchNewPmOpt(0, optSchedule));
+    passMgr.add(createPatchReadFirstLane());
+    passMgr.add(createPatchNewPmOpt(1, optSchedule));
+  } else if (!cl::UseLlvmOpt) {
     passMgr.add(createForceFunctionAttrsLegacyPass());
     passMgr.add(createIPSCCPPass());
     passMgr.add(createCalledValuePropagationPass());
@@ -243,20 +376,26 @@ void Patch::addOptimizationPasses(legacy::PassManager &passMgr) {
     passMgr.add(createSpeculativeExecutionIfHasBranchDivergencePass());
     passMgr.add(createCorrelatedValuePropagationPass());
     passMgr.add(createCFGSimplificationPass());
-    passMgr.add(createAggressiveInstCombinerPass());
+    if (!optSchedule.trivial)
+      passMgr.add(createAggressiveInstCombinerPass());
     passMgr.add(createInstructionCombiningPass(3));
     passMgr.add(createPatchPeepholeOpt());
     passMgr.add(createInstSimplifyLegacyPass());
     passMgr.add(createCFGSimplificationPass());
     passMgr.add(createReassociatePass());
-    passMgr.add(createLoopRotatePass());
-    passMgr.add(createLICMPass());
+    if (!optSchedule.noLoops) {
+      passMgr.add(createLoopRotatePass());
+      passMgr.add(createLICMPass());
+    }
     passMgr.add(createCFGSimplificationPass());
     passMgr.add(createInstructionCombiningPass(2));
-    passMgr.add(createIndVarSimplifyPass());
-    passMgr.add(createLoopIdiomPass());
-    passMgr.add(createLoopDeletionPass());
-    passMgr.add(createSimpleLoopUnrollPass(cl::OptLevel));
+    if (!optSchedule.noLoops) {
+      passMgr.add(createIndVarSimplifyPass());
+      passMgr.add(createLoopIdiomPass());
+      passMgr.add(createLoopDeletionPass());
+      if (!optSchedule.huge)
+        passMgr.add(createSimpleLoopUnrollPass(optLevel));
+    }
     passMgr.add(createPatchPeepholeOpt());
     passMgr.add(createScalarizerPass());
     passMgr.add(createPatchLoadScalarizer());
@@ -272,7 +411,8 @@ void Patch::addOptimizationPasses(legacy::PassManager &passMgr) {
     passMgr.add(createCFGSimplificationPass());
     passMgr.add(createInstSimplifyLegacyPass());
     passMgr.add(createFloat2IntPass());
-    passMgr.add(createLoopRotatePass());
+    if (!optSchedule.noLoops)
+      passMgr.add(createLoopRotatePass());
     passMgr.add(createCFGSimplificationPass(SimplifyCFGOptions()
                                                 .bonusInstThreshold(1)
                                                 .forwardSwitchCondToPhi(true)
@@ -281,21 +421,28 @@ void Patch::addOptimizationPasses(legacy::PassManager &passMgr) {
                                                 .sinkCommonInsts(true)));
     passMgr.add(createPatchPeepholeOpt());
     passMgr.add(createInstSimplifyLegacyPass());
-    passMgr.add(createLoopUnrollPass(cl::OptLevel));
+    if (optSchedule.huge) {
+      passMgr.add(createLoopUnrollPass(optLevel, /*OnlyWhenForced=*/false, /*ForgetAllSCEV=*/false,
+                                       cl::OptHugeUnrollThreshold, /*Count=*/-1, /*AllowPartial=*/0,
+                                       /*Runtime=*/0));
+    } else if (!optSchedule.noLoops)
+      passMgr.add(createLoopUnrollPass(optLevel));
     // uses DivergenceAnalysis
     passMgr.add(createPatchReadFirstLane());
     passMgr.add(createInstructionCombiningPass(2));
-    passMgr.add(createLICMPass());
+    if (!optSchedule.noLoops && !optSchedule.trivial)
+      passMgr.add(createLICMPass());
     passMgr.add(createStripDeadPrototypesPass());
     passMgr.add(createGlobalDCEPass());
     passMgr.add(createConstantMergePass());
-    passMgr.add(createLoopSinkPass());
+    if (!optSchedule.noLoops)
+      passMgr.add(createLoopSinkPass());
     passMgr.add(createInstSimplifyLegacyPass());
     passMgr.add(createDivRemPairsPass());
     passMgr.add(createCFGSimplificationPass());
   } else {
     PassManagerBuilder passBuilder;
-    passBuilder.OptLevel = cl::OptLevel;
+    passBuilder.OptLevel = optLevel;
     passBuilder.DisableGVNLoadPRE = true;
     passBuilder.DivergentTarget = true;
 
@@ -328,6 +475,110 @@ void Patch::addOptimizationPasses(legacy::PassManager &passMgr) {
   }
 }
 
+// =====================================================================================================================
+// Add one part of the curated optimization set to a new pass manager. This must be kept in step with the legacy pass
+// manager version above. Part 0 is the passes before PatchReadFirstLane, and part 1 is the passes after it.
+//
+// @param [in/out] passMgr : New pass manager to add passes to
+// @param pipelineState : Pipeline state
+// @param optSchedule : Optimization pass schedule
+// @param part : Which part of the optimization set to add
+void Patch::addOptimizationPasses(ModulePassManager &passMgr, PipelineState *pipelineState,
+                                  const OptimizationSchedule &optSchedule, unsigned part) {
+  CodeGenOpt::Level optLevel = pipelineState->getLgcContext()->getOptimizationLevel();
+  if (part == 0) {
+    passMgr.addPass(ForceFunctionAttrsPass());
+    passMgr.addPass(IPSCCPPass());
+    passMgr.addPass(CalledValuePropagationPass());
+    passMgr.addPass(GlobalOptPass());
+
+    FunctionPassManager fpm;
+    fpm.addPass(PromotePass());
+    fpm.addPass(InstCombinePass(5));
+    fpm.addPass(PatchPeepholeOptPass());
+    fpm.addPass(InstSimplifyPass());
+    fpm.addPass(SimplifyCFGPass());
+    fpm.addPass(SROA());
+    fpm.addPass(EarlyCSEPass(true));
+    fpm.addPass(SpeculativeExecutionPass(/*OnlyIfDivergentTarget=*/true));
+    fpm.addPass(CorrelatedValuePropagationPass());
+    fpm.addPass(SimplifyCFGPass());
+    if (!optSchedule.trivial)
+      fpm.addPass(AggressiveInstCombinePass());
+    fpm.addPass(InstCombinePass(3));
+    fpm.addPass(PatchPeepholeOptPass());
+    fpm.addPass(InstSimplifyPass());
+    fpm.addPass(SimplifyCFGPass());
+    fpm.addPass(ReassociatePass());
+    if (!optSchedule.noLoops) {
+      LoopPassManager lpm1;
+      lpm1.addPass(LoopRotatePass());
+      lpm1.addPass(LICMPass());
+      fpm.addPass(createFunctionToLoopPassAdaptor(std::move(lpm1), /*UseMemorySSA=*/true));
+    }
+    fpm.addPass(SimplifyCFGPass());
+    fpm.addPass(InstCombinePass(2));
+    if (!optSchedule.noLoops) {
+      LoopPassManager lpm2;
+      lpm2.addPass(IndVarSimplifyPass());
+      lpm2.addPass(LoopIdiomRecognizePass());
+      lpm2.addPass(LoopDeletionPass());
+      if (!optSchedule.huge)
+        lpm2.addPass(LoopFullUnrollPass(optLevel));
+      fpm.addPass(createFunctionToLoopPassAdaptor(std::move(lpm2)));
+    }
+    fpm.addPass(PatchPeepholeOptPass());
+    fpm.addPass(ScalarizerPass());
+    fpm.addPass(PatchLoadScalarizerPass(pipelineState));
+    fpm.addPass(InstSimplifyPass());
+    fpm.addPass(MergedLoadStoreMotionPass());
+    fpm.addPass(NewGVNPass());
+    fpm.addPass(SCCPPass());
+    fpm.addPass(BDCEPass());
+    fpm.addPass(InstCombinePass(2));
+    fpm.addPass(PatchPeepholeOptPass());
+    fpm.addPass(CorrelatedValuePropagationPass());
+    fpm.addPass(ADCEPass());
+    fpm.addPass(SimplifyCFGPass());
+    fpm.addPass(InstSimplifyPass());
+    fpm.addPass(Float2IntPass());
+    if (!optSchedule.noLoops)
+      fpm.addPass(createFunctionToLoopPassAdaptor(LoopRotatePass()));
+    fpm.addPass(SimplifyCFGPass(SimplifyCFGOptions()
+                                    .bonusInstThreshold(1)
+                                    .forwardSwitchCondToPhi(true)
+                                    .convertSwitchToLookupTable(true)
+                                    .needCanonicalLoops(true)
+                                    .sinkCommonInsts(true)));
+    fpm.addPass(PatchPeepholeOptPass());
+    fpm.addPass(InstSimplifyPass());
+    if (optSchedule.huge) {
+      // The new pass manager loop unroller has no threshold option, so just stop partial and runtime unrolling.
+      fpm.addPass(LoopUnrollPass(LoopUnrollOptions(optLevel).setPartial(false).setRuntime(false)));
+    } else if (!optSchedule.noLoops)
+      fpm.addPass(LoopUnrollPass(LoopUnrollOptions(optLevel)));
+    passMgr.addPass(createModuleToFunctionPassAdaptor(std::move(fpm)));
+    return;
+  }
+
+  FunctionPassManager fpm;
+  fpm.addPass(InstCombinePass(2));
+  if (!optSchedule.noLoops && !optSchedule.trivial)
+    fpm.addPass(createFunctionToLoopPassAdaptor(LICMPass(), /*UseMemorySSA=*/true));
+  passMgr.addPass(createModuleToFunctionPassAdaptor(std::move(fpm)));
+  passMgr.addPass(StripDeadPrototypesPass());
+  passMgr.addPass(GlobalDCEPass());
+  passMgr.addPass(ConstantMergePass());
+
+  FunctionPassManager lateFpm;
+  if (!optSchedule.noLoops)
+    lateFpm.addPass(LoopSinkPass());
+  lateFpm.addPass(InstSimplifyPass());
+  lateFpm.addPass(DivRemPairsPass());
+  lateFpm.addPass(SimplifyCFGPass());
+  passMgr.addPass(createModuleToFunctionPassAdaptor(std::move(lateFpm)));
+}
+
 // =====================================================================================================================
 // Initializes the pass according to the specified module.
 //
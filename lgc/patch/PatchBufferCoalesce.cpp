@@ -0,0 +1,404 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  PatchBufferCoalesce.cpp
+ * @brief LLPC source file: contains declaration and implementation of class lgc::PatchBufferCoalesce.
+ *
+ * This pass runs after PatchBufferOp, and merges raw buffer loads and stores of whole dwords through the same buffer
+ * descriptor into wider ones, when their offsets differ by a constant that makes them contiguous:
+ * - loads are merged only when there is no instruction that may write memory between them, and the merged load is
+ *   placed at the first of them;
+ * - stores are merged only when there is no other memory access between them, and the merged store is placed at the
+ *   last of them.
+ ***********************************************************************************************************************
+ */
+#include "lgc/patch/Patch.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsAMDGPU.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "lgc-patch-buffer-coalesce"
+
+using namespace lgc;
+using namespace llvm;
+
+namespace llvm {
+namespace cl {
+
+// -coalesce-buffer-access: Merge adjacent raw buffer loads and stores into wider ones.
+opt<bool> CoalesceBufferAccess("coalesce-buffer-access", desc("Merge adjacent raw buffer loads and stores"),
+                               init(true));
+
+} // namespace cl
+} // namespace llvm
+
+namespace {
+
+// Maximum size in bytes of a coalesced buffer access (a four-dword load or store)
+static const unsigned MaxCoalescedSize = 16;
+
+// A raw buffer load or store of whole dwords, with its offset split into a variable part and a constant part.
+struct BufferAccess {
+  IntrinsicInst *inst; // The raw buffer load or store
+  Value *offsetBase;   // Variable part of the offset, or null if the offset is constant
+  int64_t offsetConst; // Constant part of the offset, in bytes
+  unsigned size;       // Size of the access, in bytes
+};
+
+// Accesses with the same key (buffer descriptor, variable part of offset, soffset and cache policy) can be merged.
+using BufferAccessKey = std::pair<std::pair<Value *, Value *>, std::pair<Value *, Value *>>;
+
+class PatchBufferCoalesce final : public FunctionPass {
+public:
+  PatchBufferCoalesce();
+
+  bool runOnFunction(Function &function) override;
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override { analysisUsage.setPreservesCFG(); }
+
+  static char ID; // ID of this pass
+
+private:
+  PatchBufferCoalesce(const PatchBufferCoalesce &) = delete;
+  PatchBufferCoalesce &operator=(const PatchBufferCoalesce &) = delete;
+
+  bool getBufferAccess(Instruction &inst, BufferAccess &access) const;
+  bool coalesceLoads(SmallVectorImpl<BufferAccess> &loads);
+  bool coalesceAccesses(MutableArrayRef<BufferAccess> accesses, bool isStore);
+  void mergeLoads(ArrayRef<BufferAccess> chain);
+  void mergeStores(ArrayRef<BufferAccess> chain);
+  Value *getCoalescedOffset(const BufferAccess &access, bool isStore, int64_t offsetConst);
+
+  const DataLayout *m_dataLayout;                // Data layout of the module
+  std::unique_ptr<IRBuilder<>> m_builder;        // The IRBuilder
+  SmallVector<Instruction *, 16> m_instsToErase; // Loads and stores replaced by coalesced ones
+};
+
+} // anonymous namespace
+
+// =====================================================================================================================
+// Get the argument index of the buffer descriptor of a raw buffer load or store; the offset, soffset and cache policy
+// arguments follow it.
+//
+// @param isStore : Whether the access is a store
+static unsigned getDescArgIndex(bool isStore) {
+  return isStore ? 1 : 0;
+}
+
+// =====================================================================================================================
+// Get the key that decides which buffer accesses can be merged with each other.
+//
+// @param access : The buffer access
+static BufferAccessKey getBufferAccessKey(const BufferAccess &access) {
+  const unsigned descArgIdx = getDescArgIndex(access.inst->getIntrinsicID() == Intrinsic::amdgcn_raw_buffer_store);
+  return {{access.inst->getArgOperand(descArgIdx), access.offsetBase},
+          {access.inst->getArgOperand(descArgIdx + 2), access.inst->getArgOperand(descArgIdx + 3)}};
+}
+
+// =====================================================================================================================
+// Initializes static members.
+char PatchBufferCoalesce::ID = 0;
+
+// =====================================================================================================================
+// Pass creator, creates the pass of LLVM patching operations for buffer access coalescing.
+FunctionPass *lgc::createPatchBufferCoalesce() {
+  return new PatchBufferCoalesce();
+}
+
+// =====================================================================================================================
+PatchBufferCoalesce::PatchBufferCoalesce() : FunctionPass(ID), m_dataLayout(nullptr) {
+}
+
+// =====================================================================================================================
+// Executes this LLVM pass on the specified LLVM function.
+//
+// @param [in/out] function : Function that we will coalesce buffer accesses in.
+bool PatchBufferCoalesce::runOnFunction(Function &function) {
+  if (!cl::CoalesceBufferAccess)
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Run the pass Patch-Buffer-Coalesce\n");
+
+  m_dataLayout = &function.getParent()->getDataLayout();
+  m_builder = std::make_unique<IRBuilder<>>(function.getContext());
+
+  bool changed = false;
+  SmallVector<BufferAccess, 8> loads;  // Loads with no instruction that may write memory between them
+  SmallVector<BufferAccess, 4> stores; // Stores with the same key and no other memory access between them
+
+  for (BasicBlock &block : function) {
+    for (Instruction &inst : block) {
+      // Merged accesses are only inserted before the current instruction, so the walk is not disturbed.
+      BufferAccess access;
+      if (getBufferAccess(inst, access)) {
+        if (access.inst->getIntrinsicID() == Intrinsic::amdgcn_raw_buffer_store) {
+          changed |= coalesceLoads(loads);
+
+          // A store to a range that overlaps a store already in the run must stay after it.
+          bool restartRun = !stores.empty() && getBufferAccessKey(stores.front()) != getBufferAccessKey(access);
+          for (const BufferAccess &store : stores) {
+            if (access.offsetConst < store.offsetConst + store.size &&
+                store.offsetConst < access.offsetConst + access.size)
+              restartRun = true;
+          }
+          if (restartRun) {
+            changed |= coalesceAccesses(stores, /*isStore=*/true);
+            stores.clear();
+          }
+          stores.push_back(access);
+        } else {
+          changed |= coalesceAccesses(stores, /*isStore=*/true);
+          stores.clear();
+          loads.push_back(access);
+        }
+        continue;
+      }
+
+      if (inst.mayWriteToMemory())
+        changed |= coalesceLoads(loads);
+      if (inst.mayReadOrWriteMemory()) {
+        changed |= coalesceAccesses(stores, /*isStore=*/true);
+        stores.clear();
+      }
+    }
+
+    changed |= coalesceLoads(loads);
+    changed |= coalesceAccesses(stores, /*isStore=*/true);
+    stores.clear();
+  }
+
+  // Replaced accesses are only erased now, as an access may be the offset base of another one.
+  for (Instruction *inst : m_instsToErase)
+    inst->eraseFromParent();
+  m_instsToErase.clear();
+
+  return changed;
+}
+
+// =====================================================================================================================
+// Check whether an instruction is a raw buffer load or store of whole dwords, and split its offset.
+//
+// @param inst : The instruction to check
+// @param [out] access : The buffer access, if the instruction is one
+// @returns : True if the instruction is a raw buffer load or store that can be coalesced
+bool PatchBufferCoalesce::getBufferAccess(Instruction &inst, BufferAccess &access) const {
+  auto intrinsic = dyn_cast<IntrinsicInst>(&inst);
+  if (!intrinsic)
+    return false;
+
+  Type *dataTy = nullptr;
+  bool isStore = false;
+  if (intrinsic->getIntrinsicID() == Intrinsic::amdgcn_raw_buffer_load)
+    dataTy = intrinsic->getType();
+  else if (intrinsic->getIntrinsicID() == Intrinsic::amdgcn_raw_buffer_store) {
+    dataTy = intrinsic->getArgOperand(0)->getType();
+    isStore = true;
+  } else
+    return false;
+
+  // Only accesses of 32-bit scalars or vectors of them, which PatchBufferOp emits for dword-aligned accesses.
+  Type *elemTy = dataTy->getScalarType();
+  if (!elemTy->isIntegerTy(32) && !elemTy->isFloatTy())
+    return false;
+
+  access.inst = intrinsic;
+  access.size = static_cast<unsigned>(m_dataLayout->getTypeStoreSize(dataTy));
+  if (access.size >= MaxCoalescedSize)
+    return false;
+
+  // Split the offset into base + constant. InstCombine turns the add into an or when the base is known to be
+  // aligned.
+  Value *offset = intrinsic->getArgOperand(getDescArgIndex(isStore) + 1);
+  access.offsetBase = offset;
+  access.offsetConst = 0;
+  if (auto constOffset = dyn_cast<ConstantInt>(offset)) {
+    access.offsetBase = nullptr;
+    access.offsetConst = constOffset->getSExtValue();
+  } else if (auto binOp = dyn_cast<BinaryOperator>(offset)) {
+    auto constOffset = dyn_cast<ConstantInt>(binOp->getOperand(1));
+    if (constOffset && (binOp->getOpcode() == Instruction::Add ||
+                        (binOp->getOpcode() == Instruction::Or &&
+                         haveNoCommonBitsSet(binOp->getOperand(0), constOffset, *m_dataLayout)))) {
+      access.offsetBase = binOp->getOperand(0);
+      access.offsetConst = constOffset->getSExtValue();
+    }
+  }
+  return true;
+}
+
+// =====================================================================================================================
+// Coalesce a set of loads that have no instruction that may write memory between them, and clear the set.
+//
+// @param [in/out] loads : The loads, in program order
+// @returns : True if any loads were merged
+bool PatchBufferCoalesce::coalesceLoads(SmallVectorImpl<BufferAccess> &loads) {
+  bool changed = false;
+  if (loads.size() >= 2) {
+    MapVector<BufferAccessKey, SmallVector<BufferAccess, 4>> loadGroups;
+    for (const BufferAccess &load : loads)
+      loadGroups[getBufferAccessKey(load)].push_back(load);
+    for (auto &loadGroup : loadGroups)
+      changed |= coalesceAccesses(loadGroup.second, /*isStore=*/false);
+  }
+  loads.clear();
+  return changed;
+}
+
+// =====================================================================================================================
+// Merge chains of contiguous accesses with the same key.
+//
+// @param [in/out] accesses : The accesses, in program order; sorted by offset on return
+// @param isStore : Whether the accesses are stores
+// @returns : True if any accesses were merged
+bool PatchBufferCoalesce::coalesceAccesses(MutableArrayRef<BufferAccess> accesses, bool isStore) {
+  if (accesses.size() < 2)
+    return false;
+
+  std::stable_sort(accesses.begin(), accesses.end(),
+                   [](const BufferAccess &lhs, const BufferAccess &rhs) { return lhs.offsetConst < rhs.offsetConst; });
+
+  bool changed = false;
+  for (unsigned chainStart = 0; chainStart < accesses.size();) {
+    unsigned chainEnd = chainStart + 1;
+    unsigned chainSize = accesses[chainStart].size;
+    while (chainEnd < accesses.size() &&
+           accesses[chainEnd].offsetConst == accesses[chainStart].offsetConst + chainSize &&
+           chainSize + accesses[chainEnd].size <= MaxCoalescedSize) {
+      chainSize += accesses[chainEnd].size;
+      ++chainEnd;
+    }
+
+    if (chainEnd - chainStart >= 2) {
+      ArrayRef<BufferAccess> chain = accesses.slice(chainStart, chainEnd - chainStart);
+      if (isStore)
+        mergeStores(chain);
+      else
+        mergeLoads(chain);
+      changed = true;
+    }
+    chainStart = chainEnd;
+  }
+  return changed;
+}
+
+// =====================================================================================================================
+// Get the offset of a coalesced access, from the offset operand of one of the accesses it replaces. The current
+// operand is used rather than the split offset, as the base may be a load that has already been replaced.
+//
+// @param access : The access to take the offset operand from; the builder must be inserting before or after it
+// @param isStore : Whether the access is a store
+// @param offsetConst : The constant part of the offset of the coalesced access
+Value *PatchBufferCoalesce::getCoalescedOffset(const BufferAccess &access, bool isStore, int64_t offsetConst) {
+  Value *offset = access.inst->getArgOperand(getDescArgIndex(isStore) + 1);
+  if (offsetConst == access.offsetConst)
+    return offset;
+  return m_builder->CreateAdd(offset, m_builder->getInt32(static_cast<uint32_t>(offsetConst - access.offsetConst)));
+}
+
+// =====================================================================================================================
+// Merge a chain of contiguous loads into one load, placed at the first of them in program order.
+//
+// @param chain : The loads, sorted by offset
+void PatchBufferCoalesce::mergeLoads(ArrayRef<BufferAccess> chain) {
+  const BufferAccess *first = &chain.front();
+  unsigned dwordCount = 0;
+  for (const BufferAccess &load : chain) {
+    if (load.inst->comesBefore(first->inst))
+      first = &load;
+    dwordCount += load.size / 4;
+  }
+
+  m_builder->SetInsertPoint(first->inst);
+  Value *offset = getCoalescedOffset(*first, /*isStore=*/false, chain.front().offsetConst);
+  IntrinsicInst *firstInst = first->inst;
+  Value *newLoad = m_builder->CreateIntrinsic(
+      Intrinsic::amdgcn_raw_buffer_load, FixedVectorType::get(m_builder->getInt32Ty(), dwordCount),
+      {firstInst->getArgOperand(0), offset, firstInst->getArgOperand(2), firstInst->getArgOperand(3)});
+
+  for (const BufferAccess &load : chain) {
+    const unsigned dwordIdx = static_cast<unsigned>(load.offsetConst - chain.front().offsetConst) / 4;
+    const unsigned loadDwordCount = load.size / 4;
+    Value *part = nullptr;
+    if (loadDwordCount == 1)
+      part = m_builder->CreateExtractElement(newLoad, dwordIdx);
+    else {
+      SmallVector<int, 4> shuffleMask;
+      for (unsigned i = 0; i != loadDwordCount; ++i)
+        shuffleMask.push_back(dwordIdx + i);
+      part = m_builder->CreateShuffleVector(newLoad, UndefValue::get(newLoad->getType()), shuffleMask);
+    }
+    part = m_builder->CreateBitCast(part, load.inst->getType());
+    part->takeName(load.inst);
+    load.inst->replaceAllUsesWith(part);
+    m_instsToErase.push_back(load.inst);
+  }
+}
+
+// =====================================================================================================================
+// Merge a chain of contiguous stores into one store, placed at the last of them in program order.
+//
+// @param chain : The stores, sorted by offset
+void PatchBufferCoalesce::mergeStores(ArrayRef<BufferAccess> chain) {
+  const BufferAccess *last = &chain.front();
+  unsigned dwordCount = 0;
+  for (const BufferAccess &store : chain) {
+    if (last->inst->comesBefore(store.inst))
+      last = &store;
+    dwordCount += store.size / 4;
+  }
+
+  m_builder->SetInsertPoint(last->inst);
+  Value *data = UndefValue::get(FixedVectorType::get(m_builder->getInt32Ty(), dwordCount));
+  for (const BufferAccess &store : chain) {
+    const unsigned dwordIdx = static_cast<unsigned>(store.offsetConst - chain.front().offsetConst) / 4;
+    const unsigned storeDwordCount = store.size / 4;
+    Value *storeValue = store.inst->getArgOperand(0);
+    if (storeDwordCount == 1) {
+      storeValue = m_builder->CreateBitCast(storeValue, m_builder->getInt32Ty());
+      data = m_builder->CreateInsertElement(data, storeValue, dwordIdx);
+    } else {
+      storeValue = m_builder->CreateBitCast(storeValue, FixedVectorType::get(m_builder->getInt32Ty(), storeDwordCount));
+      for (unsigned i = 0; i != storeDwordCount; ++i)
+        data = m_builder->CreateInsertElement(data, m_builder->CreateExtractElement(storeValue, i), dwordIdx + i);
+    }
+    m_instsToErase.push_back(store.inst);
+  }
+
+  Value *offset = getCoalescedOffset(*last, /*isStore=*/true, chain.front().offsetConst);
+  IntrinsicInst *lastInst = last->inst;
+  m_builder->CreateIntrinsic(
+      Intrinsic::amdgcn_raw_buffer_store, data->getType(),
+      {data, lastInst->getArgOperand(1), offset, lastInst->getArgOperand(3), lastInst->getArgOperand(4)});
+}
+
+// =====================================================================================================================
+// Initializes the pass of LLVM patching operations for buffer access coalescing.
+INITIALIZE_PASS(PatchBufferCoalesce, DEBUG_TYPE, "Patch LLVM for buffer access coalescing", false, false)
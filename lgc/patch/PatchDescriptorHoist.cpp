@@ -0,0 +1,327 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  PatchDescriptorHoist.cpp
+ * @brief LLPC source file: contains declaration and implementation of class lgc::PatchDescriptorHoist.
+ *
+ * DescBuilder and the image and buffer lowering emit a descriptor table pointer computation and a descriptor load at
+ * each access site, and rely on the generic optimizations to clean up afterwards, which they often fail to do across
+ * the control flow added by waterfall loops and PatchBufferOp. This pass runs after PatchBufferOp, and moves each load
+ * from constant memory whose address is computed only from user data SGPRs, the PC, other descriptor loads and constant
+ * offsets to the entry block, along with its address computation, merging it with an identical load already there.
+ * Loads in the deepest loops are hoisted first, and hoisting stops once the hoisted loads not merged with another
+ * take up the SGPR budget set by -descriptor-hoist-max-sgprs, so that it does not cause spilling.
+ ***********************************************************************************************************************
+ */
+#include "lgc/patch/Patch.h"
+#include "lgc/state/IntrinsDefs.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsAMDGPU.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+
+#define DEBUG_TYPE "lgc-patch-descriptor-hoist"
+
+using namespace lgc;
+using namespace llvm;
+
+namespace llvm {
+namespace cl {
+
+// -hoist-descriptor-loads: Hoist descriptor loads to the entry block and merge identical ones.
+opt<bool> HoistDescriptorLoads("hoist-descriptor-loads",
+                               desc("Hoist descriptor loads to the entry block and merge identical ones"), init(true));
+
+// -descriptor-hoist-max-sgprs: Maximum number of SGPRs taken by descriptor loads hoisted to the entry block.
+opt<unsigned> DescriptorHoistMaxSgprs("descriptor-hoist-max-sgprs",
+                                      desc("Maximum number of SGPRs of descriptor loads hoisted to the entry block"),
+                                      init(32));
+
+} // namespace cl
+} // namespace llvm
+
+namespace {
+
+// Maximum depth of the address computation of a descriptor load that is looked through
+static const unsigned MaxAddressDepth = 8;
+
+class PatchDescriptorHoist final : public FunctionPass {
+public:
+  PatchDescriptorHoist();
+
+  bool runOnFunction(Function &function) override;
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override {
+    analysisUsage.addRequired<LoopInfoWrapperPass>();
+    analysisUsage.setPreservesCFG();
+  }
+
+  static char ID; // ID of this pass
+
+private:
+  PatchDescriptorHoist(const PatchDescriptorHoist &) = delete;
+  PatchDescriptorHoist &operator=(const PatchDescriptorHoist &) = delete;
+
+  bool isDescriptorLoad(LoadInst *load, unsigned depth);
+  bool isHoistable(Value *value, unsigned depth);
+  Instruction *findInEntryBlock(Instruction *inst);
+  unsigned getHoistCost(Instruction *inst);
+  Instruction *hoist(Instruction *inst);
+
+  BasicBlock *m_entryBlock = nullptr;        // Entry block of the function being processed
+  DenseMap<Value *, bool> m_hoistable;       // Cache of the results of isHoistable
+  SmallVector<Instruction *, 8> m_deadInsts; // Instructions replaced by an identical one in the entry block
+};
+
+} // anonymous namespace
+
+// =====================================================================================================================
+// Initializes static members.
+char PatchDescriptorHoist::ID = 0;
+
+// =====================================================================================================================
+// Pass creator, creates the pass of LLVM patching operations for descriptor load hoisting.
+FunctionPass *lgc::createPatchDescriptorHoist() {
+  return new PatchDescriptorHoist();
+}
+
+// =====================================================================================================================
+PatchDescriptorHoist::PatchDescriptorHoist() : FunctionPass(ID) {
+}
+
+// =====================================================================================================================
+// Executes this LLVM pass on the specified LLVM function.
+//
+// @param [in/out] function : Function that we will hoist descriptor loads in.
+bool PatchDescriptorHoist::runOnFunction(Function &function) {
+  if (!cl::HoistDescriptorLoads || function.isDeclaration())
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Run the pass Patch-Descriptor-Hoist\n");
+
+  m_entryBlock = &function.getEntryBlock();
+  m_hoistable.clear();
+  m_deadInsts.clear();
+
+  // Gather the descriptor loads outside the entry block, those in the deepest loops first.
+  LoopInfo &loopInfo = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  SmallVector<std::pair<unsigned, LoadInst *>, 8> loads;
+  for (BasicBlock &block : function) {
+    if (&block == m_entryBlock)
+      continue;
+    for (Instruction &inst : block) {
+      if (auto load = dyn_cast<LoadInst>(&inst)) {
+        if (isDescriptorLoad(load, 0))
+          loads.push_back({loopInfo.getLoopDepth(&block), load});
+      }
+    }
+  }
+  if (loads.empty())
+    return false;
+  std::stable_sort(loads.begin(), loads.end(),
+                   [](const std::pair<unsigned, LoadInst *> &lhs, const std::pair<unsigned, LoadInst *> &rhs) {
+                     return lhs.first > rhs.first;
+                   });
+
+  bool changed = false;
+  unsigned sgprCount = 0;
+  for (const auto &depthAndLoad : loads) {
+    LoadInst *load = depthAndLoad.second;
+    // The load may already have been hoisted, or replaced, as part of the address computation of another one.
+    if (load->getParent() == m_entryBlock || is_contained(m_deadInsts, load))
+      continue;
+    unsigned cost = getHoistCost(load);
+    if (sgprCount + cost > cl::DescriptorHoistMaxSgprs)
+      continue;
+    LLVM_DEBUG(dbgs() << "Hoisting descriptor load " << *load << "\n");
+    sgprCount += cost;
+    hoist(load);
+    changed = true;
+  }
+
+  for (Instruction *inst : m_deadInsts)
+    inst->eraseFromParent();
+  return changed;
+}
+
+// =====================================================================================================================
+// Check whether a load is a descriptor load that can be hoisted to the entry block: a simple load from constant memory
+// whose address is hoistable.
+//
+// @param load : The load
+// @param depth : Depth of the load in the address computation of the descriptor load being checked
+bool PatchDescriptorHoist::isDescriptorLoad(LoadInst *load, unsigned depth) {
+  return load->isSimple() && load->getPointerAddressSpace() == ADDR_SPACE_CONST &&
+         isHoistable(load->getPointerOperand(), depth);
+}
+
+// =====================================================================================================================
+// Check whether a value is a constant, or a relocatable constant that the linker will fill in.
+//
+// @param value : The value
+static bool isConstantOrReloc(Value *value) {
+  if (isa<Constant>(value))
+    return true;
+  auto intrinsic = dyn_cast<IntrinsicInst>(value);
+  return intrinsic && intrinsic->getIntrinsicID() == Intrinsic::amdgcn_reloc_constant;
+}
+
+// =====================================================================================================================
+// Check whether a value in the address computation of a descriptor load is available in the entry block, or can be
+// computed there. The leaves of the computation must be constants, relocatable constants, SGPR arguments, the PC, or
+// descriptor loads; on top of those, it can use casts, vector element operations, GEPs with constant indices, and
+// arithmetic operations with a constant operand other than a division. That holds even for instructions already in
+// the entry block: an index computed at run time, such as one checked against the size of the table by a condition
+// around the load, would let a hoisted load read outside the table.
+//
+// @param value : The value
+// @param depth : Depth of the value in the address computation of the descriptor load being checked
+bool PatchDescriptorHoist::isHoistable(Value *value, unsigned depth) {
+  if (isConstantOrReloc(value))
+    return true;
+  if (auto arg = dyn_cast<Argument>(value))
+    return arg->hasInRegAttr();
+  auto inst = dyn_cast<Instruction>(value);
+  if (!inst || depth == MaxAddressDepth)
+    return false;
+  auto cached = m_hoistable.find(inst);
+  if (cached != m_hoistable.end())
+    return cached->second;
+
+  bool hoistable = false;
+  if (auto load = dyn_cast<LoadInst>(inst))
+    hoistable = isDescriptorLoad(load, depth + 1);
+  else if (auto intrinsic = dyn_cast<IntrinsicInst>(inst))
+    hoistable = intrinsic->getIntrinsicID() == Intrinsic::amdgcn_s_getpc;
+  else if (auto gep = dyn_cast<GetElementPtrInst>(inst)) {
+    hoistable = all_of(gep->indices(), [](Value *index) { return isConstantOrReloc(index); }) &&
+                isHoistable(gep->getPointerOperand(), depth + 1);
+  } else if (isa<BinaryOperator>(inst)) {
+    hoistable = !inst->isIntDivRem() &&
+                (isConstantOrReloc(inst->getOperand(0)) || isConstantOrReloc(inst->getOperand(1))) &&
+                all_of(inst->operands(), [&](Value *operand) { return isHoistable(operand, depth + 1); });
+  } else if (isa<CastInst>(inst) || isa<InsertElementInst>(inst) || isa<ExtractElementInst>(inst) ||
+             isa<ShuffleVectorInst>(inst)) {
+    hoistable = all_of(inst->operands(), [&](Value *operand) { return isHoistable(operand, depth + 1); });
+  }
+  m_hoistable[inst] = hoistable;
+  return hoistable;
+}
+
+// =====================================================================================================================
+// Find an instruction in the entry block that computes the same value as the specified instruction would if it was
+// hoisted there. Returns the instruction itself if it is already in the entry block, and nullptr if there is none.
+//
+// @param inst : Hoistable instruction
+Instruction *PatchDescriptorHoist::findInEntryBlock(Instruction *inst) {
+  if (inst->getParent() == m_entryBlock)
+    return inst;
+
+  // Get the operands the instruction would have in the entry block.
+  SmallVector<Value *, 4> operands;
+  for (Value *operand : inst->operands()) {
+    if (auto operandInst = dyn_cast<Instruction>(operand)) {
+      operand = findInEntryBlock(operandInst);
+      if (!operand)
+        return nullptr;
+    }
+    operands.push_back(operand);
+  }
+
+  auto isEquivalent = [&](Instruction *other) {
+    return other != inst && other->getParent() == m_entryBlock && other->isSameOperationAs(inst) &&
+           std::equal(operands.begin(), operands.end(), other->op_begin());
+  };
+
+  // Look among the users of an operand that is not a constant, or else in the whole entry block.
+  auto nonConstant = find_if(operands, [](Value *operand) { return !isa<Constant>(operand); });
+  if (nonConstant != operands.end()) {
+    for (User *user : (*nonConstant)->users()) {
+      auto userInst = dyn_cast<Instruction>(user);
+      if (userInst && isEquivalent(userInst))
+        return userInst;
+    }
+    return nullptr;
+  }
+  for (Instruction &other : *m_entryBlock) {
+    if (isEquivalent(&other))
+      return &other;
+  }
+  return nullptr;
+}
+
+// =====================================================================================================================
+// Get the number of SGPRs that hoisting a descriptor load, and its address computation, to the entry block would keep
+// live from there: the size of each load hoisted that is not merged with an identical load already there.
+//
+// @param inst : Hoistable instruction
+unsigned PatchDescriptorHoist::getHoistCost(Instruction *inst) {
+  if (findInEntryBlock(inst))
+    return 0;
+  unsigned cost = 0;
+  if (isa<LoadInst>(inst))
+    cost = alignTo(inst->getModule()->getDataLayout().getTypeStoreSize(inst->getType()), 4) / 4;
+  for (Value *operand : inst->operands()) {
+    if (auto operandInst = dyn_cast<Instruction>(operand))
+      cost += getHoistCost(operandInst);
+  }
+  return cost;
+}
+
+// =====================================================================================================================
+// Hoist an instruction, after its operands, to the end of the entry block, or replace it with an identical instruction
+// already there. Returns the instruction in the entry block.
+//
+// @param inst : Hoistable instruction
+Instruction *PatchDescriptorHoist::hoist(Instruction *inst) {
+  if (inst->getParent() == m_entryBlock)
+    return inst;
+
+  // Hoisting an operand that is replaced by an identical instruction updates the operand of this one.
+  for (Value *operand : inst->operands()) {
+    if (auto operandInst = dyn_cast<Instruction>(operand))
+      hoist(operandInst);
+  }
+
+  if (Instruction *equivalent = findInEntryBlock(inst)) {
+    inst->replaceAllUsesWith(equivalent);
+    m_deadInsts.push_back(inst);
+    return equivalent;
+  }
+  inst->moveBefore(m_entryBlock->getTerminator());
+  return inst;
+}
+
+// =====================================================================================================================
+// Initializes the pass of LLVM patching operations for descriptor load hoisting.
+INITIALIZE_PASS_BEGIN(PatchDescriptorHoist, DEBUG_TYPE, "Patch LLVM for descriptor load hoisting", false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_END(PatchDescriptorHoist, DEBUG_TYPE, "Patch LLVM for descriptor load hoisting", false, false)
@@ -65,6 +65,7 @@
 #include "lgc/state/TargetInfo.h"
 #include "lgc/util/AddressExtender.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
@@ -82,6 +83,11 @@ namespace cl {
 // GS on-chip behavior. In the future, if PAL allows hardcoded ES-GS LDS size, this option could be deprecated.
 opt<bool> InRegEsGsLdsSize("inreg-esgs-lds-size", desc("For GS on-chip, add esGsLdsSize in user data"), init(true));
 
+// -weighted-user-data-spill: When not all user data nodes fit in SGPRs, keep the most used ones (weighted by loop
+// depth) rather than the first ones in the user data layout.
+opt<bool> WeightedUserDataSpill("weighted-user-data-spill",
+                                desc("Choose user data nodes to spill by static access weight"), init(true));
+
 } // namespace cl
 } // namespace llvm
 
@@ -98,6 +104,7 @@ public:
   void getAnalysisUsage(AnalysisUsage &analysisUsage) const override {
     analysisUsage.addRequired<PipelineStateWrapper>();
     analysisUsage.addRequired<PipelineShaders>();
+    analysisUsage.addRequired<LoopInfoWrapperPass>();
     // Does not preserve PipelineShaders because it replaces the entrypoints.
   }
 
@@ -106,11 +113,18 @@ public:
   static char ID; // ID of this pass
 
 private:
+  // User data usage for one user data node
+  struct UserDataNodeUsage {
+    unsigned entryArgIdx = 0;
+    unsigned dwordSize = 0; // Only used in pushConstOffsets
+    SmallVector<Instruction *, 4> users;
+  };
+
   // A shader entry-point user data argument
   struct UserDataArg {
     UserDataArg(Type *argTy, unsigned userDataValue = static_cast<unsigned>(UserDataMapping::Invalid),
-                unsigned *argIndex = nullptr)
-        : argTy(argTy), userDataValue(userDataValue), argIndex(argIndex) {
+                unsigned *argIndex = nullptr, const UserDataNodeUsage *usage = nullptr)
+        : argTy(argTy), userDataValue(userDataValue), argIndex(argIndex), usage(usage) {
       if (isa<PointerType>(argTy))
         argDwordSize = argTy->getPointerAddressSpace() == ADDR_SPACE_CONST_32BIT ? 1 : 2;
       else
@@ -120,17 +134,11 @@ private:
     UserDataArg(Type *argTy, UserDataMapping userDataValue, unsigned *argIndex = nullptr)
         : UserDataArg(argTy, static_cast<unsigned>(userDataValue), argIndex) {}
 
-    Type *argTy;            // IR type of the argument
-    unsigned argDwordSize;  // Size of argument in dwords
-    unsigned userDataValue; // PAL metadata user data value, ~0U (UserDataMapping::Invalid) for none
-    unsigned *argIndex;     // Where to store arg index once it is allocated, nullptr for none
-  };
-
-  // User data usage for one user data node
-  struct UserDataNodeUsage {
-    unsigned entryArgIdx = 0;
-    unsigned dwordSize = 0; // Only used in pushConstOffsets
-    SmallVector<Instruction *, 4> users;
+    Type *argTy;                    // IR type of the argument
+    unsigned argDwordSize;          // Size of argument in dwords
+    unsigned userDataValue;         // PAL metadata user data value, ~0U (UserDataMapping::Invalid) for none
+    unsigned *argIndex;             // Where to store arg index once it is allocated, nullptr for none
+    const UserDataNodeUsage *usage; // Node usage, to weight it for spilling; nullptr to keep it in preference
   };
 
   // Per-merged-shader-stage gathered user data usage information.
@@ -183,11 +191,14 @@ private:
                               SmallVectorImpl<UserDataArg> &specialUserDataArgs, IRBuilder<> &builder);
   void addUserDataArgs(SmallVectorImpl<UserDataArg> &userDataArgs, IRBuilder<> &builder);
   void addUserDataArg(SmallVectorImpl<UserDataArg> &userDataArgs, unsigned userDataValue, unsigned sizeInDwords,
-                      unsigned *argIndex, IRBuilder<> &builder);
+                      unsigned *argIndex, const UserDataNodeUsage *usage, IRBuilder<> &builder);
 
   void determineUnspilledUserDataArgs(ArrayRef<UserDataArg> userDataArgs, ArrayRef<UserDataArg> specialUserDataArgs,
                                       IRBuilder<> &builder, SmallVectorImpl<UserDataArg> &unspilledArgs);
 
+  // Get the static access weight of a user data node
+  uint64_t getUserDataWeight(const UserDataNodeUsage &usage);
+
   uint64_t pushFixedShaderArgTys(SmallVectorImpl<Type *> &argTys) const;
 
   // Get UserDataUsage struct for the merged shader stage that contains the given shader stage
@@ -204,6 +215,8 @@ private:
   bool m_computeWithCalls = false;          // Whether this is compute pipeline with calls or compute library
   // Per-HW-shader-stage gathered user data usage information.
   SmallVector<std::unique_ptr<UserDataUsage>, ShaderStageCount> m_userDataUsage;
+  // Loop depth of each block in functions that we have weighted user data uses in.
+  DenseMap<const BasicBlock *, unsigned> m_loopDepths;
 };
 
 } // anonymous namespace
@@ -262,6 +275,7 @@ bool PatchEntryPointMutate::runOnModule(Module &module) {
   // Fix up user data uses to use entry args.
   fixupUserDataUses(*m_module);
   m_userDataUsage.clear();
+  m_loopDepths.clear();
 
   // Fix up shader input uses to use entry args.
   shaderInputs.fixupUses(*m_module, m_pipelineState);
@@ -1176,7 +1190,8 @@ void PatchEntryPointMutate::addUserDataArgs(SmallVectorImpl<UserDataArg> &userDa
         assert(descSetIdx <= static_cast<unsigned>(UserDataMapping::DescriptorSetMax) -
                                  static_cast<unsigned>(UserDataMapping::DescriptorSet0));
         unsigned userDataValue = static_cast<unsigned>(UserDataMapping::DescriptorSet0) + descSetIdx;
-        userDataArgs.push_back(UserDataArg(builder.getInt32Ty(), userDataValue, &descriptorSet.entryArgIdx));
+        userDataArgs.push_back(
+            UserDataArg(builder.getInt32Ty(), userDataValue, &descriptorSet.entryArgIdx, &descriptorSet));
       }
     }
 
@@ -1210,7 +1225,7 @@ void PatchEntryPointMutate::addUserDataArgs(SmallVectorImpl<UserDataArg> &userDa
       assert(dwordOffset + pushConstOffset.dwordSize - 1 <=
              static_cast<unsigned>(UserDataMapping::PushConstMax) - static_cast<unsigned>(UserDataMapping::PushConst0));
       addUserDataArg(userDataArgs, static_cast<unsigned>(UserDataMapping::PushConst0) + dwordOffset,
-                     pushConstOffset.dwordSize, &pushConstOffset.entryArgIdx, builder);
+                     pushConstOffset.dwordSize, &pushConstOffset.entryArgIdx, &pushConstOffset, builder);
     }
 
     return;
@@ -1250,7 +1265,7 @@ void PatchEntryPointMutate::addUserDataArgs(SmallVectorImpl<UserDataArg> &userDa
       }
       // Add the arg (descriptor set pointer) that we can potentially unspill.
       unsigned *argIndex = descSetUsage == nullptr ? nullptr : &descSetUsage->entryArgIdx;
-      addUserDataArg(userDataArgs, userDataValue, node.sizeInDwords, argIndex, builder);
+      addUserDataArg(userDataArgs, userDataValue, node.sizeInDwords, argIndex, descSetUsage, builder);
       break;
     }
 
@@ -1297,7 +1312,7 @@ void PatchEntryPointMutate::addUserDataArgs(SmallVectorImpl<UserDataArg> &userDa
 
           // Add the arg (part of the push const) that we can potentially unspill.
           addUserDataArg(userDataArgs, node.offsetInDwords + dwordOffset, pushConstOffset.dwordSize,
-                         &pushConstOffset.entryArgIdx, builder);
+                         &pushConstOffset.entryArgIdx, &pushConstOffset, builder);
         }
       }
 
@@ -1324,7 +1339,7 @@ void PatchEntryPointMutate::addUserDataArgs(SmallVectorImpl<UserDataArg> &userDa
           continue;
         unsigned dwordSize = rootDescUsage.users[0]->getType()->getPrimitiveSizeInBits() / 32;
         // Add the arg (root descriptor) that we can potentially unspill.
-        addUserDataArg(userDataArgs, dwordOffset, dwordSize, &rootDescUsage.entryArgIdx, builder);
+        addUserDataArg(userDataArgs, dwordOffset, dwordSize, &rootDescUsage.entryArgIdx, &rootDescUsage, builder);
       }
       break;
     }
@@ -1338,13 +1353,15 @@ void PatchEntryPointMutate::addUserDataArgs(SmallVectorImpl<UserDataArg> &userDa
 // @param userDataValue : PAL metadata user data value, ~0U (UserDataMapping::Invalid) for none
 // @param sizeInDwords : Size of argument in dwords
 // @param argIndex : Where to store arg index once it is allocated, nullptr for none
+// @param usage : Usage of the user data node, nullptr if not known
 // @param builder : IRBuilder (just for getting types)
 void PatchEntryPointMutate::addUserDataArg(SmallVectorImpl<UserDataArg> &userDataArgs, unsigned userDataValue,
-                                           unsigned sizeInDwords, unsigned *argIndex, IRBuilder<> &builder) {
+                                           unsigned sizeInDwords, unsigned *argIndex, const UserDataNodeUsage *usage,
+                                           IRBuilder<> &builder) {
   Type *argTy = builder.getInt32Ty();
   if (sizeInDwords != 1)
     argTy = FixedVectorType::get(argTy, sizeInDwords);
-  userDataArgs.push_back(UserDataArg(argTy, userDataValue, argIndex));
+  userDataArgs.push_back(UserDataArg(argTy, userDataValue, argIndex, usage));
 }
 
 // =====================================================================================================================
@@ -1426,45 +1443,61 @@ void PatchEntryPointMutate::determineUnspilledUserDataArgs(ArrayRef<UserDataArg>
   if (spillTableArg.hasValue())
     userDataEnd -= 1;
 
-  // See if we need to spill any user data nodes in userDataArgs, copying the unspilled ones across to unspilledArgs.
-  unsigned userDataIdx = 0;
+  // See if we need to spill any user data nodes in userDataArgs.
+  unsigned userDataSize = 0;
+  for (const UserDataArg &userDataArg : userDataArgs)
+    userDataSize += userDataArg.argDwordSize;
+
+  SmallVector<bool, 8> spilled(userDataArgs.size(), false);
+  if (userDataSize > userDataEnd) {
+    // Some nodes need spilling. Allocate the spill table arg.
+    if (!spillTableArg.hasValue()) {
+      spillTableArg =
+          UserDataArg(builder.getInt32Ty(), UserDataMapping::SpillTable, &userDataUsage->spillTable.entryArgIdx);
+      --userDataEnd;
+    } else if (!spillTableArg->argIndex) {
+      // This is the compute-with-calls case that we reserved s15 for the spill table pointer above,
+      // without setting its PAL metadata or spillTable.entryArgIdx, but now we find we do need to set
+      // them.
+      spillTableArg =
+          UserDataArg(builder.getInt32Ty(), UserDataMapping::SpillTable, &userDataUsage->spillTable.entryArgIdx);
+    }
 
-  for (const UserDataArg &userDataArg : userDataArgs) {
-    unsigned afterUserDataIdx = userDataIdx + userDataArg.argDwordSize;
-    if (afterUserDataIdx > userDataEnd) {
-      // Spill this node. Allocate the spill table arg.
-      if (!spillTableArg.hasValue()) {
-        spillTableArg =
-            UserDataArg(builder.getInt32Ty(), UserDataMapping::SpillTable, &userDataUsage->spillTable.entryArgIdx);
-        --userDataEnd;
-
-        if (userDataIdx > userDataEnd) {
-          // We over-ran the available SGPRs by filling them up and then realizing we needed a spill table pointer.
-          // Remove the last unspilled node (and any padding arg before that), and ensure that spill usage is
-          // set correctly so that PAL metadata spill threshold is correct.
-          // (Note that this path cannot happen in compute-with-calls, because we pre-reserved a slot for the
-          // spill table pointer.)
-          userDataIdx -= unspilledArgs.back().argDwordSize;
-          userDataUsage->spillUsage = std::min(userDataUsage->spillUsage, unspilledArgs.back().userDataValue);
-          unspilledArgs.pop_back();
-        }
-      } else if (!spillTableArg->argIndex) {
-        // This is the compute-with-calls case that we reserved s15 for the spill table pointer above,
-        // without setting its PAL metadata or spillTable.entryArgIdx, but now we find we do need to set
-        // them.
-        spillTableArg =
-            UserDataArg(builder.getInt32Ty(), UserDataMapping::SpillTable, &userDataUsage->spillTable.entryArgIdx);
+    // Decide which ones to keep. Args that are not user data nodes (such as the global table) take priority, then
+    // nodes in decreasing order of static access weight, so a descriptor set used in a loop is not spilled to make
+    // room for a push constant that is read once. Nodes of equal weight keep layout order. Compute-with-calls
+    // keeps layout order throughout, as its user data must not depend on the code in this shader.
+    bool useWeights = cl::WeightedUserDataSpill && !isComputeWithCalls();
+    SmallVector<uint64_t, 8> weights;
+    SmallVector<unsigned, 8> order;
+    for (const UserDataArg &userDataArg : userDataArgs) {
+      order.push_back(weights.size());
+      weights.push_back(useWeights && userDataArg.usage ? getUserDataWeight(*userDataArg.usage) : UINT64_MAX);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](unsigned lhs, unsigned rhs) { return weights[lhs] > weights[rhs]; });
+
+    unsigned userDataIdx = 0;
+    for (unsigned argIdx : order) {
+      const UserDataArg &userDataArg = userDataArgs[argIdx];
+      if (userDataIdx + userDataArg.argDwordSize <= userDataEnd) {
+        userDataIdx += userDataArg.argDwordSize;
+        continue;
       }
-
-      // Ensure that spillUsage includes this offset. (We might be on a compute shader padding node, in which
-      // case userDataArg.userDataValue is Invalid, and this call has no effect.)
+      // Spill this node. Ensure that spillUsage includes this offset. (We might be on a compute shader padding
+      // node, in which case userDataArg.userDataValue is Invalid, and this call has no effect.)
+      spilled[argIdx] = true;
       userDataUsage->spillUsage = std::min(userDataUsage->spillUsage, userDataArg.userDataValue);
+    }
+  }
 
+  // Copy the unspilled ones across to unspilledArgs, keeping them in layout order.
+  unsigned userDataIdx = 0;
+  for (unsigned argIdx = 0; argIdx != userDataArgs.size(); ++argIdx) {
+    if (spilled[argIdx])
       continue;
-    }
-    // Keep this node on the unspilled list.
-    userDataIdx = afterUserDataIdx;
-    unspilledArgs.push_back(userDataArg);
+    userDataIdx += userDataArgs[argIdx].argDwordSize;
+    unspilledArgs.push_back(userDataArgs[argIdx]);
   }
 
   // For compute-with-calls, add extra padding unspilled args until we get to s15. s15 will then be used for
@@ -1483,6 +1516,31 @@ void PatchEntryPointMutate::determineUnspilledUserDataArgs(ArrayRef<UserDataArg>
     unspilledArgs.insert(unspilledArgs.end(), *spillTableArg);
 }
 
+// =====================================================================================================================
+// Get the static access weight of a user data node. Each use counts eight times as much for each level of loop it
+// is nested in, which is a crude estimate of how often it is executed.
+//
+// @param usage : Usage of the user data node
+uint64_t PatchEntryPointMutate::getUserDataWeight(const UserDataNodeUsage &usage) {
+  static const unsigned MaxLoopDepth = 8;
+  uint64_t weight = 0;
+  for (Instruction *user : usage.users) {
+    BasicBlock *block = user->getParent();
+    auto it = m_loopDepths.find(block);
+    if (it == m_loopDepths.end()) {
+      // First weighted use in this function. Record the loop depth of all its blocks. Blocks keep their
+      // identity when the entry-point is mutated, so this stays valid for the rest of the pass.
+      Function *func = block->getParent();
+      LoopInfo &loopInfo = getAnalysis<LoopInfoWrapperPass>(*func).getLoopInfo();
+      for (BasicBlock &funcBlock : *func)
+        m_loopDepths[&funcBlock] = loopInfo.getLoopDepth(&funcBlock);
+      it = m_loopDepths.find(block);
+    }
+    weight += uint64_t(1) << (3 * std::min(it->second, MaxLoopDepth));
+  }
+  return weight;
+}
+
 // =====================================================================================================================
 // Get UserDataUsage struct for the merged shader stage that contains the given shader stage
 //
@@ -29,10 +29,16 @@
  ***********************************************************************************************************************
  */
 #include "PatchLoadScalarizer.h"
+#include "lgc/state/IntrinsDefs.h"
 #include "lgc/state/PipelineShaders.h"
 #include "lgc/state/PipelineState.h"
+#include "lgc/state/ShaderStage.h"
+#include "llvm/Analysis/DivergenceAnalysis.h"
+#include "llvm/Analysis/LegacyDivergenceAnalysis.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -41,6 +47,17 @@
 using namespace lgc;
 using namespace llvm;
 
+namespace llvm {
+namespace cl {
+
+// -load-scalarizer-cost-model: Only scalarize divergent vector loads that have dead components, instead of every
+// vector load within the load scalarizer threshold.
+opt<bool> LoadScalarizerCostModel("load-scalarizer-cost-model",
+                                  desc("Decide per load whether scalarizing it is profitable"), init(true));
+
+} // namespace cl
+} // namespace llvm
+
 namespace lgc {
 
 // =====================================================================================================================
@@ -54,8 +71,7 @@ FunctionPass *createPatchLoadScalarizer() {
 }
 
 // =====================================================================================================================
-PatchLoadScalarizer::PatchLoadScalarizer() : FunctionPass(ID) {
-  m_scalarThreshold = 0;
+PatchLoadScalarizer::PatchLoadScalarizer() : FunctionPass(ID), m_scalarThreshold(0) {
 }
 
 // =====================================================================================================================
@@ -63,6 +79,7 @@ PatchLoadScalarizer::PatchLoadScalarizer() : FunctionPass(ID) {
 //
 // @param [out] analysisUsage : The analysis usage.
 void PatchLoadScalarizer::getAnalysisUsage(AnalysisUsage &analysisUsage) const {
+  analysisUsage.addRequired<LegacyDivergenceAnalysis>();
   analysisUsage.addRequired<PipelineStateWrapper>();
   analysisUsage.addRequired<PipelineShaders>();
   analysisUsage.addPreserved<PipelineShaders>();
@@ -77,8 +94,46 @@ bool PatchLoadScalarizer::runOnFunction(Function &function) {
 
   auto pipelineState = getAnalysis<PipelineStateWrapper>().getPipelineState(function.getParent());
   auto pipelineShaders = &getAnalysis<PipelineShaders>();
-  auto shaderStage = pipelineShaders->getShaderStage(&function);
+  ShaderStage shaderStage = pipelineShaders->getShaderStage(&function);
+  if (shaderStage == ShaderStageInvalid)
+    return false;
+  auto &divergenceAnalysis = getAnalysis<LegacyDivergenceAnalysis>();
+  return scalarizeLoads(function, pipelineState, shaderStage,
+                        [&](const Value *value) { return divergenceAnalysis.isDivergent(value); });
+}
 
+// =====================================================================================================================
+// Executes this LLVM pass on the specified LLVM function, when run in the new pass manager. The uniformity of the load
+// addresses comes from the new pass manager's divergence analysis.
+//
+// @param [in/out] function : Function that will run this optimization.
+// @param [in/out] analysisManager : Function analysis manager
+PreservedAnalyses PatchLoadScalarizerPass::run(Function &function, FunctionAnalysisManager &analysisManager) {
+  ShaderStage shaderStage = isShaderEntryPoint(&function) ? getShaderStage(&function) : ShaderStageInvalid;
+  if (shaderStage == ShaderStageInvalid || m_pipelineState->getShaderOptions(shaderStage).loadScalarizerThreshold == 0)
+    return PreservedAnalyses::all();
+
+  auto &divergenceInfo = analysisManager.getResult<DivergenceAnalysis>(function);
+  PatchLoadScalarizer loadScalarizer;
+  if (!loadScalarizer.scalarizeLoads(function, m_pipelineState, shaderStage,
+                                     [&](const Value *value) { return divergenceInfo.isDivergent(*value); }))
+    return PreservedAnalyses::all();
+
+  PreservedAnalyses preservedAnalyses;
+  preservedAnalyses.preserveSet<CFGAnalyses>();
+  return preservedAnalyses;
+}
+
+// =====================================================================================================================
+// Scalarize the vector loads in the function, if enabled for its shader stage.
+//
+// @param [in/out] function : Function that will run this optimization.
+// @param pipelineState : Pipeline state
+// @param shaderStage : Shader stage of the function, or ShaderStageInvalid if it is not a shader entry-point
+// @param isDivergent : Divergence analysis query for a value of the function
+// @returns : True if the function was modified
+bool PatchLoadScalarizer::scalarizeLoads(Function &function, PipelineState *pipelineState, ShaderStage shaderStage,
+                                         function_ref<bool(const Value *)> isDivergent) {
   // If the function is not a valid shader stage, or the optimization is disabled, bail.
   m_scalarThreshold = 0;
   if (shaderStage != ShaderStageInvalid)
@@ -86,6 +141,7 @@ bool PatchLoadScalarizer::runOnFunction(Function &function) {
   if (m_scalarThreshold == 0)
     return false;
 
+  m_isDivergent = isDivergent;
   m_builder = std::make_unique<IRBuilder<>>(function.getContext());
 
   visit(function);
@@ -101,6 +157,49 @@ bool PatchLoadScalarizer::runOnFunction(Function &function) {
   return changed;
 }
 
+// =====================================================================================================================
+// Decide whether scalarizing a vector load is profitable, and find which of its components are used.
+//
+// A uniform, dword-aligned load from constant or buffer memory is kept wide, so that it can be selected as a single
+// scalar memory load. Otherwise, the load is only split when some of its components are never used, so that the
+// dead components are not fetched at all; a divergent load whose components are all used is cheaper as one wide
+// vector memory load.
+//
+// @param loadInst : The vector load instruction
+// @param compCount : Number of components of the loaded vector
+// @param [out] usedComps : Components of the loaded vector that are used
+// @returns : True if the load should be scalarized
+bool PatchLoadScalarizer::shouldScalarize(LoadInst &loadInst, unsigned compCount, SmallBitVector &usedComps) const {
+  usedComps.clear();
+  usedComps.resize(compCount);
+  if (!cl::LoadScalarizerCostModel) {
+    usedComps.set();
+    return true;
+  }
+
+  // Only a constant-index extractelement uses a single component; any other use needs the whole vector.
+  for (User *user : loadInst.users()) {
+    auto extractElement = dyn_cast<ExtractElementInst>(user);
+    auto index = extractElement ? dyn_cast<ConstantInt>(extractElement->getIndexOperand()) : nullptr;
+    if (!index || index->getZExtValue() >= compCount) {
+      usedComps.set();
+      break;
+    }
+    usedComps.set(index->getZExtValue());
+  }
+
+  // Leave a dead load to dead code elimination.
+  if (usedComps.none())
+    return false;
+
+  const unsigned addrSpace = loadInst.getPointerAddressSpace();
+  if (!m_isDivergent(loadInst.getPointerOperand()) &&
+      (addrSpace == ADDR_SPACE_CONST || addrSpace == ADDR_SPACE_BUFFER_FAT_POINTER) && loadInst.getAlignment() >= 4)
+    return false;
+
+  return !usedComps.all();
+}
+
 // =====================================================================================================================
 // Visits "load" instruction.
 //
@@ -132,6 +231,10 @@ void PatchLoadScalarizer::visitLoadInst(LoadInst &loadInst) {
     if (compCount > m_scalarThreshold)
       return;
 
+    SmallBitVector usedComps;
+    if (!shouldScalarize(loadInst, compCount, usedComps))
+      return;
+
     Type *compTy = cast<VectorType>(loadTy)->getElementType();
     uint64_t compSize = loadInst.getModule()->getDataLayout().getTypeStoreSize(compTy);
 
@@ -150,6 +253,9 @@ void PatchLoadScalarizer::visitLoadInst(LoadInst &loadInst) {
                                                  loadInst.getPointerOperand()->getName() + ".i0");
 
     for (unsigned i = 0; i < compCount; i++) {
+      // Unused components are not loaded, and are left undefined in the rebuilt vector.
+      if (!usedComps[i])
+        continue;
       Value *loadCompPtr = m_builder->CreateConstGEP1_32(compTy, newLoadPtr, i,
                                                          loadInst.getPointerOperand()->getName() + ".i" + Twine(i));
       // Calculate the alignment of component i
@@ -163,6 +269,8 @@ void PatchLoadScalarizer::visitLoadInst(LoadInst &loadInst) {
     }
 
     for (unsigned i = 0; i < compCount; i++) {
+      if (!usedComps[i])
+        continue;
       loadValue = m_builder->CreateInsertElement(loadValue, loadComps[i], m_builder->getInt32(i),
                                                  loadInst.getName() + ".u" + Twine(i));
     }
@@ -177,4 +285,6 @@ void PatchLoadScalarizer::visitLoadInst(LoadInst &loadInst) {
 
 // =====================================================================================================================
 // Initializes the pass of LLVM patching operations for load scalarizer optimization.
-INITIALIZE_PASS(PatchLoadScalarizer, DEBUG_TYPE, "Patch LLVM for load scalarizer optimization", false, false)
+INITIALIZE_PASS_BEGIN(PatchLoadScalarizer, DEBUG_TYPE, "Patch LLVM for load scalarizer optimization", false, false)
+INITIALIZE_PASS_DEPENDENCY(LegacyDivergenceAnalysis)
+INITIALIZE_PASS_END(PatchLoadScalarizer, DEBUG_TYPE, "Patch LLVM for load scalarizer optimization", false, false)
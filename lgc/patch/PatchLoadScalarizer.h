@@ -32,10 +32,15 @@
 
 #include "lgc/Builder.h"
 #include "lgc/patch/Patch.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallBitVector.h"
 #include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/PassManager.h"
 
 namespace lgc {
 
+class PipelineState;
+
 // =====================================================================================================================
 // Represents the pass of LLVM patching operations for scalarize load.
 class PatchLoadScalarizer final : public llvm::FunctionPass, public llvm::InstVisitor<PatchLoadScalarizer> {
@@ -45,6 +50,9 @@ public:
   void getAnalysisUsage(llvm::AnalysisUsage &analysisUsage) const override;
   bool runOnFunction(llvm::Function &function) override;
 
+  bool scalarizeLoads(llvm::Function &function, PipelineState *pipelineState, ShaderStage shaderStage,
+                      llvm::function_ref<bool(const llvm::Value *)> isDivergent);
+
   void visitLoadInst(llvm::LoadInst &loadInst);
 
   static char ID; // ID of this pass
@@ -53,9 +61,24 @@ private:
   PatchLoadScalarizer(const PatchLoadScalarizer &) = delete;
   PatchLoadScalarizer &operator=(const PatchLoadScalarizer &) = delete;
 
-  llvm::SmallVector<llvm::Instruction *, 8> m_instsToErase; // Instructions to erase
-  std::unique_ptr<llvm::IRBuilder<>> m_builder;             // The IRBuilder.
-  unsigned m_scalarThreshold;                               // The threshold for load scalarizer
+  bool shouldScalarize(llvm::LoadInst &loadInst, unsigned compCount, llvm::SmallBitVector &usedComps) const;
+
+  llvm::SmallVector<llvm::Instruction *, 8> m_instsToErase;    // Instructions to erase
+  std::unique_ptr<llvm::IRBuilder<>> m_builder;                // The IRBuilder.
+  unsigned m_scalarThreshold;                                  // The threshold for load scalarizer
+  llvm::function_ref<bool(const llvm::Value *)> m_isDivergent; // Divergence analysis query
+};
+
+// =====================================================================================================================
+// New pass manager version of PatchLoadScalarizer.
+class PatchLoadScalarizerPass : public llvm::PassInfoMixin<PatchLoadScalarizerPass> {
+public:
+  explicit PatchLoadScalarizerPass(PipelineState *pipelineState) : m_pipelineState(pipelineState) {}
+
+  llvm::PreservedAnalyses run(llvm::Function &function, llvm::FunctionAnalysisManager &analysisManager);
+
+private:
+  PipelineState *m_pipelineState; // Pipeline state
 };
 
 } // namespace lgc
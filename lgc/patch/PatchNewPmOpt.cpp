@@ -0,0 +1,103 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  PatchNewPmOpt.cpp
+ * @brief LLPC source file: contains declaration and implementation of class lgc::PatchNewPmOpt.
+ ***********************************************************************************************************************
+ */
+#include "lgc/LgcContext.h"
+#include "lgc/PassManager.h"
+#include "lgc/patch/Patch.h"
+#include "lgc/state/PipelineState.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "lgc-patch-new-pm-opt"
+
+using namespace llvm;
+using namespace lgc;
+
+namespace {
+
+// =====================================================================================================================
+// Represents the pass that runs one part of the curated optimization set in the new pass manager, so that analyses
+// are computed once and shared between the optimization passes instead of being recomputed for each of them. This
+// is an experiment enabled by -lgc-new-pass-manager: it is a legacy pass wrapping a new pass manager, so that it can
+// sit in the legacy patch pipeline, which has not been ported.
+class PatchNewPmOpt final : public ModulePass {
+public:
+  PatchNewPmOpt(unsigned part = 0, const OptimizationSchedule &optSchedule = {})
+      : ModulePass(ID), m_part(part), m_optSchedule(optSchedule) {}
+
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override {
+    analysisUsage.addRequired<PipelineStateWrapper>();
+  }
+
+  bool runOnModule(Module &module) override;
+
+  static char ID; // ID of this pass
+
+private:
+  PatchNewPmOpt(const PatchNewPmOpt &) = delete;
+  PatchNewPmOpt &operator=(const PatchNewPmOpt &) = delete;
+
+  unsigned m_part;                   // Part of the optimization set to run (see Patch::addOptimizationPasses)
+  OptimizationSchedule m_optSchedule; // Optimization pass schedule
+};
+
+} // anonymous namespace
+
+char PatchNewPmOpt::ID = 0;
+
+// =====================================================================================================================
+// Create the pass that runs one part of the curated optimization set in the new pass manager
+//
+// @param part : Part of the optimization set to run
+// @param optSchedule : Optimization pass schedule
+ModulePass *lgc::createPatchNewPmOpt(unsigned part, const OptimizationSchedule &optSchedule) {
+  return new PatchNewPmOpt(part, optSchedule);
+}
+
+// =====================================================================================================================
+// Executes this LLVM pass on the specified LLVM module.
+//
+// @param [in/out] module : LLVM module to be run on
+// @returns : True if the module was modified by the transformation and false otherwise
+bool PatchNewPmOpt::runOnModule(Module &module) {
+  LLVM_DEBUG(dbgs() << "Run the pass Patch-New-Pm-Opt (part " << m_part << ")\n");
+
+  PipelineState *pipelineState = getAnalysis<PipelineStateWrapper>().getPipelineState(&module);
+  LgcContext *lgcContext = pipelineState->getLgcContext();
+
+  std::unique_ptr<NewPassManager> passMgr(NewPassManager::Create(lgcContext->getTargetMachine()));
+  lgcContext->preparePassManager(&*passMgr);
+  Patch::addOptimizationPasses(*passMgr, pipelineState, m_optSchedule, m_part);
+  passMgr->run(module);
+  return true;
+}
+
+// =====================================================================================================================
+// Initializes the pass that runs the curated optimization set in the new pass manager.
+INITIALIZE_PASS(PatchNewPmOpt, DEBUG_TYPE, "Run optimizations in the new pass manager", false, false)
@@ -75,17 +75,33 @@ bool PatchPeepholeOpt::runOnFunction(Function &function) {
 
   visit(function);
 
-  const bool changed = !m_instsToErase.empty();
+  const bool changed = m_changed || !m_instsToErase.empty();
 
   for (Instruction *const inst : m_instsToErase) {
     // Lastly delete any instructions we replaced.
     inst->eraseFromParent();
   }
   m_instsToErase.clear();
+  m_changed = false;
 
   return changed;
 }
 
+// =====================================================================================================================
+// Executes this LLVM pass on the specified LLVM function, when run in the new pass manager.
+//
+// @param [in/out] function : Function that we will peephole optimize.
+// @param [in/out] analysisManager : Function analysis manager
+PreservedAnalyses PatchPeepholeOptPass::run(Function &function, FunctionAnalysisManager &analysisManager) {
+  PatchPeepholeOpt peepholeOpt;
+  if (!peepholeOpt.runOnFunction(function))
+    return PreservedAnalyses::all();
+
+  PreservedAnalyses preservedAnalyses;
+  preservedAnalyses.preserveSet<CFGAnalyses>();
+  return preservedAnalyses;
+}
+
 // =====================================================================================================================
 // Specify what analysis passes this pass depends on.
 //
@@ -284,6 +300,7 @@ void PatchPeepholeOpt::visitICmp(ICmpInst &iCmp) {
   // Swap the predicate to less than. This helps the loop analysis passes detect more loops that can be trivially
   // unrolled.
   iCmp.setPredicate(CmpInst::ICMP_ULT);
+  m_changed = true;
 
   // Set our new constant to the second operand.
   iCmp.setOperand(1, newConstant);
@@ -32,6 +32,7 @@
 
 #include "lgc/util/Internal.h"
 #include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 
 namespace lgc {
@@ -74,6 +75,14 @@ private:
   PatchPeepholeOpt &operator=(const PatchPeepholeOpt &) = delete;
 
   llvm::SmallVector<llvm::Instruction *, 8> m_instsToErase;
+  bool m_changed = false; // Whether an instruction was changed in place
+};
+
+// =====================================================================================================================
+// New pass manager version of PatchPeepholeOpt.
+class PatchPeepholeOptPass : public llvm::PassInfoMixin<PatchPeepholeOptPass> {
+public:
+  llvm::PreservedAnalyses run(llvm::Function &function, llvm::FunctionAnalysisManager &analysisManager);
 };
 
 } // namespace lgc
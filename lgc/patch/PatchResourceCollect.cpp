@@ -2297,7 +2297,9 @@ void PatchResourceCollect::clearUnusedOutput() {
   ShaderStage nextStage = m_pipelineState->getNextShaderStage(m_shaderStage);
   auto &inOutUsage = m_pipelineState->getShaderResourceUsage(m_shaderStage)->inOutUsage;
   auto &outputLocInfoMap = inOutUsage.outputLocInfoMap;
-  if (!m_pipelineState->isUnlinked() && nextStage != ShaderStageInvalid) {
+  // NOTE: In an unlinked half-pipeline, the next stage is only valid if it is in the same half-pipeline, so this
+  // matches the interfaces between the vertex-processing stages but not the one to the fragment shader.
+  if (nextStage != ShaderStageInvalid) {
     // Collect the locations of TCS with dynamic indexing or as imported output
     DenseSet<unsigned> dynIndexedOrImportOutputLocs;
     if (m_shaderStage == ShaderStageTessControl) {
@@ -0,0 +1,310 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  PatchWaterfallCoalesce.cpp
+ * @brief LLPC source file: contains declaration and implementation of class lgc::PatchWaterfallCoalesce.
+ *
+ * BuilderImplBase::createWaterfallLoop wraps each non-uniform image or buffer operation in its own waterfall loop,
+ * delimited by llvm.amdgcn.waterfall.begin and the waterfall.end or waterfall.last.use calls on its token. This pass
+ * runs after the optimizations have CSEd the traced non-uniform indices, and merges waterfall loops that follow each
+ * other in a basic block with the same index into one loop: the operations of the later loop are moved up into the
+ * earlier one, so that the loop of readfirstlanes over the index runs only once for all of them.
+ ***********************************************************************************************************************
+ */
+#include "lgc/patch/Patch.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsAMDGPU.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "lgc-patch-waterfall-coalesce"
+
+using namespace lgc;
+using namespace llvm;
+
+namespace llvm {
+namespace cl {
+
+// -coalesce-waterfall-loops: Merge adjacent waterfall loops on the same non-uniform index.
+opt<bool> CoalesceWaterfallLoops("coalesce-waterfall-loops",
+                                 desc("Merge adjacent waterfall loops on the same non-uniform index"), init(true));
+
+} // namespace cl
+} // namespace llvm
+
+namespace {
+
+// A waterfall loop: the instructions from its waterfall.begin to its tail, all in one basic block.
+struct WaterfallRegion {
+  CallInst *begin;                    // The waterfall.begin, whose result is the loop's token
+  Instruction *tail;                  // Last instruction of the loop
+  SmallVector<Instruction *, 2> ends; // The waterfall.end calls, in block order
+};
+
+class PatchWaterfallCoalesce final : public FunctionPass {
+public:
+  PatchWaterfallCoalesce();
+
+  bool runOnFunction(Function &function) override;
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override { analysisUsage.setPreservesCFG(); }
+
+  static char ID; // ID of this pass
+
+private:
+  PatchWaterfallCoalesce(const PatchWaterfallCoalesce &) = delete;
+  PatchWaterfallCoalesce &operator=(const PatchWaterfallCoalesce &) = delete;
+
+  bool getWaterfallRegion(CallInst *begin, WaterfallRegion &region) const;
+  bool mergeWaterfallRegions(WaterfallRegion &first, const WaterfallRegion &second);
+};
+
+} // anonymous namespace
+
+#if defined(LLVM_HAVE_BRANCH_AMD_GFX)
+// =====================================================================================================================
+// Get the non-uniform index that a waterfall.begin loops over, looking through the truncation to 32 bits that
+// createWaterfallLoop adds for a 64-bit index, so that loops on the same index compare equal even if each got its
+// own truncation.
+//
+// @param begin : The waterfall.begin
+static Value *getWaterfallIndex(CallInst *begin) {
+  Value *index = begin->getArgOperand(1);
+  if (auto trunc = dyn_cast<TruncInst>(index))
+    return trunc->getOperand(0);
+  return index;
+}
+#endif
+
+// =====================================================================================================================
+// Initializes static members.
+char PatchWaterfallCoalesce::ID = 0;
+
+// =====================================================================================================================
+// Pass creator, creates the pass of LLVM patching operations for waterfall loop coalescing.
+FunctionPass *lgc::createPatchWaterfallCoalesce() {
+  return new PatchWaterfallCoalesce();
+}
+
+// =====================================================================================================================
+PatchWaterfallCoalesce::PatchWaterfallCoalesce() : FunctionPass(ID) {
+}
+
+// =====================================================================================================================
+// Executes this LLVM pass on the specified LLVM function.
+//
+// @param [in/out] function : Function that we will coalesce waterfall loops in.
+bool PatchWaterfallCoalesce::runOnFunction(Function &function) {
+#if !defined(LLVM_HAVE_BRANCH_AMD_GFX)
+  return false;
+#else
+  if (!cl::CoalesceWaterfallLoops)
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Run the pass Patch-Waterfall-Coalesce\n");
+
+  bool changed = false;
+  for (BasicBlock &block : function) {
+    // Gather the waterfall loops of the block in order. A loop that uses more than one non-uniform index has a chain
+    // of waterfall.begin calls; such loops are left alone.
+    SmallVector<CallInst *, 4> begins;
+    for (Instruction &inst : block) {
+      if (auto begin = dyn_cast<IntrinsicInst>(&inst)) {
+        if (begin->getIntrinsicID() == Intrinsic::amdgcn_waterfall_begin && isa<ConstantInt>(begin->getArgOperand(0)))
+          begins.push_back(begin);
+      }
+    }
+    if (begins.size() < 2)
+      continue;
+
+    // Merge each loop into the loop before it where possible; a merged loop can then take in the next one too.
+    WaterfallRegion current = {};
+    bool haveCurrent = false;
+    for (CallInst *begin : begins) {
+      WaterfallRegion region = {};
+      if (!getWaterfallRegion(begin, region)) {
+        haveCurrent = false;
+        continue;
+      }
+      if (haveCurrent && getWaterfallIndex(current.begin) == getWaterfallIndex(region.begin) &&
+          current.begin->getArgOperand(1)->getType() == region.begin->getArgOperand(1)->getType() &&
+          mergeWaterfallRegions(current, region)) {
+        changed = true;
+        continue;
+      }
+      current = region;
+      haveCurrent = true;
+    }
+  }
+
+  return changed;
+#endif
+}
+
+// =====================================================================================================================
+// Get the extent of the waterfall loop started by the given waterfall.begin. Returns false if the loop does not have
+// the form that createWaterfallLoop generates, with everything in the block of the waterfall.begin.
+//
+// @param begin : The waterfall.begin
+// @param [out] region : The waterfall loop
+bool PatchWaterfallCoalesce::getWaterfallRegion(CallInst *begin, WaterfallRegion &region) const {
+#if !defined(LLVM_HAVE_BRANCH_AMD_GFX)
+  return false;
+#else
+  BasicBlock *block = begin->getParent();
+  region.begin = begin;
+  region.tail = begin;
+  region.ends.clear();
+
+  auto extendTail = [&](Instruction *inst) {
+    if (region.tail->comesBefore(inst))
+      region.tail = inst;
+  };
+
+  for (User *user : begin->users()) {
+    auto call = dyn_cast<IntrinsicInst>(user);
+    if (!call || call->getParent() != block)
+      return false;
+    switch (call->getIntrinsicID()) {
+    case Intrinsic::amdgcn_waterfall_readfirstlane:
+      break;
+    case Intrinsic::amdgcn_waterfall_end:
+      region.ends.push_back(call);
+      extendTail(call);
+      break;
+    case Intrinsic::amdgcn_waterfall_last_use:
+      // The operation using the descriptor from waterfall.last.use has no result, and is the end of the loop.
+      for (User *lastUseUser : call->users()) {
+        auto inst = dyn_cast<Instruction>(lastUseUser);
+        if (!inst || inst->getParent() != block)
+          return false;
+        extendTail(inst);
+      }
+      extendTail(call);
+      break;
+    default:
+      return false;
+    }
+  }
+
+  llvm::sort(region.ends, [](Instruction *lhs, Instruction *rhs) { return lhs->comesBefore(rhs); });
+
+  // Expect the waterfall.end calls together at the end of the loop, as createWaterfallLoop puts them.
+  if (!region.ends.empty()) {
+    unsigned endIdx = 0;
+    for (Instruction *inst = region.ends.front(); inst != region.tail->getNextNode(); inst = inst->getNextNode()) {
+      if (endIdx == region.ends.size() || inst != region.ends[endIdx])
+        return false;
+      ++endIdx;
+    }
+  }
+  return true;
+#endif
+}
+
+// =====================================================================================================================
+// Merge a waterfall loop into an earlier one on the same index in the same block, by moving the body of the second
+// loop to the end of the body of the first, and its waterfall.end calls after those of the first. Returns false,
+// without changing anything, if the instructions between the two loops stop the move.
+//
+// @param [in/out] first : The earlier waterfall loop, which is extended to take in the second
+// @param second : The later waterfall loop
+bool PatchWaterfallCoalesce::mergeWaterfallRegions(WaterfallRegion &first, const WaterfallRegion &second) {
+  if (!first.tail->comesBefore(second.begin))
+    return false;
+
+  // The body of the second loop goes before the waterfall.end calls of the first, or after its tail if it has none.
+  Instruction *bodyInsertPos = first.ends.empty() ? first.tail->getNextNode() : first.ends.front();
+
+  SmallPtrSet<Instruction *, 16> secondBody;
+  bool secondWritesMemory = false;
+  bool secondAccessesMemory = false;
+  Instruction *secondBodyEnd = second.ends.empty() ? second.tail->getNextNode() : second.ends.front();
+  for (Instruction *inst = second.begin->getNextNode(); inst != secondBodyEnd; inst = inst->getNextNode()) {
+    secondBody.insert(inst);
+    secondWritesMemory |= inst->mayWriteToMemory();
+    secondAccessesMemory |= inst->mayReadOrWriteMemory();
+  }
+
+  // The body of the second loop moves up past the waterfall.end calls of the first loop and the instructions between
+  // the loops. None of those may produce a value the body uses. None of the instructions between the loops may be an
+  // access to memory that the move reorders with one in the body, or a convergent operation such as another waterfall
+  // loop or a subgroup operation.
+  SmallPtrSet<Instruction *, 16> movedPast;
+  for (Instruction *inst = bodyInsertPos; inst != second.begin; inst = inst->getNextNode()) {
+    movedPast.insert(inst);
+    if (is_contained(first.ends, inst))
+      continue;
+    if (inst->mayHaveSideEffects() || (secondWritesMemory && inst->mayReadFromMemory()) ||
+        (secondAccessesMemory && inst->mayWriteToMemory()))
+      return false;
+    if (auto call = dyn_cast<CallInst>(inst)) {
+      if (call->isConvergent())
+        return false;
+    }
+  }
+  for (Instruction *inst : secondBody) {
+    for (Value *operand : inst->operands()) {
+      if (auto operandInst = dyn_cast<Instruction>(operand)) {
+        if (movedPast.count(operandInst))
+          return false;
+      }
+    }
+  }
+
+  LLVM_DEBUG(dbgs() << "Merging waterfall loop " << *second.begin << " into " << *first.begin << "\n");
+
+  // Move the body, then the waterfall.end calls, of the second loop.
+  Instruction *endInsertPos = first.tail->getNextNode();
+  for (Instruction *inst = second.begin->getNextNode(); inst != secondBodyEnd;) {
+    Instruction *next = inst->getNextNode();
+    inst->moveBefore(bodyInsertPos);
+    inst = next;
+  }
+  Instruction *newTail = first.tail;
+  for (Instruction *end : second.ends) {
+    end->moveBefore(endInsertPos);
+    newTail = end;
+  }
+  if (second.ends.empty())
+    newTail = second.tail;
+
+  // The second loop now runs on the token of the first.
+  second.begin->replaceAllUsesWith(first.begin);
+  second.begin->eraseFromParent();
+
+  first.ends.append(second.ends.begin(), second.ends.end());
+  if (first.ends.empty() || !second.ends.empty())
+    first.tail = newTail;
+  return true;
+}
+
+// =====================================================================================================================
+// Initializes the pass of LLVM patching operations for waterfall loop coalescing.
+INITIALIZE_PASS(PatchWaterfallCoalesce, DEBUG_TYPE, "Patch LLVM for waterfall loop coalescing", false, false)
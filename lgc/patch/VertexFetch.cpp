@@ -38,15 +38,26 @@
 #include "lgc/state/PipelineState.h"
 #include "lgc/state/TargetInfo.h"
 #include "lgc/util/Internal.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
 
 #define DEBUG_TYPE "lgc-vertex-fetch"
 
 using namespace lgc;
 using namespace llvm;
 
+namespace llvm {
+namespace cl {
+
+// -coalesce-vertex-fetch: fetch vertex inputs that are adjacent in the same vertex buffer with shared wider fetches
+opt<bool> CoalesceVertexFetch("coalesce-vertex-fetch", desc("Coalesce fetches of adjacent vertex inputs"), init(true));
+
+} // namespace cl
+} // namespace llvm
+
 namespace lgc {
 class BuilderBase;
 class PipelineState;
@@ -102,6 +113,10 @@ public:
   Value *fetchVertex(Type *inputTy, const VertexInputDescription *description, unsigned location, unsigned compIdx,
                      BuilderBase &builder) override;
 
+  // Generate code to fetch several vertex values, coalescing fetches of adjacent inputs
+  void fetchVertices(ArrayRef<VertexFetchInfo> fetches, ArrayRef<const VertexInputDescription *> descriptions,
+                     SmallVectorImpl<Value *> &vertices, BuilderBase &builder) override;
+
 private:
   void initialize(PipelineState *pipelineState);
 
@@ -119,6 +134,16 @@ private:
 
   Value *loadVertexBufferDescriptor(unsigned binding, BuilderBase &builder);
 
+  Value *getVertexBufferIndex(const VertexInputDescription *description, BuilderBase &builder);
+
+  static bool canCoalesce(const VertexInputDescription *description);
+
+  void fetchCoalescedInputs(ArrayRef<const VertexInputDescription *> run,
+                            DenseMap<const VertexInputDescription *, Value *> &inputFetches, BuilderBase &builder);
+
+  Value *finalizeVertexFetch(Value *vertexFetch, Type *inputTy, unsigned location, unsigned compIdx,
+                             Instruction *insertPos);
+
   void addVertexFetchInst(Value *vbDesc, unsigned numChannels, bool is16bitFetch, Value *vbIndex, unsigned offset,
                           unsigned stride, unsigned dfmt, unsigned nfmt, Instruction *insertPos, Value **ppFetch) const;
 
@@ -379,27 +404,38 @@ bool LowerVertexFetch::runOnModule(Module &module) {
 
   if (!pipelineState->isUnlinked() || !pipelineState->getVertexInputDescriptions().empty()) {
     // Whole-pipeline compilation (or shader compilation where we were given the vertex input descriptions).
-    // Lower each vertex fetch.
-    for (CallInst *call : vertexFetches) {
-      Value *vertex = nullptr;
-
-      // Find the vertex input description.
-      unsigned location = cast<ConstantInt>(call->getArgOperand(0))->getZExtValue();
-      unsigned component = cast<ConstantInt>(call->getArgOperand(1))->getZExtValue();
-      const VertexInputDescription *description = pipelineState->findVertexInputDescription(location);
-
-      if (!description) {
-        // If we could not find vertex input info matching this location, just return undefined value.
-        vertex = UndefValue::get(call->getType());
-      } else {
-        // Fetch the vertex.
-        builder.SetInsertPoint(call);
-        vertex = vertexFetch->fetchVertex(call->getType(), description, location, component, builder);
+    // Lower the vertex fetches a block at a time, so that fetches of inputs that are adjacent in the same vertex
+    // buffer can be coalesced. The fetch code for a block goes where its first vertex fetch call was.
+    MapVector<BasicBlock *, SmallVector<CallInst *, 8>> blockFetches;
+    for (CallInst *call : vertexFetches)
+      blockFetches[call->getParent()].push_back(call);
+
+    for (auto &it : blockFetches) {
+      SmallVectorImpl<CallInst *> &calls = it.second;
+      llvm::sort(calls, [](CallInst *lhs, CallInst *rhs) { return lhs->comesBefore(rhs); });
+
+      // Find the vertex input description of each one. If we could not find vertex input info matching a
+      // location, fetchVertices gives nullptr for it, and we just return undefined value.
+      SmallVector<VertexFetchInfo, 8> fetches;
+      SmallVector<const VertexInputDescription *, 8> descriptions;
+      for (CallInst *call : calls) {
+        unsigned location = cast<ConstantInt>(call->getArgOperand(0))->getZExtValue();
+        unsigned component = cast<ConstantInt>(call->getArgOperand(1))->getZExtValue();
+        fetches.push_back({location, component, call->getType()});
+        descriptions.push_back(pipelineState->findVertexInputDescription(location));
       }
 
-      // Replace and erase this call.
-      call->replaceAllUsesWith(vertex);
-      call->eraseFromParent();
+      // Fetch the vertices.
+      SmallVector<Value *, 8> vertices;
+      builder.SetInsertPoint(calls.front());
+      vertexFetch->fetchVertices(fetches, descriptions, vertices, builder);
+
+      // Replace and erase the calls.
+      for (unsigned idx = 0; idx != calls.size(); ++idx) {
+        Value *vertex = vertices[idx] ? vertices[idx] : UndefValue::get(calls[idx]->getType());
+        calls[idx]->replaceAllUsesWith(vertex);
+        calls[idx]->eraseFromParent();
+      }
     }
 
     return true;
@@ -527,46 +563,15 @@ VertexFetchImpl::VertexFetchImpl(LgcContext *lgcContext)
 // @param builder : Builder to use to insert vertex fetch instructions
 Value *VertexFetchImpl::fetchVertex(Type *inputTy, const VertexInputDescription *description, unsigned location,
                                     unsigned compIdx, BuilderBase &builder) {
-  Value *vertex = nullptr;
   Instruction *insertPos = &*builder.GetInsertPoint();
   auto vbDesc = loadVertexBufferDescriptor(description->binding, builder);
-
-  Value *vbIndex = nullptr;
-  if (description->inputRate == VertexInputRateVertex) {
-    // Use vertex index
-    if (!m_vertexIndex) {
-      auto savedInsertPoint = builder.saveIP();
-      builder.SetInsertPoint(&*insertPos->getFunction()->front().getFirstInsertionPt());
-      m_vertexIndex = ShaderInputs::getVertexIndex(builder);
-      builder.restoreIP(savedInsertPoint);
-    }
-    vbIndex = m_vertexIndex;
-  } else {
-    if (description->inputRate == VertexInputRateNone) {
-      vbIndex = ShaderInputs::getSpecialUserData(UserDataMapping::BaseInstance, builder);
-    } else if (description->inputRate == VertexInputRateInstance) {
-      // Use instance index
-      if (!m_instanceIndex) {
-        auto savedInsertPoint = builder.saveIP();
-        builder.SetInsertPoint(&*insertPos->getFunction()->front().getFirstInsertionPt());
-        m_instanceIndex = ShaderInputs::getInstanceIndex(builder);
-        builder.restoreIP(savedInsertPoint);
-      }
-      vbIndex = m_instanceIndex;
-    } else {
-      // There is a divisor.
-      vbIndex = builder.CreateUDiv(ShaderInputs::getInput(ShaderInput::InstanceId, builder),
-                                   builder.getInt32(description->inputRate));
-      vbIndex = builder.CreateAdd(vbIndex, ShaderInputs::getSpecialUserData(UserDataMapping::BaseInstance, builder));
-    }
-  }
+  Value *vbIndex = getVertexBufferIndex(description, builder);
 
   Value *vertexFetches[2] = {}; // Two vertex fetch operations might be required
   Value *vertexFetch = nullptr; // Coalesced vector by combining the results of two vertex fetch operations
 
   VertexFormatInfo formatInfo = getVertexFormatInfo(description);
 
-  const bool is8bitFetch = (inputTy->getScalarSizeInBits() == 8);
   const bool is16bitFetch = (inputTy->getScalarSizeInBits() == 16);
 
   // Do the first vertex fetch operation
@@ -701,6 +706,220 @@ Value *VertexFetchImpl::fetchVertex(Type *inputTy, const VertexInputDescription
   } else
     vertexFetch = vertexFetches[0];
 
+  return finalizeVertexFetch(vertexFetch, inputTy, location, compIdx, insertPos);
+}
+
+// =====================================================================================================================
+// Generate code to fetch several vertex values, coalescing the fetches of inputs that are adjacent in the same
+// vertex buffer.
+//
+// An input can share a fetch with others when it has 32-bit components in a 32-bit per-component format, as then the
+// typed fetch is just a copy of the bits whatever the numeric format. Such inputs in the same binding and input rate
+// whose byte ranges follow on from each other form a run, which is fetched with as few wide fetches as the alignment
+// allows, and the components of each input are then extracted from the result. Everything else is fetched one input
+// at a time as before.
+//
+// @param fetches : Location, component and type of each vertex value to fetch
+// @param descriptions : Vertex input description for each vertex value, nullptr if none
+// @param [out] vertices : The fetched vertex values, nullptr for one with no description
+// @param builder : Builder to use to insert vertex fetch instructions
+void VertexFetchImpl::fetchVertices(ArrayRef<VertexFetchInfo> fetches,
+                                    ArrayRef<const VertexInputDescription *> descriptions,
+                                    SmallVectorImpl<Value *> &vertices, BuilderBase &builder) {
+  Instruction *insertPos = &*builder.GetInsertPoint();
+
+  // Find the inputs that can be coalesced. All vertex values fetched from an input must be 32-bit ones.
+  SmallVector<const VertexInputDescription *, 8> candidates;
+  if (cl::CoalesceVertexFetch) {
+    MapVector<const VertexInputDescription *, bool> inputs;
+    for (unsigned idx = 0; idx != fetches.size(); ++idx) {
+      const VertexInputDescription *description = descriptions[idx];
+      if (!description)
+        continue;
+      bool is32bit = fetches[idx].ty->getScalarSizeInBits() == 32;
+      auto it = inputs.insert({description, true}).first;
+      it->second = it->second && is32bit && canCoalesce(description);
+    }
+    for (const auto &input : inputs) {
+      if (input.second)
+        candidates.push_back(input.first);
+    }
+  }
+
+  // Sort them by binding, input rate and offset, and fetch each run of more than one adjacent input.
+  DenseMap<const VertexInputDescription *, Value *> inputFetches;
+  llvm::sort(candidates, [](const VertexInputDescription *lhs, const VertexInputDescription *rhs) {
+    return std::make_tuple(lhs->binding, lhs->inputRate, lhs->offset) <
+           std::make_tuple(rhs->binding, rhs->inputRate, rhs->offset);
+  });
+  for (unsigned runStart = 0, runEnd = 0; runStart != candidates.size(); runStart = runEnd) {
+    const VertexInputDescription *first = candidates[runStart];
+    unsigned endOffset = first->offset + getVertexComponentFormatInfo(first->dfmt)->vertexByteSize;
+    for (runEnd = runStart + 1; runEnd != candidates.size(); ++runEnd) {
+      const VertexInputDescription *next = candidates[runEnd];
+      if (next->binding != first->binding || next->inputRate != first->inputRate || next->offset != endOffset)
+        break;
+      endOffset += getVertexComponentFormatInfo(next->dfmt)->vertexByteSize;
+    }
+    // The coalesced fetch must stay within one element of the vertex buffer, so that it is bounds checked the same
+    // as the separate fetches would be.
+    if (runEnd - runStart > 1 && endOffset <= first->stride)
+      fetchCoalescedInputs(makeArrayRef(candidates).slice(runStart, runEnd - runStart), inputFetches, builder);
+  }
+
+  // Produce each vertex value, either from a coalesced fetch or by fetching its input on its own.
+  for (unsigned idx = 0; idx != fetches.size(); ++idx) {
+    const VertexFetchInfo &fetch = fetches[idx];
+    const VertexInputDescription *description = descriptions[idx];
+    Value *vertex = nullptr;
+    if (description) {
+      builder.SetInsertPoint(insertPos);
+      auto inputFetch = inputFetches.find(description);
+      if (inputFetch != inputFetches.end())
+        vertex = finalizeVertexFetch(inputFetch->second, fetch.ty, fetch.location, fetch.component, insertPos);
+      else
+        vertex = fetchVertex(fetch.ty, description, fetch.location, fetch.component, builder);
+    }
+    vertices.push_back(vertex);
+  }
+}
+
+// =====================================================================================================================
+// Checks whether a vertex input has a format that allows its fetch to be coalesced with those of adjacent inputs.
+//
+// @param description : Vertex input description
+bool VertexFetchImpl::canCoalesce(const VertexInputDescription *description) {
+  switch (description->dfmt) {
+  case BufDataFormat32:
+  case BufDataFormat32_32:
+  case BufDataFormat32_32_32:
+  case BufDataFormat32_32_32_32:
+    break;
+  default:
+    return false;
+  }
+  return description->nfmt == BufNumFormatUint || description->nfmt == BufNumFormatSint ||
+         description->nfmt == BufNumFormatFloat;
+}
+
+// =====================================================================================================================
+// Inserts instructions to fetch a run of adjacent vertex inputs with shared fetches. Each fetch is the widest
+// 32-bit-per-component format that the offset and stride are aligned for, so it is not split into per-component
+// fetches.
+//
+// @param run : Vertex input descriptions of the run, in offset order
+// @param [in/out] inputFetches : Map to add the fetched components of each input to, in the same form as the
+//                                result of a single fetch of that input
+// @param builder : Builder with insert point set
+void VertexFetchImpl::fetchCoalescedInputs(ArrayRef<const VertexInputDescription *> run,
+                                           DenseMap<const VertexInputDescription *, Value *> &inputFetches,
+                                           BuilderBase &builder) {
+  static const unsigned DataFormats[] = {BufDataFormat32, BufDataFormat32_32, BufDataFormat32_32_32,
+                                         BufDataFormat32_32_32_32};
+  Instruction *insertPos = &*builder.GetInsertPoint();
+  const VertexInputDescription *first = run.front();
+  Value *vbDesc = loadVertexBufferDescriptor(first->binding, builder);
+  Value *vbIndex = getVertexBufferIndex(first, builder);
+
+  // Fetch the dwords of the run.
+  unsigned dwordCount = 0;
+  for (const VertexInputDescription *description : run)
+    dwordCount += getVertexComponentFormatInfo(description->dfmt)->compCount;
+
+  SmallVector<Value *, 16> dwords;
+  while (dwords.size() != dwordCount) {
+    unsigned offset = first->offset + dwords.size() * 4;
+    unsigned numChannels = std::min(dwordCount - unsigned(dwords.size()), 4U);
+    for (; numChannels > 1; --numChannels) {
+      unsigned fetchByteSize = numChannels * 4;
+      if (offset % fetchByteSize == 0 && first->stride % fetchByteSize == 0)
+        break;
+    }
+
+    Value *fetch = nullptr;
+    addVertexFetchInst(vbDesc, numChannels, false, vbIndex, offset, first->stride, DataFormats[numChannels - 1],
+                       BufNumFormatUint, insertPos, &fetch);
+    if (numChannels == 1)
+      dwords.push_back(fetch);
+    else {
+      for (unsigned i = 0; i != numChannels; ++i)
+        dwords.push_back(ExtractElementInst::Create(fetch, ConstantInt::get(Type::getInt32Ty(*m_context), i), "",
+                                                    insertPos));
+    }
+  }
+
+  // Gather the components of each input.
+  unsigned dwordIdx = 0;
+  for (const VertexInputDescription *description : run) {
+    unsigned numChannels = getVertexComponentFormatInfo(description->dfmt)->compCount;
+    Value *inputFetch = dwords[dwordIdx];
+    if (numChannels != 1) {
+      inputFetch = UndefValue::get(FixedVectorType::get(Type::getInt32Ty(*m_context), numChannels));
+      for (unsigned i = 0; i != numChannels; ++i) {
+        inputFetch = InsertElementInst::Create(inputFetch, dwords[dwordIdx + i],
+                                               ConstantInt::get(Type::getInt32Ty(*m_context), i), "", insertPos);
+      }
+    }
+    inputFetches[description] = inputFetch;
+    dwordIdx += numChannels;
+  }
+}
+
+// =====================================================================================================================
+// Gets the index of the vertex buffer element to fetch a vertex input from.
+//
+// @param description : Vertex input description
+// @param builder : Builder with insert point set
+Value *VertexFetchImpl::getVertexBufferIndex(const VertexInputDescription *description, BuilderBase &builder) {
+  Instruction *insertPos = &*builder.GetInsertPoint();
+  Value *vbIndex = nullptr;
+  if (description->inputRate == VertexInputRateVertex) {
+    // Use vertex index
+    if (!m_vertexIndex) {
+      auto savedInsertPoint = builder.saveIP();
+      builder.SetInsertPoint(&*insertPos->getFunction()->front().getFirstInsertionPt());
+      m_vertexIndex = ShaderInputs::getVertexIndex(builder);
+      builder.restoreIP(savedInsertPoint);
+    }
+    vbIndex = m_vertexIndex;
+  } else {
+    if (description->inputRate == VertexInputRateNone) {
+      vbIndex = ShaderInputs::getSpecialUserData(UserDataMapping::BaseInstance, builder);
+    } else if (description->inputRate == VertexInputRateInstance) {
+      // Use instance index
+      if (!m_instanceIndex) {
+        auto savedInsertPoint = builder.saveIP();
+        builder.SetInsertPoint(&*insertPos->getFunction()->front().getFirstInsertionPt());
+        m_instanceIndex = ShaderInputs::getInstanceIndex(builder);
+        builder.restoreIP(savedInsertPoint);
+      }
+      vbIndex = m_instanceIndex;
+    } else {
+      // There is a divisor.
+      vbIndex = builder.CreateUDiv(ShaderInputs::getInput(ShaderInput::InstanceId, builder),
+                                   builder.getInt32(description->inputRate));
+      vbIndex = builder.CreateAdd(vbIndex, ShaderInputs::getSpecialUserData(UserDataMapping::BaseInstance, builder));
+    }
+  }
+
+  return vbIndex;
+}
+
+// =====================================================================================================================
+// Builds the vertex value from the result of the vertex fetch, filling in default values for components that the
+// vertex input format does not have.
+//
+// @param vertexFetch : Result of the vertex fetch, one i32 per component (two for a 64-bit component)
+// @param inputTy : Type of vertex input
+// @param location : Vertex input location (only used for an IR name, not for functionality)
+// @param compIdx : Index used for vector element indexing
+// @param insertPos : Where to insert instructions
+Value *VertexFetchImpl::finalizeVertexFetch(Value *vertexFetch, Type *inputTy, unsigned location, unsigned compIdx,
+                                            Instruction *insertPos) {
+  Value *vertex = nullptr;
+  const bool is8bitFetch = (inputTy->getScalarSizeInBits() == 8);
+  const bool is16bitFetch = (inputTy->getScalarSizeInBits() == 16);
+
   // Finalize vertex fetch
   Type *basicTy = inputTy->isVectorTy() ? cast<VectorType>(inputTy)->getElementType() : inputTy;
   const unsigned bitWidth = basicTy->getScalarSizeInBits();
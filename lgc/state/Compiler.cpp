@@ -47,6 +47,8 @@ using namespace llvm;
 namespace lgc {
 // Create BuilderReplayer pass
 ModulePass *createBuilderReplayer(Pipeline *pipeline);
+// Count the recorded Builder calls that BuilderReplayer may expand into a loop
+unsigned countBuilderReplayerLoops(const Module &module);
 ElfLinker *createElfLinkerImpl(PipelineState *pipelineState, llvm::ArrayRef<llvm::MemoryBufferRef> elfs);
 
 } // namespace lgc
@@ -175,9 +177,9 @@ Module *PipelineState::irLink(ArrayRef<Module *> modules, bool unlinked) {
 //                 timers[0]: patch passes
 //                 timers[1]: LLVM optimizations
 //                 timers[2]: codegen
-// @param otherElf : Optional ELF for the other half-pipeline when compiling an unlinked half-pipeline ELF.
-//                   Supplying this could allow more optimal code for writing/reading attribute values between
-//                   the two pipeline halves
+// @param otherElf : Optional ELF for the vertex-processing half-pipeline when compiling an unlinked fragment
+//                   half-pipeline ELF. The attribute interface is read from its PAL metadata, so the fragment
+//                   half reads each attribute from where the vertex-processing half exports it
 // @returns : True for success.
 //           False if irLink asked for an "unlinked" shader or half-pipeline, and there is some reason why the
 //           module cannot be compiled that way.  The client typically then does a whole-pipeline compilation
@@ -186,16 +188,23 @@ Module *PipelineState::irLink(ArrayRef<Module *> modules, bool unlinked) {
 bool PipelineState::generate(std::unique_ptr<Module> pipelineModule, raw_pwrite_stream &outStream,
                              Pipeline::CheckShaderCacheFunc checkShaderCacheFunc, ArrayRef<Timer *> timers,
                              MemoryBufferRef otherElf) {
-  assert(otherElf.getBuffer().empty() && "otherElf not supported yet");
-
   m_lastError.clear();
+
+  if (!otherElf.getBuffer().empty()) {
+    // Compiling a half-pipeline against the other half-pipeline ELF. Get the attribute interface out of it, and
+    // record it into IR so it is also seen by a PipelineState read back from IR in the BuilderRecorder case.
+    assert(m_unlinked && "otherElf only valid when compiling an unlinked half-pipeline");
+    if (!setOtherPartElf(otherElf))
+      return false;
+    recordOtherPartInterface(&*pipelineModule);
+  }
   unsigned passIndex = 1000;
   Timer *patchTimer = timers.size() >= 1 ? timers[0] : nullptr;
   Timer *optTimer = timers.size() >= 2 ? timers[1] : nullptr;
   Timer *codeGenTimer = timers.size() >= 3 ? timers[2] : nullptr;
 
   // Set up "whole pipeline" passes, where we have a single module representing the whole pipeline.
-  std::unique_ptr<PassManager> passMgr(PassManager::Create());
+  std::unique_ptr<PassManager> passMgr(PassManager::Create(getLgcContext()));
   passMgr->setPassIndex(&passIndex);
   passMgr->add(createTargetTransformInfoWrapperPass(getLgcContext()->getTargetMachine()->getTargetIRAnalysis()));
 
@@ -212,7 +221,10 @@ bool PipelineState::generate(std::unique_ptr<Module> pipelineModule, raw_pwrite_
     pipelineStateWrapper->setPipelineState(this);
 
   if (m_emitLgc) {
-    // -emit-lgc: Just write the module.
+    // -emit-lgc: Just write the module. Read the pipeline state from it and record it back first, so the output has
+    // the pipeline state blob even if the input had item-by-item pipeline state metadata.
+    readState(&*pipelineModule);
+    recordState(&*pipelineModule);
     passMgr->add(createPrintModulePass(outStream));
     passMgr->stop();
   }
@@ -222,8 +234,11 @@ bool PipelineState::generate(std::unique_ptr<Module> pipelineModule, raw_pwrite_
   if (!m_noReplayer)
     replayerPass = createBuilderReplayer(this);
 
-  // Patching.
-  Patch::addPasses(this, *passMgr, replayerPass, patchTimer, optTimer, checkShaderCacheFunc);
+  // Patching. The optimization pass schedule is picked from the size of the module. It is picked before the Builder
+  // calls are replayed, so count the loops that the replay will create along with those already in the IR.
+  unsigned replayerLoopCount = replayerPass ? countBuilderReplayerLoops(*pipelineModule) : 0;
+  Patch::addPasses(this, *passMgr, Patch::getOptimizationSchedule(*pipelineModule, replayerLoopCount), replayerPass,
+                   patchTimer, optTimer, checkShaderCacheFunc);
 
   // Add pass to clear pipeline state from IR
   passMgr->add(createPipelineStateClearer());
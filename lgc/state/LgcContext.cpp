@@ -31,6 +31,7 @@
 #include "lgc/LgcContext.h"
 #include "lgc/Builder.h"
 #include "lgc/PassManager.h"
+#include "lgc/patch/NggCullerLibrary.h"
 #include "lgc/patch/Patch.h"
 #include "lgc/state/PassManagerCache.h"
 #include "lgc/state/PipelineState.h"
@@ -41,6 +42,9 @@
 #include "llvm/Bitcode/BitcodeWriterPass.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/IR/IRPrintingPasses.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/OptBisect.h"
+#include "llvm/IR/PassInstrumentation.h"
 #include "llvm/InitializePasses.h"
 #include "llvm/Support/CodeGen.h"
 #include "llvm/Support/CommandLine.h"
@@ -70,6 +74,30 @@ void initializeBuilderReplayerPass(PassRegistry &);
 
 static codegen::RegisterCodeGenFlags CGF;
 
+namespace lgc {
+
+// =====================================================================================================================
+// Pass gate installed on the LLVM context while a cancel check is set: it skips optional passes once the compile has
+// been cancelled, and otherwise defers to the gate it replaced (such as -opt-bisect-limit).
+class CancelPassGate final : public OptPassGate {
+public:
+  CancelPassGate(LgcContext *lgcContext, OptPassGate *prevGate) : m_lgcContext(lgcContext), m_prevGate(prevGate) {}
+
+  bool shouldRunPass(const Pass *pass, StringRef irDescription) override {
+    if (m_lgcContext->isCancelled())
+      return false;
+    return !m_prevGate->isEnabled() || m_prevGate->shouldRunPass(pass, irDescription);
+  }
+
+  bool isEnabled() const override { return true; }
+
+private:
+  LgcContext *m_lgcContext; // LgcContext whose cancel check is polled
+  OptPassGate *m_prevGate;  // Pass gate replaced by this one
+};
+
+} // namespace lgc
+
 #ifndef NDEBUG
 static bool Initialized;
 #endif
@@ -205,12 +233,56 @@ LgcContext *LgcContext::Create(LLVMContext &context, StringRef gpuName, unsigned
 
   LLPC_OUTS("TargetMachine optimization level = " << cl::OptLevel << "\n");
 
+  builderContext->m_optLevel = cl::OptLevel;
   builderContext->m_targetMachine =
       target->createTargetMachine(triple, gpuName, "", targetOpts, Optional<Reloc::Model>(), None, cl::OptLevel);
   assert(builderContext->m_targetMachine);
   return builderContext;
 }
 
+// =====================================================================================================================
+// Set the optimization level used by the middle-end optimizations and code generation of subsequent compiles.
+//
+// @param level : Optimization level
+void LgcContext::setOptimizationLevel(CodeGenOpt::Level level) {
+  m_optLevel = level;
+  m_targetMachine->setOptLevel(level);
+}
+
+// =====================================================================================================================
+// Set the function used to poll whether the current compile has been cancelled, or clear it with an empty function.
+//
+// @param isCancelled : Function returning true if the compile has been cancelled
+void LgcContext::setCancelCheck(std::function<bool()> isCancelled) {
+  m_isCancelled = std::move(isCancelled);
+  m_cancelled = false;
+
+  if (m_isCancelled && !m_cancelPassGate) {
+    m_prevPassGate = &m_context.getOptPassGate();
+    m_cancelPassGate = new CancelPassGate(this, m_prevPassGate);
+    m_context.setOptPassGate(*m_cancelPassGate);
+  } else if (!m_isCancelled && m_cancelPassGate) {
+    m_context.setOptPassGate(*m_prevPassGate);
+    delete m_cancelPassGate;
+    m_cancelPassGate = nullptr;
+  }
+}
+
+// =====================================================================================================================
+// Check whether the current compile has been cancelled. The result is latched, so the cancel check is not polled
+// again once it has returned true.
+bool LgcContext::isCancelled() {
+  if (!m_cancelled && m_isCancelled)
+    m_cancelled = m_isCancelled();
+  return m_cancelled;
+}
+
+// =====================================================================================================================
+// Get the default optimization level, as set by the -opt option
+CodeGenOpt::Level LgcContext::getDefaultOptimizationLevel() {
+  return cl::OptLevel;
+}
+
 // =====================================================================================================================
 //
 // @param context : LLVM context to give each Builder
@@ -220,9 +292,11 @@ LgcContext::LgcContext(LLVMContext &context, unsigned palAbiVersion) : m_context
 
 // =====================================================================================================================
 LgcContext::~LgcContext() {
+  setCancelCheck(nullptr);
   delete m_targetMachine;
   delete m_targetInfo;
   delete m_passManagerCache;
+  delete m_nggCullerLibrary;
 }
 
 // =====================================================================================================================
@@ -246,12 +320,11 @@ Builder *LgcContext::createBuilder(Pipeline *pipeline, bool useBuilderRecorder)
 }
 
 // =====================================================================================================================
-// Prepare a pass manager. This manually adds a target-aware TLI pass, so middle-end optimizations do not think that
-// we have library functions.
+// Get the target library info to use in middle-end optimizations, so they do not think that we have library functions.
 //
-// @param [in/out] passMgr : Pass manager
-void LgcContext::preparePassManager(legacy::PassManager *passMgr) {
-  TargetLibraryInfoImpl targetLibInfo(getTargetMachine()->getTargetTriple());
+// @param targetMachine : Target machine
+static TargetLibraryInfoImpl getTargetLibraryInfo(TargetMachine *targetMachine) {
+  TargetLibraryInfoImpl targetLibInfo(targetMachine->getTargetTriple());
 
   // Adjust it to allow memcpy and memset.
   // TODO: Investigate why the latter is necessary. I found that
@@ -260,11 +333,34 @@ void LgcContext::preparePassManager(legacy::PassManager *passMgr) {
   // be an unfortunate interaction between LoopIdiomRecognize and fat pointer laundering.
   targetLibInfo.setAvailable(LibFunc_memcpy);
   targetLibInfo.setAvailable(LibFunc_memset);
+  return targetLibInfo;
+}
+
+// =====================================================================================================================
+// Prepare a pass manager. This manually adds a target-aware TLI pass, so middle-end optimizations do not think that
+// we have library functions.
+//
+// @param [in/out] passMgr : Pass manager
+void LgcContext::preparePassManager(legacy::PassManager *passMgr) {
+  TargetLibraryInfoImpl targetLibInfo = getTargetLibraryInfo(getTargetMachine());
 
   auto targetLibInfoPass = new TargetLibraryInfoWrapperPass(targetLibInfo);
   passMgr->add(targetLibInfoPass);
 }
 
+// =====================================================================================================================
+// Prepare a new pass manager. This sets a target-aware TLI, so middle-end optimizations do not think that we have
+// library functions, and makes it skip optional passes once the compile has been cancelled.
+//
+// @param [in/out] passMgr : Pass manager
+void LgcContext::preparePassManager(NewPassManager *passMgr) {
+  passMgr->setTargetLibraryInfo(getTargetLibraryInfo(getTargetMachine()));
+
+  // Skip optional passes once the compile has been cancelled.
+  passMgr->getInstrumentationCallbacks().registerShouldRunOptionalPassCallback(
+      [this](StringRef, Any) { return !isCancelled(); });
+}
+
 // =====================================================================================================================
 // Adds target passes to pass manager, depending on "-filetype" and "-emit-llvm" options
 //
@@ -322,3 +418,11 @@ PassManagerCache *LgcContext::getPassManagerCache() {
     m_passManagerCache = new PassManagerCache(this);
   return m_passManagerCache;
 }
+
+// =====================================================================================================================
+// Get NGG culler library
+NggCullerLibrary *LgcContext::getNggCullerLibrary() {
+  if (!m_nggCullerLibrary)
+    m_nggCullerLibrary = new NggCullerLibrary(this);
+  return m_nggCullerLibrary;
+}
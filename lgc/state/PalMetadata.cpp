@@ -47,6 +47,9 @@
 using namespace lgc;
 using namespace llvm;
 
+// First register of each of the ranges in the dense register table: persistent (SH), context and uconfig space.
+static const unsigned RegRangeBases[] = {0x2C00, 0xA000, 0xC000};
+
 // =====================================================================================================================
 // Construct empty object
 PalMetadata::PalMetadata(PipelineState *pipelineState) : m_pipelineState(pipelineState) {
@@ -101,6 +104,8 @@ void PalMetadata::initialize() {
   m_pipelineNode =
       m_document->getRoot().getMap(true)[Util::Abi::PalCodeObjectMetadataKey::Pipelines].getArray(true)[0].getMap(true);
   m_registers = m_pipelineNode[".registers"].getMap(true);
+  m_regSet.resize(RegRangeCount * RegRangeSize);
+  readRegisters(/*isGlueCode=*/false);
   m_userDataLimit = &m_pipelineNode[Util::Abi::PipelineMetadataKey::UserDataLimit];
   if (m_userDataLimit->isEmpty())
     *m_userDataLimit = 0U;
@@ -123,13 +128,25 @@ void PalMetadata::record(Module *module) {
   // Write the MsgPack document into an IR metadata node.
   // The IR named metadata node contains an MDTuple containing an MDString containing the msgpack data.
   std::string blob;
-  m_document->writeToBlob(blob);
+  writeToBlob(blob);
   MDString *abiMetaString = MDString::get(module->getContext(), blob);
   MDNode *abiMetaNode = MDNode::get(module->getContext(), abiMetaString);
   NamedMDNode *namedMeta = module->getOrInsertNamedMetadata(PalMetadataName);
   namedMeta->addOperand(abiMetaNode);
 }
 
+// =====================================================================================================================
+// Write the PAL metadata as a MsgPack blob. This is the only place that the register table is written into the
+// MsgPack document, which keeps the registers only in the table afterwards.
+//
+// @param [out] blob : String to write the MsgPack data to
+void PalMetadata::writeToBlob(std::string &blob) {
+  writeRegisters();
+  m_document->writeToBlob(blob);
+  m_pipelineNode[".registers"] = m_document->getMapNode();
+  m_registers = m_pipelineNode[".registers"].getMap(true);
+}
+
 // =====================================================================================================================
 // Read blob as PAL metadata and merge it into existing PAL metadata (if any)
 //
@@ -143,12 +160,16 @@ void PalMetadata::mergeFromBlob(llvm::StringRef blob, bool isGlueCode) {
   //    rather than appending.
   bool success = m_document->readFromBlob(
       blob, /*multi=*/false,
-      [isGlueCode](msgpack::DocNode *destNode, msgpack::DocNode srcNode, msgpack::DocNode mapKey) {
+      [](msgpack::DocNode *destNode, msgpack::DocNode srcNode, msgpack::DocNode mapKey) {
         // Allow array and map merging.
         if (srcNode.isMap() && destNode->isMap())
           return 0;
-        if (srcNode.isArray() && destNode->isArray())
+        if (srcNode.isArray() && destNode->isArray()) {
+          // Append, rather than merge, the attribute interface entries of the half-pipelines.
+          if (mapKey.isString() && mapKey.getString() == PipelineMetadataKey::ParamInterface)
+            return destNode->getArray().size();
           return 0;
+        }
         // Allow string merging as long as the two strings have the same value. If one string has a "_fetchless"
         // suffix, take the other one. This is for the benefit of the linker linking a fetch shader with a
         // fetchless VS.
@@ -171,46 +192,9 @@ void PalMetadata::mergeFromBlob(llvm::StringRef blob, bool isGlueCode) {
         // Disallow merging other than uint.
         if (destNode->getKind() != msgpack::Type::UInt || srcNode.getKind() != msgpack::Type::UInt)
           return -1;
-        // Special cases of uint merging.
-        if (mapKey.getKind() == msgpack::Type::UInt) {
-          switch (mapKey.getUInt()) {
-          case mmVGT_SHADER_STAGES_EN:
-            // Ignore new value of VGT_SHADER_STAGES_EN from glue shader, as it might accidentally make the VS
-            // wave32. (This relies on the glue shader's PAL metadata being merged into the vertex-processing
-            // half-pipeline, rather than the other way round.)
-            return 0;
-          case mmSPI_SHADER_PGM_RSRC1_LS:
-          case mmSPI_SHADER_PGM_RSRC1_HS:
-          case mmSPI_SHADER_PGM_RSRC1_ES:
-          case mmSPI_SHADER_PGM_RSRC1_GS:
-          case mmSPI_SHADER_PGM_RSRC1_VS:
-          case mmSPI_SHADER_PGM_RSRC1_PS: {
-            // For the RSRC1 registers, we need to consider the VGPRS and SGPRS fields separately, and max them.
-            // This happens when linking in a glue shader.
-            SPI_SHADER_PGM_RSRC1 destRsrc1;
-            SPI_SHADER_PGM_RSRC1 srcRsrc1;
-            SPI_SHADER_PGM_RSRC1 origRsrc1;
-            origRsrc1.u32All = destNode->getUInt();
-            srcRsrc1.u32All = srcNode.getUInt();
-            destRsrc1.u32All = origRsrc1.u32All | srcRsrc1.u32All;
-            destRsrc1.bits.VGPRS = std::max(origRsrc1.bits.VGPRS, srcRsrc1.bits.VGPRS);
-            destRsrc1.bits.SGPRS = std::max(origRsrc1.bits.SGPRS, srcRsrc1.bits.SGPRS);
-            if (isGlueCode) {
-              // The float mode should come from the body of the shader and not the glue code.
-              destRsrc1.bits.FLOAT_MODE = origRsrc1.bits.FLOAT_MODE;
-            }
-            *destNode = srcNode.getDocument()->getNode(destRsrc1.u32All);
-            return 0;
-          }
-          case mmSPI_PS_INPUT_ENA:
-          case mmSPI_PS_INPUT_ADDR: {
-            if (!isGlueCode) {
-              *destNode = srcNode.getUInt();
-            }
-            return 0;
-          }
-          }
-        } else if (mapKey.isString()) {
+        // Special cases of uint merging. Registers are not in the document here; they are merged into the register
+        // table by readRegisters below.
+        if (mapKey.isString()) {
           // For .userdatalimit, register counts, and register limits, take the max value.
           if (mapKey.getString() == Util::Abi::PipelineMetadataKey::UserDataLimit ||
               mapKey.getString() == Util::Abi::HardwareStageMetadataKey::SgprCount ||
@@ -232,6 +216,88 @@ void PalMetadata::mergeFromBlob(llvm::StringRef blob, bool isGlueCode) {
       });
   assert(success && "Bad PAL metadata format");
   ((void)success);
+
+  // The registers from the blob are now the only ones in the document. Merge them into the register table.
+  readRegisters(isGlueCode);
+}
+
+// =====================================================================================================================
+// Merge the registers in the MsgPack document into the register table, and empty them from the document.
+//
+// @param isGlueCode : True if the registers were generated for glue code
+void PalMetadata::readRegisters(bool isGlueCode) {
+  if (m_registers.empty())
+    return;
+  for (auto &entry : m_registers) {
+    assert(entry.first.getKind() == msgpack::Type::UInt && entry.second.getKind() == msgpack::Type::UInt);
+    mergeRegister(entry.first.getUInt(), entry.second.getUInt(), isGlueCode);
+  }
+  m_pipelineNode[".registers"] = m_document->getMapNode();
+  m_registers = m_pipelineNode[".registers"].getMap(true);
+}
+
+// =====================================================================================================================
+// Merge one register value read from MsgPack PAL metadata into the register table. A register that is not yet set
+// takes the value; otherwise the values are combined the same way as when merging PAL metadata blobs.
+//
+// @param regNum : Register number
+// @param value : Value read from MsgPack PAL metadata
+// @param isGlueCode : True if the value was generated for glue code
+void PalMetadata::mergeRegister(unsigned regNum, unsigned value, bool isGlueCode) {
+  if (!hasRegister(regNum)) {
+    storeRegister(regNum, value);
+    return;
+  }
+  unsigned oldValue = getRegister(regNum);
+  switch (regNum) {
+  case mmVGT_SHADER_STAGES_EN:
+    // Ignore new value of VGT_SHADER_STAGES_EN from glue shader, as it might accidentally make the VS
+    // wave32. (This relies on the glue shader's PAL metadata being merged into the vertex-processing
+    // half-pipeline, rather than the other way round.)
+    return;
+  case mmSPI_SHADER_PGM_RSRC1_LS:
+  case mmSPI_SHADER_PGM_RSRC1_HS:
+  case mmSPI_SHADER_PGM_RSRC1_ES:
+  case mmSPI_SHADER_PGM_RSRC1_GS:
+  case mmSPI_SHADER_PGM_RSRC1_VS:
+  case mmSPI_SHADER_PGM_RSRC1_PS: {
+    // For the RSRC1 registers, we need to consider the VGPRS and SGPRS fields separately, and max them.
+    // This happens when linking in a glue shader.
+    SPI_SHADER_PGM_RSRC1 destRsrc1;
+    SPI_SHADER_PGM_RSRC1 srcRsrc1;
+    SPI_SHADER_PGM_RSRC1 origRsrc1;
+    origRsrc1.u32All = oldValue;
+    srcRsrc1.u32All = value;
+    destRsrc1.u32All = origRsrc1.u32All | srcRsrc1.u32All;
+    destRsrc1.bits.VGPRS = std::max(origRsrc1.bits.VGPRS, srcRsrc1.bits.VGPRS);
+    destRsrc1.bits.SGPRS = std::max(origRsrc1.bits.SGPRS, srcRsrc1.bits.SGPRS);
+    if (isGlueCode) {
+      // The float mode should come from the body of the shader and not the glue code.
+      destRsrc1.bits.FLOAT_MODE = origRsrc1.bits.FLOAT_MODE;
+    }
+    storeRegister(regNum, destRsrc1.u32All);
+    return;
+  }
+  case mmSPI_PS_INPUT_ENA:
+  case mmSPI_PS_INPUT_ADDR:
+    if (!isGlueCode)
+      storeRegister(regNum, value);
+    return;
+  default:
+    // Default behavior for registers: "or" the values together.
+    storeRegister(regNum, oldValue | value);
+    return;
+  }
+}
+
+// =====================================================================================================================
+// Write the register table into the MsgPack document. The MsgPack map is ordered by key, so the order the registers
+// are added in does not affect the blob.
+void PalMetadata::writeRegisters() {
+  for (unsigned regIdx : m_regSet.set_bits())
+    m_registers[RegRangeBases[regIdx / RegRangeSize] + regIdx % RegRangeSize] = m_regValues[regIdx];
+  for (const auto &entry : m_otherRegs)
+    m_registers[entry.first] = entry.second;
 }
 
 // =====================================================================================================================
@@ -347,7 +413,7 @@ void PalMetadata::setUserDataEntry(ShaderStage stage, unsigned userDataIndex, un
   // Write the register(s)
   userDataReg += userDataIndex;
   while (dwordCount--)
-    m_registers[userDataReg++] = userDataValue++;
+    storeRegister(userDataReg++, userDataValue++);
 }
 
 // =====================================================================================================================
@@ -411,10 +477,11 @@ void PalMetadata::fixUpRegisters() {
     unsigned regEnd = reg + regRange.second;
     // Scan registers [reg,regEnd), the user data registers for one shader stage. If register 0 in that range is
     // not set, then the shader stage is not in use, so don't bother to scan the others.
-    auto it = m_registers.find(m_document->getNode(reg));
-    if (it != m_registers.end()) {
-      for (;;) {
-        unsigned value = it->second.getUInt();
+    if (hasRegister(reg)) {
+      for (; reg != regEnd; ++reg) {
+        if (!hasRegister(reg))
+          continue;
+        unsigned value = getRegister(reg);
         unsigned descSet = value - static_cast<unsigned>(UserDataMapping::DescriptorSet0);
         if (descSet <= static_cast<unsigned>(UserDataMapping::DescriptorSetMax) -
                            static_cast<unsigned>(UserDataMapping::DescriptorSet0)) {
@@ -422,7 +489,7 @@ void PalMetadata::fixUpRegisters() {
           if (descSet >= descSetNodes.size() || !descSetNodes[descSet])
             report_fatal_error("Descriptor set " + Twine(descSet) + " not found");
           value = descSetNodes[descSet]->offsetInDwords;
-          it->second = value;
+          storeRegister(reg, value);
           unsigned extent = value + descSetNodes[descSet]->sizeInDwords;
           userDataLimit = std::max(userDataLimit, extent);
         } else {
@@ -433,14 +500,11 @@ void PalMetadata::fixUpRegisters() {
             if (!pushConstNode || pushConstNode->sizeInDwords <= pushConstOffset)
               report_fatal_error("Push constant not found or not big enough");
             value = pushConstNode->offsetInDwords + pushConstOffset;
-            it->second = value;
+            storeRegister(reg, value);
             unsigned extent = pushConstNode->offsetInDwords + pushConstNode->sizeInDwords;
             userDataLimit = std::max(userDataLimit, extent);
           }
         }
-        ++it;
-        if (it == m_registers.end() || it->first.getUInt() >= regEnd)
-          break;
       }
     }
   }
@@ -454,6 +518,9 @@ void PalMetadata::fixUpRegisters() {
 void PalMetadata::finalizePipeline() {
   assert(!m_pipelineState->isUnlinked());
 
+  // The attribute interface between half-pipelines is only needed while compiling an unlinked half-pipeline.
+  m_pipelineNode.erase(m_document->getNode(PipelineMetadataKey::ParamInterface));
+
   // Set pipeline hash.
   auto pipelineHashNode = m_pipelineNode[Util::Abi::PipelineMetadataKey::InternalPipelineHash].getArray(true);
   const auto &options = m_pipelineState->getOptions();
@@ -516,13 +583,22 @@ void PalMetadata::finalizePipeline() {
 //
 // @param regNum : Register number
 unsigned PalMetadata::getRegister(unsigned regNum) {
-  auto mapIt = m_registers.find(m_document->getNode(regNum));
-  if (mapIt == m_registers.end()) {
-    return 0;
-  }
-  msgpack::DocNode &node = mapIt->second;
-  assert(node.getKind() == msgpack::Type::UInt);
-  return node.getUInt();
+  int regIdx = getRegIndex(regNum);
+  if (regIdx >= 0)
+    return m_regSet[regIdx] ? m_regValues[regIdx] : 0;
+  auto it = m_otherRegs.find(regNum);
+  return it == m_otherRegs.end() ? 0 : it->second;
+}
+
+// =====================================================================================================================
+// Check whether a register is set in PAL metadata.
+//
+// @param regNum : Register number
+bool PalMetadata::hasRegister(unsigned regNum) const {
+  int regIdx = getRegIndex(regNum);
+  if (regIdx >= 0)
+    return m_regSet[regIdx];
+  return m_otherRegs.count(regNum) != 0;
 }
 
 // =====================================================================================================================
@@ -532,10 +608,35 @@ unsigned PalMetadata::getRegister(unsigned regNum) {
 // @param regNum : Register number
 // @param value : Value to OR in
 void PalMetadata::setRegister(unsigned regNum, unsigned value) {
-  msgpack::DocNode &node = m_registers[regNum];
-  if (node.getKind() == msgpack::Type::UInt)
-    value |= node.getUInt();
-  node = value;
+  storeRegister(regNum, getRegister(regNum) | value);
+}
+
+// =====================================================================================================================
+// Set a register value, overwriting any value it already has.
+//
+// @param regNum : Register number
+// @param value : Value to set
+void PalMetadata::storeRegister(unsigned regNum, unsigned value) {
+  int regIdx = getRegIndex(regNum);
+  if (regIdx < 0) {
+    m_otherRegs[regNum] = value;
+    return;
+  }
+  m_regValues[regIdx] = value;
+  m_regSet.set(regIdx);
+}
+
+// =====================================================================================================================
+// Get the index of a register in the dense register table, or -1 if it is outside the ranges the table holds.
+//
+// @param regNum : Register number
+int PalMetadata::getRegIndex(unsigned regNum) {
+  for (unsigned rangeIdx = 0; rangeIdx != RegRangeCount; ++rangeIdx) {
+    unsigned offset = regNum - RegRangeBases[rangeIdx];
+    if (offset < RegRangeSize)
+      return rangeIdx * RegRangeSize + offset;
+  }
+  return -1;
 }
 
 // =====================================================================================================================
@@ -662,6 +763,43 @@ void PalMetadata::eraseColorExportInfo() {
   m_pipelineNode.erase(m_document->getNode(PipelineMetadataKey::ColorExports));
 }
 
+// =====================================================================================================================
+// Store the attribute interface of an unlinked vertex-processing half-pipeline in the PAL metadata: the parameter
+// exports of the last vertex-processing stage. It is read back when compiling the fragment half-pipeline against
+// this ELF, and removed when the half-pipelines are linked.
+//
+// @param params : Array of ParamInterfaceInfo structs
+void PalMetadata::addParamInterfaceInfo(ArrayRef<ParamInterfaceInfo> params) {
+  // Each attribute is an array containing {location,isBuiltIn,param}.
+  // .paramInterface is an array containing the attributes.
+  auto paramArray = m_pipelineNode[PipelineMetadataKey::ParamInterface].getArray(true);
+  for (const ParamInterfaceInfo &param : params) {
+    msgpack::ArrayDocNode paramNode = m_document->getArrayNode();
+    paramNode.push_back(m_document->getNode(param.location));
+    paramNode.push_back(m_document->getNode(param.isBuiltIn));
+    paramNode.push_back(m_document->getNode(param.param));
+    paramArray.push_back(paramNode);
+  }
+}
+
+// =====================================================================================================================
+// Get the attribute interface of an unlinked half-pipeline out of PAL metadata. Returns false if the PAL metadata
+// has no attribute interface, that is, it did not come from an unlinked half-pipeline ELF.
+//
+// @param [out] params : Vector to store info of each attribute
+bool PalMetadata::getParamInterfaceInfo(SmallVectorImpl<ParamInterfaceInfo> &params) {
+  auto it = m_pipelineNode.find(m_document->getNode(PipelineMetadataKey::ParamInterface));
+  if (it == m_pipelineNode.end() || !it->second.isArray())
+    return false;
+  auto paramArray = it->second.getArray();
+  for (unsigned i = 0, e = paramArray.size(); i != e; ++i) {
+    msgpack::ArrayDocNode paramNode = paramArray[i].getArray();
+    params.push_back({static_cast<unsigned>(paramNode[0].getUInt()), paramNode[1].getBool(),
+                      static_cast<unsigned>(paramNode[2].getUInt())});
+  }
+  return true;
+}
+
 // =====================================================================================================================
 // Get the VS entry register info. Used by the linker to generate the fetch shader.
 //
@@ -677,13 +815,8 @@ void PalMetadata::getVsEntryRegInfo(VsEntryRegInfo &regInfo) {
                                                               {mmSPI_SHADER_USER_DATA_GS_0, CallingConv::AMDGPU_GS},
                                                               {mmSPI_SHADER_USER_DATA_VS_0, CallingConv::AMDGPU_VS}};
   ArrayRef<std::pair<unsigned, unsigned>> shaderEntries = shaderTable;
-  auto userDataRegIt = m_registers.begin();
-  for (;;) {
-    userDataRegIt = m_registers.find(m_document->getNode(shaderEntries[0].first));
-    if (userDataRegIt != m_registers.end())
-      break;
+  while (!hasRegister(shaderEntries[0].first))
     shaderEntries = shaderEntries.drop_front();
-  }
   unsigned userDataOffset = 0;
   unsigned userDataReg0 = shaderEntries[0].first;
   regInfo.callingConv = shaderEntries[0].second;
@@ -692,30 +825,28 @@ void PalMetadata::getVsEntryRegInfo(VsEntryRegInfo &regInfo) {
 
   // Scan the user data registers for vertex buffer table, vertex id, instance id.
   unsigned userDataCount = m_pipelineState->getTargetInfo().getGpuProperty().maxUserDataCount;
-  for (;;) {
-    switch (static_cast<UserDataMapping>(userDataRegIt->second.getUInt())) {
+  for (unsigned reg = userDataReg0; reg != userDataReg0 + userDataCount; ++reg) {
+    if (!hasRegister(reg))
+      continue;
+    switch (static_cast<UserDataMapping>(getRegister(reg))) {
     case UserDataMapping::VertexBufferTable:
-      regInfo.vertexBufferTable = userDataRegIt->first.getUInt() - userDataReg0 + userDataOffset;
+      regInfo.vertexBufferTable = reg - userDataReg0 + userDataOffset;
       break;
     case UserDataMapping::BaseVertex:
-      regInfo.baseVertex = userDataRegIt->first.getUInt() - userDataReg0 + userDataOffset;
+      regInfo.baseVertex = reg - userDataReg0 + userDataOffset;
       break;
     case UserDataMapping::BaseInstance:
-      regInfo.baseInstance = userDataRegIt->first.getUInt() - userDataReg0 + userDataOffset;
+      regInfo.baseInstance = reg - userDataReg0 + userDataOffset;
       break;
     default:
       break;
     }
-    if (++userDataRegIt == m_registers.end() || userDataRegIt->first.getUInt() >= userDataReg0 + userDataCount)
-      break;
   }
 
   // Get the number of user data registers in this shader. For GFX9+, we ignore the USER_SGPR_MSB field; we
   // know that there is at least one user SGPR, so if we find that USER_SGPR is 0, it must mean 32.
   SPI_SHADER_PGM_RSRC2 rsrc2;
-  rsrc2.u32All =
-      m_registers[m_document->getNode(userDataReg0 + mmSPI_SHADER_PGM_RSRC2_VS - mmSPI_SHADER_USER_DATA_VS_0)]
-          .getUInt();
+  rsrc2.u32All = getRegister(userDataReg0 + mmSPI_SHADER_PGM_RSRC2_VS - mmSPI_SHADER_USER_DATA_VS_0);
   userDataCount = rsrc2.bits.USER_SGPR == 0 ? 32 : rsrc2.bits.USER_SGPR;
 
   // Conservatively set the total number of input SGPRs. A merged shader with 8 SGPRs before user data
@@ -728,7 +859,7 @@ void PalMetadata::getVsEntryRegInfo(VsEntryRegInfo &regInfo) {
   // shader stage. We know that instance ID is enabled, because it always is in a fetchless VS.
   // On GFX10, also get the wave32 bit.
   VGT_SHADER_STAGES_EN vgtShaderStagesEn;
-  vgtShaderStagesEn.u32All = m_registers[m_document->getNode(mmVGT_SHADER_STAGES_EN)].getUInt();
+  vgtShaderStagesEn.u32All = getRegister(mmVGT_SHADER_STAGES_EN);
   switch (regInfo.callingConv) {
   case CallingConv::AMDGPU_LS: // Before-GFX9 unmerged LS
   case CallingConv::AMDGPU_ES: // Before-GFX9 unmerged ES
@@ -46,6 +46,7 @@ namespace lgc {
 // Information on how to create a pass manager. This is used as the key in the pass manager cache.
 struct PassManagerInfo {
   bool isGlue;
+  CodeGenOpt::Level optLevel; // Optimization level, which is baked into the code generation passes
 };
 
 } // namespace lgc
@@ -55,8 +56,11 @@ struct PassManagerInfo {
 //
 // @param outStream : Stream to output ELF info
 lgc::PassManager &PassManagerCache::getGlueShaderPassManager(raw_pwrite_stream &outStream) {
-  PassManagerInfo info = {};
+  // NOTE: The struct is used as the cache key bytes, so clear its padding too.
+  PassManagerInfo info;
+  memset(&info, 0, sizeof(info));
   info.isGlue = true;
+  info.optLevel = m_lgcContext->getOptimizationLevel();
   return getPassManager(info, outStream);
 }
 
@@ -79,7 +83,7 @@ lgc::PassManager &PassManagerCache::getPassManager(const PassManagerInfo &info,
   // TODO: Creation of a normal compilation pass manager, not just one for a glue shader.
   assert(info.isGlue && "Non-glue shader compilation not implemented yet");
 
-  passManager.reset(PassManager::Create());
+  passManager.reset(PassManager::Create(m_lgcContext));
   passManager->add(createTargetTransformInfoWrapperPass(m_lgcContext->getTargetMachine()->getTargetIRAnalysis()));
 
   // Manually add a target-aware TLI pass, so optimizations do not think that we have library functions.
@@ -33,10 +33,13 @@
 #include "lgc/PassManager.h"
 #include "lgc/patch/FragColorExport.h"
 #include "lgc/state/PalMetadata.h"
+#include "lgc/state/StateBlob.h"
 #include "lgc/state/TargetInfo.h"
 #include "lgc/util/Internal.h"
+#include "llvm/BinaryFormat/ELF.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 
@@ -51,7 +54,15 @@ static cl::opt<bool> EnableTessOffChip("enable-tess-offchip", cl::desc("Enable t
 // -pack-in-out: pack input/output
 static cl::opt<bool> PackInOut("pack-in-out", cl::desc("Pack input/output"), cl::init(true));
 
-// Names for named metadata nodes when storing and reading back pipeline state
+// Name of the named metadata node that pipeline state is recorded in, as a binary blob
+static const char StateBlobMetadataName[] = "lgc.pipeline.state";
+
+// Version of the pipeline state blob. Bump it whenever the layout of the blob changes, other than by adding fields to
+// the end of a struct written with writeArrayOfInt32.
+static const unsigned StateBlobVersion = 1;
+
+// Names for named metadata nodes of pipeline state recorded item by item. This is no longer written, but is still read
+// from IR that does not have the pipeline state blob, such as IR written by hand for a test.
 static const char UnlinkedMetadataName[] = "lgc.unlinked";
 static const char OptionsMetadataName[] = "lgc.options";
 static const char UserDataMetadataName[] = "lgc.user.data.nodes";
@@ -62,6 +73,7 @@ static const char VpStateMetadataName[] = "lgc.viewport.state";
 static const char RsStateMetadataName[] = "lgc.rasterizer.state";
 static const char ColorExportFormatsMetadataName[] = "lgc.color.export.formats";
 static const char ColorExportStateMetadataName[] = "lgc.color.export.state";
+static const char OtherPartInterfaceMetadataName[] = "lgc.other.part.interface";
 
 namespace {
 
@@ -274,6 +286,7 @@ void PipelineState::clear(Module *module) {
   getShaderModes()->clear();
   m_options = {};
   m_userDataNodes = {};
+  buildResourceNodeIndex();
   m_deviceIndex = 0;
   m_vertexInputDescriptions.clear();
   m_colorExportFormats.clear();
@@ -281,6 +294,8 @@ void PipelineState::clear(Module *module) {
   m_inputAssemblyState = {};
   m_viewportState = {};
   m_rasterizerState = {};
+  m_hasOtherPartInterface = false;
+  m_otherPartInterface.clear();
   record(module);
 }
 
@@ -289,34 +304,100 @@ void PipelineState::clear(Module *module) {
 //
 // @param [in/out] module : Module to record the IR metadata in
 void PipelineState::record(Module *module) {
-  getShaderModes()->record(module);
-  recordOptions(module);
-  recordUserDataNodes(module);
-  recordDeviceIndex(module);
-  recordVertexInputDescriptions(module);
-  recordColorExportState(module);
-  recordGraphicsState(module);
+  recordState(module);
+  recordOtherPartInterface(module);
   if (m_palMetadata)
     m_palMetadata->record(module);
 }
 
+// =====================================================================================================================
+// Record pipeline state, other than the PAL metadata and the other half-pipeline interface, into IR metadata of the
+// specified module, as a single binary blob. Any item-by-item pipeline state metadata in the module is removed, so it
+// cannot disagree with the blob.
+//
+// @param [in/out] module : Module to record the IR metadata in
+void PipelineState::recordState(Module *module) {
+  StateBlobWriter writer;
+  writer.writeWord(StateBlobVersion);
+  getShaderModes()->writeState(writer);
+  writeOptions(writer);
+  writeUserDataNodes(writer);
+  writer.writeWord(m_deviceIndex);
+  writeVertexInputDescriptions(writer);
+  writeColorExportState(writer);
+  writeGraphicsState(writer);
+
+  static const char *const ItemMetadataNames[] = {
+      UnlinkedMetadataName,     OptionsMetadataName, UserDataMetadataName, DeviceIndexMetadataName,
+      VertexInputsMetadataName, IaStateMetadataName, VpStateMetadataName,  RsStateMetadataName,
+      ColorExportFormatsMetadataName, ColorExportStateMetadataName};
+  for (const char *metadataName : ItemMetadataNames) {
+    if (auto namedMetaNode = module->getNamedMetadata(metadataName))
+      module->eraseNamedMetadata(namedMetaNode);
+  }
+  for (unsigned stage = 0; stage != ShaderStageCompute + 1; ++stage) {
+    std::string metadataName =
+        (Twine(OptionsMetadataName) + "." + getShaderStageAbbreviation(static_cast<ShaderStage>(stage))).str();
+    if (auto namedMetaNode = module->getNamedMetadata(metadataName))
+      module->eraseNamedMetadata(namedMetaNode);
+  }
+
+  LLVMContext &context = module->getContext();
+  auto blobMetaNode = module->getOrInsertNamedMetadata(StateBlobMetadataName);
+  blobMetaNode->clearOperands();
+  blobMetaNode->addOperand(MDNode::get(context, MDString::get(context, writer.getBlob())));
+}
+
 // =====================================================================================================================
 // Set up the pipeline state from the pipeline IR module.
 //
 // @param module : LLVM module
 void PipelineState::readState(Module *module) {
-  getShaderModes()->readModesFromPipeline(module);
   readShaderStageMask(module);
-  readOptions(module);
-  readUserDataNodes(module);
-  readDeviceIndex(module);
-  readVertexInputDescriptions(module);
-  readColorExportState(module);
-  readGraphicsState(module);
+  if (auto blobMetaNode = module->getNamedMetadata(StateBlobMetadataName)) {
+    readStateBlob(blobMetaNode);
+    // Shader modes of a shader compiled without a pipeline are recorded item by item in its shader module.
+    getShaderModes()->readModesFromPipeline(module);
+  } else {
+    getShaderModes()->readModesFromPipeline(module);
+    readOptions(module);
+    readUserDataNodes(module);
+    readDeviceIndex(module);
+    readVertexInputDescriptions(module);
+    readColorExportState(module);
+    readGraphicsState(module);
+  }
+  readOtherPartInterface(module);
   if (!m_palMetadata)
     m_palMetadata = new PalMetadata(this, module);
 }
 
+// =====================================================================================================================
+// Read pipeline state, other than the PAL metadata and the other half-pipeline interface, from the binary blob
+// recorded by recordState.
+//
+// @param blobMetaNode : Named metadata node containing the blob
+void PipelineState::readStateBlob(NamedMDNode *blobMetaNode) {
+  StringRef blob;
+  if (blobMetaNode->getNumOperands() != 0 && blobMetaNode->getOperand(0)->getNumOperands() != 0) {
+    if (auto blobString = dyn_cast<MDString>(blobMetaNode->getOperand(0)->getOperand(0)))
+      blob = blobString->getString();
+  }
+
+  StateBlobReader reader(blob);
+  if (reader.readWord() != StateBlobVersion)
+    report_fatal_error("Unsupported version of pipeline state in IR");
+  getShaderModes()->readState(reader);
+  readOptions(reader);
+  readUserDataNodes(reader);
+  m_deviceIndex = reader.readWord();
+  readVertexInputDescriptions(reader);
+  readColorExportState(reader);
+  readGraphicsState(reader);
+  if (reader.hasError())
+    report_fatal_error("Invalid pipeline state in IR");
+}
+
 // =====================================================================================================================
 // Read shaderStageMask from IR. This consists of checking what shader stage functions are present in the IR.
 // It also sets the m_computeLibrary flag if there are no shader entry-points.
@@ -435,23 +516,34 @@ const ShaderOptions &PipelineState::getShaderOptions(ShaderStage stage) {
 }
 
 // =====================================================================================================================
-// Record pipeline and shader options into IR metadata.
-// This also records m_unlinked.
-// TODO: The options could be recorded in a more human-readable form, with a string for the option name for each
-// option.
+// Write pipeline and shader options into the pipeline state blob.
+// This also writes m_unlinked.
 //
-// @param [in/out] module : Module to record metadata into
-void PipelineState::recordOptions(Module *module) {
-  if (m_unlinked) {
-    unsigned unlinkedAsInt = m_unlinked;
-    setNamedMetadataToArrayOfInt32(module, unlinkedAsInt, UnlinkedMetadataName);
-  }
-  setNamedMetadataToArrayOfInt32(module, m_options, OptionsMetadataName);
-  for (unsigned stage = 0; stage != m_shaderOptions.size(); ++stage) {
-    std::string metadataName =
-        (Twine(OptionsMetadataName) + "." + getShaderStageAbbreviation(static_cast<ShaderStage>(stage))).str();
-    setNamedMetadataToArrayOfInt32(module, m_shaderOptions[stage], metadataName);
+// @param [in/out] writer : Writer of the pipeline state blob
+void PipelineState::writeOptions(StateBlobWriter &writer) {
+  writer.writeWord(m_unlinked);
+  writer.writeArrayOfInt32(m_options);
+  writer.writeWord(m_shaderOptions.size());
+  for (const ShaderOptions &shaderOptions : m_shaderOptions)
+    writer.writeArrayOfInt32(shaderOptions);
+}
+
+// =====================================================================================================================
+// Read pipeline and shader options from the pipeline state blob.
+// This also reads m_unlinked.
+//
+// @param [in/out] reader : Reader of the pipeline state blob
+void PipelineState::readOptions(StateBlobReader &reader) {
+  m_unlinked = reader.readWord() != 0;
+  reader.readArrayOfInt32(m_options);
+  unsigned stageCount = reader.readCount();
+  if (stageCount > ShaderStageCompute + 1) {
+    reader.setError();
+    return;
   }
+  m_shaderOptions.resize(stageCount);
+  for (ShaderOptions &shaderOptions : m_shaderOptions)
+    reader.readArrayOfInt32(shaderOptions);
 }
 
 // =====================================================================================================================
@@ -496,6 +588,7 @@ void PipelineState::setUserDataNodes(ArrayRef<ResourceNode> nodes) {
   m_userDataNodes = ArrayRef<ResourceNode>(destTable, nodes.size());
   setUserDataNodesTable(nodes, destTable, destInnerTable);
   assert(destInnerTable == destTable + nodes.size());
+  buildResourceNodeIndex();
 }
 
 // =====================================================================================================================
@@ -522,79 +615,147 @@ void PipelineState::setUserDataNodesTable(ArrayRef<ResourceNode> nodes, Resource
 }
 
 // =====================================================================================================================
-// Record user data nodes into IR metadata.
-// Note that this takes a Module* instead of using m_pModule, because it can be called before pipeline linking.
+// Write user data nodes into the pipeline state blob.
 //
-// @param [in/out] module : Module to record the IR metadata in
-void PipelineState::recordUserDataNodes(Module *module) {
-  if (m_userDataNodes.empty()) {
-    if (auto userDataMetaNode = module->getNamedMetadata(UserDataMetadataName))
-      module->eraseNamedMetadata(userDataMetaNode);
-    return;
+// @param [in/out] writer : Writer of the pipeline state blob
+void PipelineState::writeUserDataNodes(StateBlobWriter &writer) {
+  unsigned totalNodeCount = m_userDataNodes.size();
+  for (const ResourceNode &node : m_userDataNodes) {
+    if (node.type == ResourceNodeType::DescriptorTableVaPtr)
+      totalNodeCount += node.innerTable.size();
   }
-
-  auto userDataMetaNode = module->getOrInsertNamedMetadata(UserDataMetadataName);
-  userDataMetaNode->clearOperands();
-  recordUserDataTable(m_userDataNodes, userDataMetaNode);
+  writer.writeWord(totalNodeCount);
+  writeUserDataTable(m_userDataNodes, writer);
 }
 
 // =====================================================================================================================
-// Record one table of user data nodes into IR metadata, calling itself recursively for inner tables.
+// Write one table of user data nodes into the pipeline state blob, calling itself recursively for inner tables.
 //
 // @param nodes : Table of user data nodes
-// @param userDataMetaNode : IR metadata node to record them into
-void PipelineState::recordUserDataTable(ArrayRef<ResourceNode> nodes, NamedMDNode *userDataMetaNode) {
-  IRBuilder<> builder(getContext());
-
+// @param [in/out] writer : Writer of the pipeline state blob
+void PipelineState::writeUserDataTable(ArrayRef<ResourceNode> nodes, StateBlobWriter &writer) {
+  writer.writeWord(nodes.size());
   for (const ResourceNode &node : nodes) {
-    SmallVector<Metadata *, 5> operands;
     assert(node.type < ResourceNodeType::Count);
-    // Operand 0: type
-    operands.push_back(getResourceTypeName(node.type));
-    // Operand 1: offsetInDwords
-    operands.push_back(ConstantAsMetadata::get(builder.getInt32(node.offsetInDwords)));
-    // Operand 2: sizeInDwords
-    operands.push_back(ConstantAsMetadata::get(builder.getInt32(node.sizeInDwords)));
+    writer.writeWord(static_cast<unsigned>(node.type));
+    writer.writeWord(node.offsetInDwords);
+    writer.writeWord(node.sizeInDwords);
+
+    switch (node.type) {
+    case ResourceNodeType::DescriptorTableVaPtr:
+      writeUserDataTable(node.innerTable, writer);
+      break;
+    case ResourceNodeType::IndirectUserDataVaPtr:
+    case ResourceNodeType::StreamOutTableVaPtr:
+      writer.writeWord(node.indirectSizeInDwords);
+      break;
+    default: {
+      writer.writeWord(node.set);
+      writer.writeWord(node.binding);
+      writer.writeWord(node.stride);
+      // The immutable descriptor constant is an array of vectors of i32, written as the array size, the vector size,
+      // then the elements. An array size of 0 means there is none.
+      if (!node.immutableValue) {
+        writer.writeWord(0);
+        break;
+      }
+      unsigned elemCount = node.immutableValue->getType()->getArrayNumElements();
+      unsigned componentCount =
+          cast<FixedVectorType>(node.immutableValue->getType()->getArrayElementType())->getNumElements();
+      writer.writeWord(elemCount);
+      writer.writeWord(componentCount);
+      for (unsigned elemIdx = 0; elemIdx != elemCount; ++elemIdx) {
+        Constant *elem = node.immutableValue->getAggregateElement(elemIdx);
+        for (unsigned compIdx = 0; compIdx != componentCount; ++compIdx)
+          writer.writeWord(cast<ConstantInt>(elem->getAggregateElement(compIdx))->getZExtValue());
+      }
+      break;
+    }
+    }
+  }
+}
+
+// =====================================================================================================================
+// Read user data nodes for the pipeline from the pipeline state blob
+//
+// @param [in/out] reader : Reader of the pipeline state blob
+void PipelineState::readUserDataNodes(StateBlobReader &reader) {
+  // We allocate a single buffer, with the outer table at the start, and inner tables allocated from the end
+  // backwards, as setUserDataNodes does.
+  unsigned totalNodeCount = reader.readCount();
+  unsigned outerNodeCount = reader.readCount();
+  if (outerNodeCount > totalNodeCount) {
+    reader.setError();
+    return;
+  }
+  m_allocUserDataNodes = std::make_unique<ResourceNode[]>(totalNodeCount);
+  MutableArrayRef<ResourceNode> outerTable(m_allocUserDataNodes.get(), outerNodeCount);
+  ResourceNode *destInnerTable = m_allocUserDataNodes.get() + totalNodeCount;
+  readUserDataTable(reader, outerTable, destInnerTable, outerTable.end());
+  m_userDataNodes = outerTable;
+  buildResourceNodeIndex();
+}
+
+// =====================================================================================================================
+// Read one table of user data nodes from the pipeline state blob, calling itself recursively for inner tables.
+//
+// @param [in/out] reader : Reader of the pipeline state blob
+// @param [out] destTable : Where to write nodes
+// @param [in/out] destInnerTable : End of space available for inner tables
+// @param innerTableLimit : Start of space available for inner tables
+void PipelineState::readUserDataTable(StateBlobReader &reader, MutableArrayRef<ResourceNode> destTable,
+                                      ResourceNode *&destInnerTable, ResourceNode *innerTableLimit) {
+  for (ResourceNode &node : destTable) {
+    unsigned type = reader.readWord();
+    if (type >= static_cast<unsigned>(ResourceNodeType::Count))
+      reader.setError();
+    if (reader.hasError())
+      return;
+    node.type = static_cast<ResourceNodeType>(type);
+    node.offsetInDwords = reader.readWord();
+    node.sizeInDwords = reader.readWord();
 
     switch (node.type) {
     case ResourceNodeType::DescriptorTableVaPtr: {
-      // Operand 3: Node count in sub-table.
-      operands.push_back(ConstantAsMetadata::get(builder.getInt32(node.innerTable.size())));
-      // Create the metadata node here.
-      userDataMetaNode->addOperand(MDNode::get(getContext(), operands));
-      // Create nodes for the sub-table.
-      recordUserDataTable(node.innerTable, userDataMetaNode);
-      continue;
+      unsigned innerNodeCount = reader.readCount();
+      if (innerNodeCount > static_cast<size_t>(destInnerTable - innerTableLimit)) {
+        reader.setError();
+        return;
+      }
+      destInnerTable -= innerNodeCount;
+      MutableArrayRef<ResourceNode> innerTable(destInnerTable, innerNodeCount);
+      node.innerTable = innerTable;
+      readUserDataTable(reader, innerTable, destInnerTable, innerTableLimit);
+      break;
     }
     case ResourceNodeType::IndirectUserDataVaPtr:
-    case ResourceNodeType::StreamOutTableVaPtr: {
-      // Operand 3: Size of the indirect data in dwords.
-      operands.push_back(ConstantAsMetadata::get(builder.getInt32(node.indirectSizeInDwords)));
+    case ResourceNodeType::StreamOutTableVaPtr:
+      node.indirectSizeInDwords = reader.readWord();
       break;
-    }
     default: {
-      // Operand 3: set
-      operands.push_back(ConstantAsMetadata::get(builder.getInt32(node.set)));
-      // Operand 4: binding
-      operands.push_back(ConstantAsMetadata::get(builder.getInt32(node.binding)));
-      // Operand 5: stride
-      operands.push_back(ConstantAsMetadata::get(builder.getInt32(node.stride)));
-      if (node.immutableValue) {
-        // Operand 6 onwards: immutable descriptor constant.
-        // Writing the constant array directly does not seem to work, as it does not survive IR linking.
-        // Maybe it is a problem with the IR linker when metadata contains a non-ConstantData constant.
-        // So we write the individual constant vectors instead.
-        // The descriptor is either a sampler (<4 x i32>) or converting sampler (<8 x i32>).
-        unsigned elemCount = node.immutableValue->getType()->getArrayNumElements();
-        for (unsigned elemIdx = 0; elemIdx != elemCount; ++elemIdx)
-          operands.push_back(ConstantAsMetadata::get(ConstantExpr::getExtractValue(node.immutableValue, elemIdx)));
+      node.set = reader.readWord();
+      node.binding = reader.readWord();
+      node.stride = reader.readWord();
+      node.immutableValue = nullptr;
+      unsigned elemCount = reader.readCount();
+      if (elemCount == 0)
+        break;
+      unsigned componentCount = reader.readCount();
+      if (componentCount == 0) {
+        reader.setError();
+        return;
+      }
+      SmallVector<Constant *, 8> descriptors;
+      SmallVector<uint32_t, 8> components(componentCount);
+      for (unsigned elemIdx = 0; elemIdx != elemCount; ++elemIdx) {
+        for (uint32_t &component : components)
+          component = reader.readWord();
+        descriptors.push_back(ConstantDataVector::get(getContext(), components));
       }
+      node.immutableValue = ConstantArray::get(ArrayType::get(descriptors[0]->getType(), elemCount), descriptors);
       break;
     }
     }
-
-    // Create the metadata node.
-    userDataMetaNode->addOperand(MDNode::get(getContext(), operands));
   }
 }
 
@@ -677,6 +838,34 @@ void PipelineState::readUserDataNodes(Module *module) {
     }
   }
   m_userDataNodes = ArrayRef<ResourceNode>(m_allocUserDataNodes.get(), nextOuterNode);
+  buildResourceNodeIndex();
+}
+
+// =====================================================================================================================
+// Build the indexes used by findResourceNode from the user data nodes. Each {set,binding} maps to all the nodes with
+// that set and binding in user data node order, so a lookup only has to check type compatibility of the few nodes
+// that share the set and binding, and still returns the same node as a linear search of the tables would.
+void PipelineState::buildResourceNodeIndex() {
+  m_resourceNodeIndex.clear();
+  m_descTableIndex.clear();
+
+  auto addNode = [this](const ResourceNode &topNode, const ResourceNode &node) {
+    // Indirect data nodes and nested tables do not have a set and binding.
+    if (node.type == ResourceNodeType::IndirectUserDataVaPtr || node.type == ResourceNodeType::StreamOutTableVaPtr ||
+        (&node != &topNode && node.type == ResourceNodeType::DescriptorTableVaPtr))
+      return;
+    m_resourceNodeIndex[{node.set, node.binding}].push_back({&topNode, &node});
+  };
+
+  for (const ResourceNode &node : getUserDataNodes()) {
+    if (node.type == ResourceNodeType::DescriptorTableVaPtr) {
+      assert(!node.innerTable.empty());
+      m_descTableIndex.insert({node.innerTable[0].set, &node});
+      for (const ResourceNode &innerNode : node.innerTable)
+        addNode(node, innerNode);
+    } else
+      addNode(node, node);
+  }
 }
 
 // =====================================================================================================================
@@ -739,22 +928,18 @@ static bool IsNodeTypeCompatible(ResourceNodeType nodeType, ResourceNodeType can
 // @param binding : ID of descriptor binding
 std::pair<const ResourceNode *, const ResourceNode *>
 PipelineState::findResourceNode(ResourceNodeType nodeType, unsigned descSet, unsigned binding) const {
-  for (const ResourceNode &node : getUserDataNodes()) {
-    if (node.type == ResourceNodeType::DescriptorTableVaPtr) {
-      if (nodeType == ResourceNodeType::DescriptorTableVaPtr) {
-        assert(!node.innerTable.empty());
-
-        if (node.innerTable[0].set == descSet)
-          return {&node, &node};
-        continue;
-      }
+  if (nodeType == ResourceNodeType::DescriptorTableVaPtr) {
+    auto it = m_descTableIndex.find(descSet);
+    if (it != m_descTableIndex.end())
+      return {it->second, it->second};
+    return {nullptr, nullptr};
+  }
 
-      // Check inner nodes.
-      for (const ResourceNode &innerNode : node.innerTable)
-        if (innerNode.set == descSet && innerNode.binding == binding && IsNodeTypeCompatible(nodeType, innerNode.type))
-          return {&node, &innerNode};
-    } else if (node.set == descSet && node.binding == binding && IsNodeTypeCompatible(nodeType, node.type)) {
-      return {&node, &node};
+  auto it = m_resourceNodeIndex.find({descSet, binding});
+  if (it != m_resourceNodeIndex.end()) {
+    for (const auto &candidate : it->second) {
+      if (IsNodeTypeCompatible(nodeType, candidate.second->type))
+        return candidate;
     }
   }
 
@@ -779,14 +964,6 @@ const ResourceNode *PipelineState::findSingleRootResourceNode(ResourceNodeType n
   return nullptr;
 }
 
-// =====================================================================================================================
-// Get the cached MDString for the name of a resource mapping node type, as used in IR metadata for user data nodes.
-//
-// @param type : Resource mapping node type
-MDString *PipelineState::getResourceTypeName(ResourceNodeType type) {
-  return getResourceTypeNames()[static_cast<unsigned>(type)];
-}
-
 // =====================================================================================================================
 // Get the resource mapping node type given its MDString name.
 //
@@ -836,22 +1013,23 @@ const VertexInputDescription *PipelineState::findVertexInputDescription(unsigned
 }
 
 // =====================================================================================================================
-// Record vertex input descriptions into IR metadata.
+// Write vertex input descriptions into the pipeline state blob.
 //
-// @param [in/out] module : Module to record the IR metadata in
-void PipelineState::recordVertexInputDescriptions(Module *module) {
-  if (m_vertexInputDescriptions.empty()) {
-    if (auto vertexInputsMetaNode = module->getNamedMetadata(VertexInputsMetadataName))
-      module->eraseNamedMetadata(vertexInputsMetaNode);
-    return;
-  }
-
-  auto vertexInputsMetaNode = module->getOrInsertNamedMetadata(VertexInputsMetadataName);
-  IRBuilder<> builder(getContext());
-  vertexInputsMetaNode->clearOperands();
-
+// @param [in/out] writer : Writer of the pipeline state blob
+void PipelineState::writeVertexInputDescriptions(StateBlobWriter &writer) {
+  writer.writeWord(m_vertexInputDescriptions.size());
   for (const VertexInputDescription &input : m_vertexInputDescriptions)
-    vertexInputsMetaNode->addOperand(getArrayOfInt32MetaNode(getContext(), input, /*atLeastOneValue=*/true));
+    writer.writeArrayOfInt32(input);
+}
+
+// =====================================================================================================================
+// Read vertex input descriptions for the pipeline from the pipeline state blob
+//
+// @param [in/out] reader : Reader of the pipeline state blob
+void PipelineState::readVertexInputDescriptions(StateBlobReader &reader) {
+  m_vertexInputDescriptions.resize(reader.readCount());
+  for (VertexInputDescription &input : m_vertexInputDescriptions)
+    reader.readArrayOfInt32(input);
 }
 
 // =====================================================================================================================
@@ -901,26 +1079,25 @@ const ColorExportFormat &PipelineState::getColorExportFormat(unsigned location)
 }
 
 // =====================================================================================================================
-// Record color export state (including formats) into IR metadata
+// Write color export state (including formats) into the pipeline state blob
 //
-// @param [in/out] module : IR module
-void PipelineState::recordColorExportState(Module *module) {
-  if (m_colorExportFormats.empty()) {
-    if (auto exportFormatsMetaNode = module->getNamedMetadata(ColorExportFormatsMetadataName))
-      module->eraseNamedMetadata(exportFormatsMetaNode);
-  } else {
-    auto exportFormatsMetaNode = module->getOrInsertNamedMetadata(ColorExportFormatsMetadataName);
-    IRBuilder<> builder(getContext());
-    exportFormatsMetaNode->clearOperands();
-
-    // The color export formats named metadata node's operands are:
-    // - N metadata nodes for N color targets, each one containing
-    // { dfmt, nfmt, blendEnable, blendSrcAlphaToColor }
-    for (const ColorExportFormat &target : m_colorExportFormats)
-      exportFormatsMetaNode->addOperand(getArrayOfInt32MetaNode(getContext(), target, /*atLeastOneValue=*/true));
-  }
+// @param [in/out] writer : Writer of the pipeline state blob
+void PipelineState::writeColorExportState(StateBlobWriter &writer) {
+  writer.writeWord(m_colorExportFormats.size());
+  for (const ColorExportFormat &target : m_colorExportFormats)
+    writer.writeArrayOfInt32(target);
+  writer.writeArrayOfInt32(m_colorExportState);
+}
 
-  setNamedMetadataToArrayOfInt32(module, m_colorExportState, ColorExportStateMetadataName);
+// =====================================================================================================================
+// Read color export state (including formats) from the pipeline state blob
+//
+// @param [in/out] reader : Reader of the pipeline state blob
+void PipelineState::readColorExportState(StateBlobReader &reader) {
+  m_colorExportFormats.resize(reader.readCount());
+  for (ColorExportFormat &target : m_colorExportFormats)
+    reader.readArrayOfInt32(target);
+  reader.readArrayOfInt32(m_colorExportState);
 }
 
 // =====================================================================================================================
@@ -955,14 +1132,6 @@ void PipelineState::setGraphicsState(const InputAssemblyState &iaState, const Vi
   m_rasterizerState = rsState;
 }
 
-// =====================================================================================================================
-// Record device index into the IR metadata
-//
-// @param [in/out] module : IR module to record into
-void PipelineState::recordDeviceIndex(Module *module) {
-  setNamedMetadataToArrayOfInt32(module, m_deviceIndex, DeviceIndexMetadataName);
-}
-
 // =====================================================================================================================
 // Read device index from the IR metadata
 //
@@ -972,13 +1141,23 @@ void PipelineState::readDeviceIndex(Module *module) {
 }
 
 // =====================================================================================================================
-// Record graphics state (iastate, vpstate, rsstate) into the IR metadata
+// Write graphics state (iastate, vpstate, rsstate) into the pipeline state blob
 //
-// @param [in/out] module : IR module to record into
-void PipelineState::recordGraphicsState(Module *module) {
-  setNamedMetadataToArrayOfInt32(module, m_inputAssemblyState, IaStateMetadataName);
-  setNamedMetadataToArrayOfInt32(module, m_viewportState, VpStateMetadataName);
-  setNamedMetadataToArrayOfInt32(module, m_rasterizerState, RsStateMetadataName);
+// @param [in/out] writer : Writer of the pipeline state blob
+void PipelineState::writeGraphicsState(StateBlobWriter &writer) {
+  writer.writeArrayOfInt32(m_inputAssemblyState);
+  writer.writeArrayOfInt32(m_viewportState);
+  writer.writeArrayOfInt32(m_rasterizerState);
+}
+
+// =====================================================================================================================
+// Read graphics state (iastate, vpstate, rsstate) from the pipeline state blob
+//
+// @param [in/out] reader : Reader of the pipeline state blob
+void PipelineState::readGraphicsState(StateBlobReader &reader) {
+  reader.readArrayOfInt32(m_inputAssemblyState);
+  reader.readArrayOfInt32(m_viewportState);
+  reader.readArrayOfInt32(m_rasterizerState);
 }
 
 // =====================================================================================================================
@@ -991,6 +1170,92 @@ void PipelineState::readGraphicsState(Module *module) {
   readNamedMetadataArrayOfInt32(module, RsStateMetadataName, m_rasterizerState);
 }
 
+// =====================================================================================================================
+// Set the attribute interface of the other half-pipeline from its ELF, when compiling an unlinked half-pipeline
+// against it. The interface is read from the PAL metadata note, where it was written by ConfigBuilder when the
+// other half-pipeline was compiled.
+//
+// @param otherElf : ELF for the other half-pipeline
+// @returns : False, with an error set, if the ELF is invalid or does not contain an attribute interface
+bool PipelineState::setOtherPartElf(MemoryBufferRef otherElf) {
+  m_hasOtherPartInterface = false;
+  m_otherPartInterface.clear();
+
+  auto objectFile = object::ObjectFile::createELFObjectFile(otherElf);
+  if (!objectFile) {
+    consumeError(objectFile.takeError());
+    setError("Invalid ELF for other half-pipeline");
+    return false;
+  }
+  auto elfObjectFile = dyn_cast<object::ELFObjectFile<object::ELF64LE>>(&**objectFile);
+  if (!elfObjectFile) {
+    setError("Invalid ELF for other half-pipeline");
+    return false;
+  }
+
+  // Find the PAL metadata note, and get the attribute interface out of it.
+  auto &elfFile = elfObjectFile->getELFFile();
+  for (const object::SectionRef &section : elfObjectFile->sections()) {
+    object::ELFSectionRef elfSection(section);
+    if (elfSection.getType() != ELF::SHT_NOTE)
+      continue;
+    Error err = ErrorSuccess();
+    auto shdr = cantFail(elfFile.getSection(elfSection.getIndex()));
+    for (auto note : elfFile.notes(*shdr, err)) {
+      if (note.getName() == Util::Abi::AmdGpuArchName && note.getType() == ELF::NT_AMDGPU_METADATA) {
+        ArrayRef<uint8_t> desc = note.getDesc();
+        PalMetadata palMetadata(this, StringRef(reinterpret_cast<const char *>(desc.data()), desc.size()));
+        m_hasOtherPartInterface |= palMetadata.getParamInterfaceInfo(m_otherPartInterface);
+      }
+    }
+    consumeError(std::move(err));
+  }
+
+  if (!m_hasOtherPartInterface) {
+    setError("Other half-pipeline ELF has no attribute interface");
+    return false;
+  }
+  return true;
+}
+
+// =====================================================================================================================
+// Record the attribute interface of the other half-pipeline into IR metadata. The named metadata node is present
+// (possibly with no operands) only when compiling against the other half-pipeline ELF.
+//
+// @param [in/out] module : IR module to record into
+void PipelineState::recordOtherPartInterface(Module *module) {
+  if (!m_hasOtherPartInterface) {
+    if (auto otherPartMetaNode = module->getNamedMetadata(OtherPartInterfaceMetadataName))
+      module->eraseNamedMetadata(otherPartMetaNode);
+    return;
+  }
+
+  auto otherPartMetaNode = module->getOrInsertNamedMetadata(OtherPartInterfaceMetadataName);
+  otherPartMetaNode->clearOperands();
+  for (const ParamInterfaceInfo &param : m_otherPartInterface) {
+    unsigned values[] = {param.location, param.isBuiltIn, param.param};
+    otherPartMetaNode->addOperand(getArrayOfInt32MetaNode(getContext(), values, /*atLeastOneValue=*/true));
+  }
+}
+
+// =====================================================================================================================
+// Read the attribute interface of the other half-pipeline from IR metadata
+//
+// @param module : IR module to read from
+void PipelineState::readOtherPartInterface(Module *module) {
+  m_otherPartInterface.clear();
+  auto otherPartMetaNode = module->getNamedMetadata(OtherPartInterfaceMetadataName);
+  m_hasOtherPartInterface = otherPartMetaNode != nullptr;
+  if (!otherPartMetaNode)
+    return;
+
+  for (unsigned nodeIndex = 0; nodeIndex != otherPartMetaNode->getNumOperands(); ++nodeIndex) {
+    unsigned values[3] = {};
+    readArrayOfInt32MetaNode(otherPartMetaNode->getOperand(nodeIndex), values);
+    m_otherPartInterface.push_back({values[0], values[1] != 0, values[2]});
+  }
+}
+
 // =====================================================================================================================
 // Determine whether to use off-chip tessellation mode
 bool PipelineState::isTessOffChip() {
@@ -32,6 +32,7 @@
 #include "lgc/state/ShaderModes.h"
 #include "lgc/state/IntrinsDefs.h"
 #include "lgc/state/PipelineState.h"
+#include "lgc/state/StateBlob.h"
 
 #define DEBUG_TYPE "lgc-shader-modes"
 
@@ -233,3 +234,37 @@ void ShaderModes::readModesFromPipeline(Module *module) {
   PipelineState::readNamedMetadataArrayOfInt32(module, FragmentShaderModeMetadataName, m_fragmentShaderMode);
   PipelineState::readNamedMetadataArrayOfInt32(module, ComputeShaderModeMetadataName, m_computeShaderMode);
 }
+
+// =====================================================================================================================
+// Write shader modes (common and specific) into the pipeline state blob
+//
+// @param [in/out] writer : Writer of the pipeline state blob
+void ShaderModes::writeState(StateBlobWriter &writer) const {
+  writer.writeWord(ArrayRef<CommonShaderMode>(m_commonShaderModes).size());
+  for (const CommonShaderMode &commonShaderMode : m_commonShaderModes)
+    writer.writeArrayOfInt32(commonShaderMode);
+
+  writer.writeArrayOfInt32(m_tessellationMode);
+  writer.writeArrayOfInt32(m_geometryShaderMode);
+  writer.writeArrayOfInt32(m_fragmentShaderMode);
+  writer.writeArrayOfInt32(m_computeShaderMode);
+}
+
+// =====================================================================================================================
+// Read shader modes (common and specific) from the pipeline state blob
+//
+// @param [in/out] reader : Reader of the pipeline state blob
+void ShaderModes::readState(StateBlobReader &reader) {
+  unsigned stageCount = reader.readCount();
+  if (stageCount > ArrayRef<CommonShaderMode>(m_commonShaderModes).size()) {
+    reader.setError();
+    return;
+  }
+  for (unsigned stage = 0; stage != stageCount; ++stage)
+    reader.readArrayOfInt32(m_commonShaderModes[stage]);
+
+  reader.readArrayOfInt32(m_tessellationMode);
+  reader.readArrayOfInt32(m_geometryShaderMode);
+  reader.readArrayOfInt32(m_fragmentShaderMode);
+  reader.readArrayOfInt32(m_computeShaderMode);
+}
@@ -25,13 +25,17 @@
 /**
  ***********************************************************************************************************************
  * @file  PassManager.cpp
- * @brief LLPC source file: contains implementation of class lgc::PassManagerImpl.
+ * @brief LLPC source file: contains implementation of classes lgc::PassManagerImpl and lgc::NewPassManagerImpl.
  ***********************************************************************************************************************
  */
 #include "lgc/PassManager.h"
+#include "lgc/LgcContext.h"
 #include "lgc/util/Debug.h"
 #include "llvm/Analysis/CFGPrinter.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/PassInstrumentation.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Passes/PassBuilder.h"
 #include "llvm/Support/CommandLine.h"
 
 namespace llvm {
@@ -65,7 +69,7 @@ namespace {
 // This is the implementation subclass of the PassManager class declared in PassManager.h
 class PassManagerImpl final : public lgc::PassManager {
 public:
-  PassManagerImpl();
+  PassManagerImpl(LgcContext *lgcContext);
   ~PassManagerImpl() override {}
 
   void setPassIndex(unsigned *passIndex) override { m_passIndex = passIndex; }
@@ -78,6 +82,74 @@ private:
   AnalysisID m_printModule = nullptr;   // Pass id of dump pass "Print Module IR"
   AnalysisID m_jumpThreading = nullptr; // Pass id of opt pass "Jump Threading"
   unsigned *m_passIndex = nullptr;      // Pass Index
+  LgcContext *m_lgcContext = nullptr;   // LgcContext whose cancel check is polled between passes
+};
+
+// =====================================================================================================================
+// Module pass polling whether the compile has been cancelled, added after each module pass
+class CancelCheckModulePass final : public ModulePass {
+public:
+  static char ID;
+  CancelCheckModulePass(LgcContext *lgcContext) : ModulePass(ID), m_lgcContext(lgcContext) {}
+
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override { analysisUsage.setPreservesAll(); }
+
+  bool runOnModule(Module &module) override {
+    m_lgcContext->isCancelled();
+    return false;
+  }
+
+  StringRef getPassName() const override { return "LLPC cancel check (module)"; }
+
+private:
+  LgcContext *m_lgcContext; // LgcContext whose cancel check is polled
+};
+
+char CancelCheckModulePass::ID = 0;
+
+// =====================================================================================================================
+// Function pass polling whether the compile has been cancelled, added after each function pass. Being a function pass,
+// it does not break up the sequence of function passes that the pass manager runs on one function at a time.
+class CancelCheckFunctionPass final : public FunctionPass {
+public:
+  static char ID;
+  CancelCheckFunctionPass(LgcContext *lgcContext) : FunctionPass(ID), m_lgcContext(lgcContext) {}
+
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override { analysisUsage.setPreservesAll(); }
+
+  bool runOnFunction(Function &function) override {
+    m_lgcContext->isCancelled();
+    return false;
+  }
+
+  StringRef getPassName() const override { return "LLPC cancel check (function)"; }
+
+private:
+  LgcContext *m_lgcContext; // LgcContext whose cancel check is polled
+};
+
+char CancelCheckFunctionPass::ID = 0;
+
+// =====================================================================================================================
+// LLPC's new pass manager override.
+// This is the implementation subclass of the NewPassManager class declared in PassManager.h
+class NewPassManagerImpl final : public lgc::NewPassManager {
+public:
+  NewPassManagerImpl(TargetMachine *targetMachine);
+  ~NewPassManagerImpl() override {}
+
+  void setTargetLibraryInfo(const TargetLibraryInfoImpl &targetLibInfo) override;
+  PassInstrumentationCallbacks &getInstrumentationCallbacks() override { return m_instrumentationCallbacks; }
+  void run(Module &module) override;
+
+private:
+  PassInstrumentationCallbacks m_instrumentationCallbacks; // Callbacks run around each pass
+  PassBuilder m_passBuilder;                               // Pass builder, used to register the analyses
+  LoopAnalysisManager m_loopAnalysisManager;               // Loop analysis manager
+  FunctionAnalysisManager m_functionAnalysisManager;       // Function analysis manager
+  CGSCCAnalysisManager m_cgsccAnalysisManager;             // CGSCC analysis manager
+  ModuleAnalysisManager m_moduleAnalysisManager;           // Module analysis manager
+  bool m_registeredAnalyses = false;                       // Whether the standard analyses are registered
 };
 
 } // namespace
@@ -109,12 +181,16 @@ static AnalysisID getPassIdFromName(StringRef passName) {
 
 // =====================================================================================================================
 // Create a PassManagerImpl
-lgc::PassManager *lgc::PassManager::Create() {
-  return new PassManagerImpl;
+//
+// @param lgcContext : LgcContext whose cancel check is polled between passes, or nullptr
+lgc::PassManager *lgc::PassManager::Create(LgcContext *lgcContext) {
+  return new PassManagerImpl(lgcContext);
 }
 
 // =====================================================================================================================
-PassManagerImpl::PassManagerImpl() : PassManager() {
+//
+// @param lgcContext : LgcContext whose cancel check is polled between passes, or nullptr
+PassManagerImpl::PassManagerImpl(LgcContext *lgcContext) : PassManager(), m_lgcContext(lgcContext) {
   if (!cl::DumpCfgAfter.empty())
     m_dumpCfgAfter = getPassIdFromName(cl::DumpCfgAfter);
 
@@ -163,6 +239,15 @@ void PassManagerImpl::add(Pass *pass) {
     // Add a CFG printer pass after it.
     legacy::PassManager::add(createCFGPrinterLegacyPassPass());
   }
+
+  if (m_lgcContext && m_lgcContext->hasCancelCheck()) {
+    // Add a cancel check after it. Only module and function passes are followed by one, so that loop and CGSCC
+    // passes still get grouped together.
+    if (pass->getPassKind() == PT_Module)
+      legacy::PassManager::add(new CancelCheckModulePass(m_lgcContext));
+    else if (pass->getPassKind() == PT_Function)
+      legacy::PassManager::add(new CancelCheckFunctionPass(m_lgcContext));
+  }
 }
 
 // =====================================================================================================================
@@ -170,3 +255,62 @@ void PassManagerImpl::add(Pass *pass) {
 void PassManagerImpl::stop() {
   m_stopped = true;
 }
+
+// =====================================================================================================================
+// Create a NewPassManagerImpl
+//
+// @param targetMachine : Target machine, used by the target-specific analyses
+lgc::NewPassManager *lgc::NewPassManager::Create(TargetMachine *targetMachine) {
+  return new NewPassManagerImpl(targetMachine);
+}
+
+// =====================================================================================================================
+// Constructor
+//
+// @param targetMachine : Target machine, used by the target-specific analyses
+NewPassManagerImpl::NewPassManagerImpl(TargetMachine *targetMachine)
+    : m_passBuilder(/*DebugLogging=*/false, targetMachine, PipelineTuningOptions(), None,
+                    &m_instrumentationCallbacks) {
+  if (cl::VerifyIr) {
+    // Verify the IR after each pass. The pass indices used by -dump-pass-name and -disable-pass-indices are only
+    // supported by the legacy pass manager.
+    m_instrumentationCallbacks.registerAfterPassCallback([](StringRef passName, Any ir, const PreservedAnalyses &) {
+      const Module *module = nullptr;
+      if (any_isa<const Module *>(ir))
+        module = any_cast<const Module *>(ir);
+      else if (any_isa<const Function *>(ir))
+        module = any_cast<const Function *>(ir)->getParent();
+      if (module && verifyModule(*module, &errs()))
+        report_fatal_error(Twine("Broken module found after pass ") + passName);
+    });
+  }
+}
+
+// =====================================================================================================================
+// Set the target library info used by analyses and optimizations, in place of the default one for the target triple.
+// This must be called before the standard analyses are registered in the first run.
+//
+// @param targetLibInfo : Target library info
+void NewPassManagerImpl::setTargetLibraryInfo(const TargetLibraryInfoImpl &targetLibInfo) {
+  assert(!m_registeredAnalyses);
+  m_functionAnalysisManager.registerPass([=] { return TargetLibraryAnalysis(targetLibInfo); });
+}
+
+// =====================================================================================================================
+// Run the passes on the module.
+//
+// @param [in/out] module : Module to run the passes on
+void NewPassManagerImpl::run(Module &module) {
+  if (!m_registeredAnalyses) {
+    // Register the standard analyses. An analysis that is already registered (such as the target library info) is
+    // not replaced.
+    m_passBuilder.registerModuleAnalyses(m_moduleAnalysisManager);
+    m_passBuilder.registerCGSCCAnalyses(m_cgsccAnalysisManager);
+    m_passBuilder.registerFunctionAnalyses(m_functionAnalysisManager);
+    m_passBuilder.registerLoopAnalyses(m_loopAnalysisManager);
+    m_passBuilder.crossRegisterProxies(m_loopAnalysisManager, m_functionAnalysisManager, m_cgsccAnalysisManager,
+                                       m_moduleAnalysisManager);
+    m_registeredAnalyses = true;
+  }
+  ModulePassManager::run(module, m_moduleAnalysisManager);
+}
@@ -57,11 +57,13 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
 
+#include <algorithm>
 #include <mutex>
 #include <set>
 #include <unordered_set>
@@ -145,6 +147,12 @@ opt<bool> EnableSpirvOpt("enable-spirv-opt", desc("Enable optimization for SPIR-
 opt<bool> EnableShaderModuleOpt("enable-shader-module-opt",
                                 cl::desc("Enable translate & lower phase in shader module build."), init(false));
 
+// -enable-symbolic-spec-const: Translate & lower shader modules that use specialization constants in shader module
+// build, keeping the specialization constants symbolic until the pipeline is built.
+opt<bool> EnableSymbolicSpecConst("enable-symbolic-spec-const",
+                                  cl::desc("Keep specialization constants symbolic in shader module build"),
+                                  init(false));
+
 // -trim-debug-info: Trim debug information in SPIR-V binary
 opt<bool> TrimDebugInfo("trim-debug-info", cl::desc("Trim debug information in SPIR-V binary"), init(true));
 
@@ -155,6 +163,18 @@ opt<bool> EnablePerStageCache("enable-per-stage-cache", cl::desc("Enable shader
 opt<int> ContextReuseLimit("context-reuse-limit",
                            cl::desc("The maximum number of times a compiler context can be reused"), init(100));
 
+// -max-concurrent-compiles: The maximum number of compiles that can hold a context at once.
+opt<unsigned> MaxConcurrentCompiles("max-concurrent-compiles",
+                                    cl::desc("The maximum number of compiles that can hold a context at once "
+                                             "(0 for no limit)"),
+                                    init(0));
+
+// -max-low-priority-compiles: The maximum number of low priority compiles that can hold a context at once.
+opt<unsigned> MaxLowPriorityCompiles("max-low-priority-compiles",
+                                     cl::desc("The maximum number of low priority compiles that can hold a context "
+                                              "at once (0 for half the hardware threads)"),
+                                     init(0));
+
 // -fatal-llvm-errors: Make all LLVM errors fatal
 opt<bool> FatalLlvmErrors("fatal-llvm-errors", cl::desc("Make all LLVM errors fatal"), init(false));
 
@@ -179,6 +199,11 @@ namespace Llpc {
 
 sys::Mutex Compiler::m_contextPoolMutex;
 std::vector<Context *> *Compiler::m_contextPool = nullptr;
+std::condition_variable_any Compiler::m_contextPoolCondition;
+uint64_t Compiler::m_nextContextTicket = 0;
+unsigned Compiler::m_activeContextCount = 0;
+unsigned Compiler::m_activeLowPriorityContextCount = 0;
+std::vector<std::pair<CompilePriority, uint64_t>> Compiler::m_contextWaiters;
 
 // Enumerates modes used in shader replacement
 enum ShaderReplaceMode {
@@ -382,6 +407,15 @@ Compiler::Compiler(GfxIpVersion gfxIp, unsigned optionCount, const char *const *
 
 // =====================================================================================================================
 Compiler::~Compiler() {
+  // Deliver the pending tiered rebuilds before tearing anything down.
+  {
+    std::lock_guard<std::mutex> lock(m_tieredRebuildMutex);
+    m_tieredRebuildStop = true;
+  }
+  m_tieredRebuildCondition.notify_all();
+  if (m_tieredRebuildThread.joinable())
+    m_tieredRebuildThread.join();
+
   bool shutdown = false;
   {
     // Free context pool
@@ -531,7 +565,12 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
     // Do SPIR-V translate & lower if possible
     bool enableOpt = cl::EnableShaderModuleOpt;
     enableOpt = enableOpt || shaderInfo->options.enableOpt;
-    enableOpt = moduleDataEx.common.usage.useSpecConstant ? false : enableOpt;
+    // A module that uses specialization constants can only be translated before its specialization is known if the
+    // specialization constants can be kept symbolic, to be bound when the pipeline is built.
+    const bool symbolicSpecConsts = moduleDataEx.common.usage.useSpecConstant;
+    if (symbolicSpecConsts &&
+        !(cl::EnableSymbolicSpecConst && ShaderModuleHelper::canKeepSpecConstsSymbolic(&moduleDataEx.common.binCode)))
+      enableOpt = false;
 
     if (enableOpt) {
       // Check internal cache for shader module build result
@@ -596,7 +635,8 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
           shaderInfo.pModuleData = &moduleDataEx.common;
           shaderInfo.entryStage = entryNames[i].stage;
           shaderInfo.pEntryTarget = entryNames[i].name;
-          lowerPassMgr->add(createSpirvLowerTranslator(static_cast<ShaderStage>(entryNames[i].stage), &shaderInfo));
+          lowerPassMgr->add(createSpirvLowerTranslator(static_cast<ShaderStage>(entryNames[i].stage), &shaderInfo,
+                                                       symbolicSpecConsts));
           bool collectDetailUsage =
               entryNames[i].stage == ShaderStageFragment || entryNames[i].stage == ShaderStageCompute;
           auto resCollectPass =
@@ -793,13 +833,48 @@ Result Compiler::buildPipelineWithRelocatableElf(Context *context, ArrayRef<cons
   bool isUnlinkedPipeline = context->getPipelineContext()->isUnlinked();
   context->getPipelineContext()->setUnlinked(true);
 
+  // When linking a pipeline with tessellation or geometry shaders, compile all the vertex-processing stages together
+  // as one half-pipeline ELF, kept in the vertex shader slot. The merged shaders (LS-HS, ES-GS), the copy shader, and
+  // the ring and LDS layouts between the stages all depend on more than one of those stages.
+  unsigned vertexHalfStageMask = 0;
+  if (!isUnlinkedPipeline) {
+    for (ShaderStage stage : {ShaderStageVertex, ShaderStageTessControl, ShaderStageTessEval, ShaderStageGeometry}) {
+      if (stage < shaderInfo.size() && shaderInfo[stage] && shaderInfo[stage]->pModuleData)
+        vertexHalfStageMask |= shaderStageToMask(stage);
+    }
+    if (vertexHalfStageMask == shaderStageToMask(ShaderStageVertex))
+      vertexHalfStageMask = 0;
+  }
+
   ElfPackage elf[ShaderStageNativeStageCount];
+  MetroHash::Hash stageCacheHashes[ShaderStageNativeStageCount] = {};
   assert(stageCacheAccesses.size() >= shaderInfo.size());
   for (unsigned stage = 0; stage < shaderInfo.size() && result == Result::Success; ++stage) {
     if (!shaderInfo[stage] || !shaderInfo[stage]->pModuleData)
       continue;
 
-    context->getPipelineContext()->setShaderStageMask(shaderStageToMask(static_cast<ShaderStage>(stage)));
+    unsigned stageMask = shaderStageToMask(static_cast<ShaderStage>(stage));
+    if (vertexHalfStageMask & stageMask) {
+      // The vertex-processing half-pipeline is compiled once, for its first stage.
+      if (stage != countTrailingZeros(vertexHalfStageMask))
+        continue;
+      stageMask = vertexHalfStageMask;
+    }
+    context->getPipelineContext()->setShaderStageMask(stageMask);
+
+    auto setCacheAccess = [&](CacheAccessInfo cacheAccess) {
+      for (unsigned maskStage = 0; maskStage < shaderInfo.size(); ++maskStage) {
+        if (stageMask & shaderStageToMask(static_cast<ShaderStage>(maskStage)))
+          stageCacheAccesses[maskStage] = cacheAccess;
+      }
+    };
+
+    // When linking, compile the fragment shader against the vertex-processing ELF (from the cache or just compiled),
+    // so the fragment shader reads its inputs from where the vertex shader exports them. The vertex shader does
+    // not depend on the fragment shader, so changing only the fragment shader costs only a fragment shader compile.
+    const ElfPackage *otherElf = nullptr;
+    if (!isUnlinkedPipeline && stage == ShaderStageFragment && !elf[ShaderStageVertex].empty())
+      otherElf = &elf[ShaderStageVertex];
 
     // Check the cache for the relocatable shader for this stage.
     MetroHash::Hash cacheHash = {};
@@ -808,10 +883,36 @@ Result Compiler::buildPipelineWithRelocatableElf(Context *context, ArrayRef<cons
     if (context->isGraphics()) {
       auto pipelineInfo = reinterpret_cast<const GraphicsPipelineBuildInfo *>(context->getPipelineBuildInfo());
       cacheHash = PipelineDumper::generateHashForGraphicsPipeline(pipelineInfo, true, true, stage);
+      if (stageMask != shaderStageToMask(static_cast<ShaderStage>(stage))) {
+        // The vertex-processing half-pipeline is keyed on all of its stages.
+        MetroHash64 hasher;
+        for (unsigned maskStage = 0; maskStage < shaderInfo.size(); ++maskStage) {
+          if (stageMask & shaderStageToMask(static_cast<ShaderStage>(maskStage)))
+            hasher.Update(PipelineDumper::generateHashForGraphicsPipeline(pipelineInfo, true, true, maskStage));
+        }
+        hasher.Finalize(cacheHash.bytes);
+      }
 #if LLPC_ENABLE_SHADER_CACHE
       userShaderCache = reinterpret_cast<IShaderCache *>(pipelineInfo->pShaderCache);
 #endif
       userCache = pipelineInfo->cache;
+
+      if ((stageMask & shaderStageToMask(ShaderStageFragment)) && PipelineContext::isColorExportInUnlinkedShader()) {
+        // The color export state is compiled into the fragment shader instead of being left to link time, so include
+        // it in the cache key.
+        MetroHash64 hasher;
+        hasher.Update(cacheHash);
+        PipelineDumper::updateHashForFragmentState(pipelineInfo, &hasher, false);
+        hasher.Finalize(cacheHash.bytes);
+      }
+
+      if (otherElf) {
+        // The compiled fragment shader depends on the vertex shader ELF, so include that in the cache key.
+        MetroHash64 hasher;
+        hasher.Update(cacheHash);
+        hasher.Update(stageCacheHashes[ShaderStageVertex]);
+        hasher.Finalize(cacheHash.bytes);
+      }
     } else {
       auto pipelineInfo = reinterpret_cast<const ComputePipelineBuildInfo *>(context->getPipelineBuildInfo());
       cacheHash = PipelineDumper::generateHashForComputePipeline(pipelineInfo, true, true);
@@ -821,6 +922,8 @@ Result Compiler::buildPipelineWithRelocatableElf(Context *context, ArrayRef<cons
       userCache = pipelineInfo->cache;
     }
 
+    stageCacheHashes[stage] = cacheHash;
+
     ShaderEntryState cacheEntryState = ShaderEntryState::New;
     BinaryData elfBin = {};
 
@@ -834,34 +937,44 @@ Result Compiler::buildPipelineWithRelocatableElf(Context *context, ArrayRef<cons
       // Release Entry
       ReleaseCacheEntry(false, nullptr, &cacheEntry);
       LLPC_OUTS("Cache hit for shader stage " << getShaderStageName(static_cast<ShaderStage>(stage)) << "\n");
-      stageCacheAccesses[stage] = CacheAccessInfo::CacheHit;
+      setCacheAccess(CacheAccessInfo::CacheHit);
       continue;
     }
 
     ShaderCache *shaderCache;
     CacheEntryHandle hEntry;
-    cacheEntryState = lookUpShaderCaches(userShaderCache, &cacheHash, &elfBin, &shaderCache, &hEntry);
+    cacheEntryState = lookUpShaderCaches(userShaderCache, &cacheHash, &elfBin, &shaderCache, &hEntry,
+                                         context->getCompilePriority());
 
     if (cacheEntryState == ShaderEntryState::Ready) {
       auto data = reinterpret_cast<const char *>(elfBin.pCode);
       elf[stage].assign(data, data + elfBin.codeSize);
       LLPC_OUTS("Cache hit for shader stage " << getShaderStageName(static_cast<ShaderStage>(stage)) << "\n");
       if (userShaderCache == nullptr)
-        stageCacheAccesses[stage] = CacheAccessInfo::InternalCacheHit;
+        setCacheAccess(CacheAccessInfo::InternalCacheHit);
       else
-        stageCacheAccesses[stage] = CacheAccessInfo::CacheHit;
+        setCacheAccess(CacheAccessInfo::CacheHit);
       continue;
     }
     LLPC_OUTS("Cache miss for shader stage " << getShaderStageName(static_cast<ShaderStage>(stage)) << "\n");
-    stageCacheAccesses[stage] = CacheAccessInfo::CacheMiss;
+    setCacheAccess(CacheAccessInfo::CacheMiss);
 
-    // There was a cache miss, so we need to build the relocatable shader for
+    // There was a cache miss, so we need to build the relocatable shader (or vertex-processing half-pipeline) for
     // this stage.
     const PipelineShaderInfo *singleStageShaderInfo[ShaderStageNativeStageCount] = {nullptr, nullptr, nullptr,
                                                                                     nullptr, nullptr, nullptr};
-    singleStageShaderInfo[stage] = shaderInfo[stage];
+    for (unsigned maskStage = 0; maskStage < shaderInfo.size(); ++maskStage) {
+      if (stageMask & shaderStageToMask(static_cast<ShaderStage>(maskStage)))
+        singleStageShaderInfo[maskStage] = shaderInfo[maskStage];
+    }
 
-    result = buildPipelineInternal(context, singleStageShaderInfo, /*unlinked=*/true, &elf[stage]);
+    result = buildPipelineInternal(context, singleStageShaderInfo, /*unlinked=*/true, &elf[stage], otherElf);
+    if (result != Result::Success && result != Result::ErrorCancelled && otherElf) {
+      // The other ELF could not be used (for example, it predates recording the attribute interface), so fall back
+      // to compiling the fragment shader on its own.
+      elf[stage].clear();
+      result = buildPipelineInternal(context, singleStageShaderInfo, /*unlinked=*/true, &elf[stage]);
+    }
 
     // Add the result to the cache.
     if (result == Result::Success) {
@@ -875,6 +988,10 @@ Result Compiler::buildPipelineWithRelocatableElf(Context *context, ArrayRef<cons
   context->getPipelineContext()->setShaderStageMask(originalShaderStageMask);
   context->getPipelineContext()->setUnlinked(false);
 
+  // Do not spend time linking the shaders of an abandoned build.
+  if (result == Result::ErrorCancelled)
+    return result;
+
   if (!isUnlinkedPipeline) {
     // Link the relocatable shaders into a single pipeline elf file.
     linkRelocatableShaderElf(elf, pipelineElf, context);
@@ -964,11 +1081,10 @@ static bool hasUnrelocatableDescriptorNode(const ResourceMappingData *resourceMa
 bool Compiler::canUseRelocatableGraphicsShaderElf(const ArrayRef<const PipelineShaderInfo *> &shaderInfos,
                                                   const GraphicsPipelineBuildInfo *pipelineInfo) {
   if (!pipelineInfo->unlinked) {
-    for (unsigned stage = 0; stage < shaderInfos.size(); ++stage) {
-      if (stage != ShaderStageVertex && stage != ShaderStageFragment) {
-        if (shaderInfos[stage] && shaderInfos[stage]->pModuleData)
-          return false;
-      } else if (!shaderInfos[stage] || !shaderInfos[stage]->pModuleData) {
+    // Tessellation and geometry shaders are compiled together with the vertex shader, as the vertex-processing
+    // half-pipeline.
+    for (ShaderStage stage : {ShaderStageVertex, ShaderStageFragment}) {
+      if (!shaderInfos[stage] || !shaderInfos[stage]->pModuleData) {
         // TODO: Generate pass-through shaders when the fragment or vertex shaders are missing.
         return false;
       }
@@ -1029,6 +1145,25 @@ bool Compiler::canUseRelocatableComputeShaderElf(const ComputePipelineBuildInfo
   return true;
 }
 
+// =====================================================================================================================
+// Sets the optimization level of an LgcContext for the lifetime of the object, and restores the previous level when it
+// is destroyed.
+class OptimizationLevelScope {
+public:
+  OptimizationLevelScope(LgcContext *lgcContext, CodeGenOpt::Level level)
+      : m_lgcContext(lgcContext), m_savedLevel(lgcContext->getOptimizationLevel()) {
+    m_lgcContext->setOptimizationLevel(level);
+  }
+  ~OptimizationLevelScope() { m_lgcContext->setOptimizationLevel(m_savedLevel); }
+
+private:
+  OptimizationLevelScope(const OptimizationLevelScope &) = delete;
+  OptimizationLevelScope &operator=(const OptimizationLevelScope &) = delete;
+
+  LgcContext *m_lgcContext;       // Middle-end context whose optimization level is set
+  CodeGenOpt::Level m_savedLevel; // Optimization level to restore
+};
+
 // =====================================================================================================================
 // Build pipeline internally -- common code for graphics and compute
 //
@@ -1036,8 +1171,10 @@ bool Compiler::canUseRelocatableComputeShaderElf(const ComputePipelineBuildInfo
 // @param shaderInfo : Shader info of this pipeline
 // @param unlinked : Do not provide some state to LGC, so offsets are generated as relocs
 // @param [out] pipelineElf : Output Elf package
+// @param otherElf : Optional ELF of the vertex-processing half-pipeline to compile an unlinked fragment
+//                   half-pipeline against
 Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const PipelineShaderInfo *> shaderInfo, bool unlinked,
-                                       ElfPackage *pipelineElf) {
+                                       ElfPackage *pipelineElf, const ElfPackage *otherElf) {
   Result result = Result::Success;
   unsigned passIndex = 0;
   const PipelineShaderInfo *fragmentShaderInfo = nullptr;
@@ -1051,8 +1188,12 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
   context->setScalarBlockLayout(context->getPipelineContext()->getPipelineOptions()->scalarBlockLayout);
   context->setRobustBufferAccess(context->getPipelineContext()->getPipelineOptions()->robustBufferAccess);
 
-  // Set up middle-end objects.
+  // Set up middle-end objects. The quick first tier of a tiered compile uses the minimal optimization set. The
+  // context is pooled, so its previous optimization level is restored on return, for the compiles that reuse it.
   LgcContext *builderContext = context->getLgcContext();
+  OptimizationLevelScope optLevelScope(builderContext, context->getPipelineContext()->isQuickTier()
+                                                           ? CodeGenOpt::None
+                                                           : LgcContext::getDefaultOptimizationLevel());
   std::unique_ptr<Pipeline> pipeline(builderContext->createPipeline());
   context->getPipelineContext()->setPipelineState(&*pipeline, unlinked);
   context->setBuilder(builderContext->createBuilder(&*pipeline, UseBuilderRecorder));
@@ -1131,7 +1272,12 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
       if (!shaderInfoEntry || !shaderInfoEntry->pModuleData || (stageSkipMask & shaderStageToMask(entryStage)))
         continue;
 
-      std::unique_ptr<lgc::PassManager> lowerPassMgr(lgc::PassManager::Create());
+      if (context->isBuildCancelled()) {
+        result = Result::ErrorCancelled;
+        break;
+      }
+
+      std::unique_ptr<lgc::PassManager> lowerPassMgr(lgc::PassManager::Create(context->getLgcContext()));
       lowerPassMgr->setPassIndex(&passIndex);
 
       // Set the shader stage in the Builder.
@@ -1167,13 +1313,31 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
         continue;
       if (stageSkipMask & shaderStageToMask(entryStage)) {
         // Do not run SPIR-V translator and lowering passes on this shader; we were given it as IR ready
-        // to link into pipeline module.
+        // to link into pipeline module. If it was lowered with symbolic specialization constants, bind them now.
+        auto moduleDataEx = reinterpret_cast<const ShaderModuleDataEx *>(shaderInfoEntry->pModuleData);
+        if (moduleDataEx->common.usage.useSpecConstant) {
+          context->getBuilder()->setShaderStage(getLgcShaderStage(entryStage));
+          std::unique_ptr<lgc::PassManager> specPassMgr(lgc::PassManager::Create(context->getLgcContext()));
+          specPassMgr->setPassIndex(&passIndex);
+          SpirvLower::addSpecConstPasses(context, shaderInfoEntry->pSpecializationInfo, *specPassMgr,
+                                         timerProfiler.getTimer(TimerLower));
+          if (!runPasses(&*specPassMgr, modules[shaderIndex])) {
+            LLPC_ERRS("Failed to specialize SPIR-V lowering results\n");
+            result = Result::ErrorInvalidShader;
+            break;
+          }
+        }
         modulesToLink.push_back(modules[shaderIndex]);
         continue;
       }
 
+      if (context->isBuildCancelled()) {
+        result = Result::ErrorCancelled;
+        break;
+      }
+
       context->getBuilder()->setShaderStage(getLgcShaderStage(entryStage));
-      std::unique_ptr<lgc::PassManager> lowerPassMgr(lgc::PassManager::Create());
+      std::unique_ptr<lgc::PassManager> lowerPassMgr(lgc::PassManager::Create(context->getLgcContext()));
       lowerPassMgr->setPassIndex(&passIndex);
 
       SpirvLower::addPasses(context, entryStage, *lowerPassMgr, timerProfiler.getTimer(TimerLower)
@@ -1189,14 +1353,23 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
       modulesToLink.push_back(modules[shaderIndex]);
     }
 
-    // Link the shader modules into a single pipeline module.
-    pipelineModule.reset(pipeline->irLink(modulesToLink, context->getPipelineContext()->isUnlinked()));
-    if (!pipelineModule) {
-      LLPC_ERRS("Failed to link shader modules into pipeline module\n");
-      result = Result::ErrorInvalidShader;
+    if (result == Result::ErrorCancelled) {
+      // The build has been abandoned, so free the shader modules rather than linking them.
+      for (Module *module : modules)
+        delete module;
+    } else {
+      // Link the shader modules into a single pipeline module.
+      pipelineModule.reset(pipeline->irLink(modulesToLink, context->getPipelineContext()->isUnlinked()));
+      if (!pipelineModule) {
+        LLPC_ERRS("Failed to link shader modules into pipeline module\n");
+        result = Result::ErrorInvalidShader;
+      }
     }
   }
 
+  if (result == Result::Success && context->isBuildCancelled())
+    result = Result::ErrorCancelled;
+
   // Set up function to check shader cache.
   GraphicsShaderCacheChecker graphicsShaderCacheChecker(this, context);
 
@@ -1231,14 +1404,30 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
           timerProfiler.getTimer(TimerCodeGen),
       };
 
-      pipeline->generate(std::move(pipelineModule), elfStream, checkShaderCacheFunc, timers, {});
-      result = Result::Success;
+      MemoryBufferRef otherElfBuffer;
+      if (otherElf)
+        otherElfBuffer = MemoryBufferRef(StringRef(otherElf->data(), otherElf->size()), "otherElf");
+      bool success =
+          pipeline->generate(std::move(pipelineModule), elfStream, checkShaderCacheFunc, timers, otherElfBuffer);
+      // NOTE: A failure is only reported when compiling against the other half-pipeline ELF, so the caller can
+      // retry without it.
+      if (success || !otherElf)
+        result = Result::Success;
+      else
+        LLPC_ERRS("Failed to compile against other half-pipeline ELF: " << pipeline->getLastError() << "\n");
     }
 #if LLPC_ENABLE_EXCEPTION
     catch (const char *) {
     }
 #endif
   }
+
+  // Once the build has been cancelled, optional passes were skipped, so the output is discarded and not cached.
+  if (context->isBuildCancelled()) {
+    LLPC_ERRS("Pipeline build cancelled\n");
+    result = Result::ErrorCancelled;
+  }
+
   if (checkPerStageCache) {
     // For graphics, update shader caches with results of compile, and merge ELF outputs if necessary.
     graphicsShaderCacheChecker.updateAndMerge(result, pipelineElf);
@@ -1291,13 +1480,15 @@ unsigned GraphicsShaderCacheChecker::check(const Module *module, unsigned stageM
   };
 
   LookupHelperType lookupFragShader = [this, appCache, &fragmentHash]() {
-    m_fragmentCacheEntryState = m_compiler->lookUpShaderCaches(appCache, &fragmentHash, &m_fragmentElf,
-                                                               &m_fragmentShaderCache, &m_hFragmentEntry);
+    m_fragmentCacheEntryState =
+        m_compiler->lookUpShaderCaches(appCache, &fragmentHash, &m_fragmentElf, &m_fragmentShaderCache,
+                                       &m_hFragmentEntry, m_context->getCompilePriority());
   };
 
   LookupHelperType lookupNonFragShader = [this, appCache, &nonFragmentHash]() {
-    m_nonFragmentCacheEntryState = m_compiler->lookUpShaderCaches(appCache, &nonFragmentHash, &m_nonFragmentElf,
-                                                                  &m_nonFragmentShaderCache, &m_hNonFragmentEntry);
+    m_nonFragmentCacheEntryState =
+        m_compiler->lookUpShaderCaches(appCache, &nonFragmentHash, &m_nonFragmentElf, &m_nonFragmentShaderCache,
+                                       &m_hNonFragmentEntry, m_context->getCompilePriority());
   };
 
   auto lookupFragFunc = m_compiler->IsCacheValid() ? lookupFragCache : lookupFragShader;
@@ -1431,6 +1622,19 @@ unsigned Compiler::ConvertColorBufferFormatToExportFormat(const ColorTarget *tar
   return exportFormat;
 }
 
+// =====================================================================================================================
+// Output buffer allocator for the background rebuild of a tiered compile. It allocates the pipeline ELF in the
+// std::vector given as the user data.
+//
+// @param instance : Unused
+// @param userData : std::vector<uint8_t> to allocate the ELF in
+// @param size : Size of the ELF in bytes
+static void *VKAPI_CALL allocateTieredRebuildOutput(void *instance, void *userData, size_t size) {
+  auto elf = static_cast<std::vector<uint8_t> *>(userData);
+  elf->resize(size);
+  return elf->data();
+}
+
 // =====================================================================================================================
 // Build graphics pipeline internally
 //
@@ -1445,8 +1649,10 @@ Result Compiler::buildGraphicsPipelineInternal(GraphicsContext *graphicsContext,
                                                ArrayRef<const PipelineShaderInfo *> shaderInfo,
                                                bool buildingRelocatableElf, ElfPackage *pipelineElf,
                                                MutableArrayRef<CacheAccessInfo> stageCacheAccesses) {
-  Context *context = acquireContext();
+  auto pipelineInfo = reinterpret_cast<const GraphicsPipelineBuildInfo *>(graphicsContext->getPipelineBuildInfo());
+  Context *context = acquireContext(pipelineInfo->priority);
   context->attachPipelineContext(graphicsContext);
+  context->setCancellation(pipelineInfo->cancellation);
   Result result = Result::Success;
   if (buildingRelocatableElf) {
     result = buildPipelineWithRelocatableElf(context, shaderInfo, pipelineElf, stageCacheAccesses);
@@ -1472,9 +1678,16 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
       &pipelineInfo->vs, &pipelineInfo->tcs, &pipelineInfo->tes, &pipelineInfo->gs, &pipelineInfo->fs,
   };
 
+  pipelineOut->tieredRebuildPending = false;
+
   bool buildingRelocatableElf = pipelineInfo->options.enableRelocatableShaderElf || cl::UseRelocatableShaderElf;
   buildingRelocatableElf = buildingRelocatableElf && canUseRelocatableGraphicsShaderElf(shaderInfo, pipelineInfo);
 
+  // A tiered compile first builds the pipeline quickly, and rebuilds it fully optimized in the background. That is
+  // not done when building with relocatable shader elf, as that caches the shader stages separately.
+  const bool tieredCompile = pipelineInfo->tieredCompile.pfnOptimizedPipeline && !buildingRelocatableElf;
+  bool builtQuickTier = false;
+
   for (unsigned i = 0; i < ShaderStageGfxCount && result == Result::Success; ++i)
     result = validatePipelineShaderInfo(shaderInfo[i]);
 
@@ -1524,11 +1737,14 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
 
   if (!buildingRelocatableElf) {
     if (m_cache) {
-      cacheResult = lookUpCaches(userCache, &hashId, &elfBin, &cacheEntry);
+      // A quick first tier is never stored in the cache, so it does not allocate an entry that others would wait
+      // for only to find it failed. The fully optimized rebuild allocates and populates it.
+      cacheResult = lookUpCaches(userCache, &hashId, &elfBin, &cacheEntry, !tieredCompile);
       if (cacheResult == Result::Success)
         pipelineOut->pipelineCacheAccess = CacheAccessInfo::CacheHit;
     } else {
-      cacheEntryState = lookUpShaderCaches(appCache, &cacheHash, &elfBin, &shaderCache, &hEntry);
+      cacheEntryState = lookUpShaderCaches(appCache, &cacheHash, &elfBin, &shaderCache, &hEntry,
+                                           pipelineInfo->priority, !tieredCompile);
       if (cacheEntryState == ShaderEntryState::Ready) {
         if (appCache == nullptr)
           pipelineOut->pipelineCacheAccess = CacheAccessInfo::InternalCacheHit;
@@ -1547,16 +1763,19 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
   if (cacheEntryState == ShaderEntryState::Compiling || (m_cache && cacheResult != Result::Success)) {
 
     GraphicsContext graphicsContext(m_gfxIp, pipelineInfo, &pipelineHash, &cacheHash);
+    graphicsContext.setQuickTier(tieredCompile);
     result = buildGraphicsPipelineInternal(&graphicsContext, shaderInfo, buildingRelocatableElf, &candidateElf,
                                            pipelineOut->stageCacheAccesses);
 
     if (result == Result::Success) {
       elfBin.codeSize = candidateElf.size();
       elfBin.pCode = candidateElf.data();
+      builtQuickTier = tieredCompile;
     }
 
+    // NOTE: A quick first tier is not stored in the cache; the fully optimized rebuild is.
     if (!buildingRelocatableElf && !m_cache)
-      updateShaderCache((result == Result::Success), &elfBin, shaderCache, hEntry);
+      updateShaderCache((result == Result::Success) && !builtQuickTier, &elfBin, shaderCache, hEntry);
   }
 
   if (result == Result::Success) {
@@ -1576,10 +1795,31 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
   }
 
   if (m_cache) {
-    bool withValue = (result == Result::Success) && (cacheResult != Result::Success);
+    bool withValue = (result == Result::Success) && (cacheResult != Result::Success) && !builtQuickTier;
     ReleaseCacheEntry(withValue, &elfBin, &cacheEntry);
   }
 
+  if (result == Result::Success && builtQuickTier) {
+    // Schedule the fully optimized rebuild. It takes the normal path with tiering off, so it is stored in the cache
+    // under the normal key. Nothing is waiting for it, so it runs at low priority.
+    pipelineOut->tieredRebuildPending = true;
+    scheduleTieredRebuild([this, pipelineInfo] {
+      std::vector<uint8_t> rebuildElf;
+      GraphicsPipelineBuildInfo rebuildInfo = *pipelineInfo;
+      rebuildInfo.pInstance = nullptr;
+      rebuildInfo.pUserData = &rebuildElf;
+      rebuildInfo.pfnOutputAlloc = allocateTieredRebuildOutput;
+      rebuildInfo.tieredCompile = {};
+      // The deadline and cancellation token were for the quick tier, which has already finished.
+      rebuildInfo.cancellation = {};
+      rebuildInfo.priority = CompilePriority::Low;
+      GraphicsPipelineBuildOut rebuildOut = {};
+      Result rebuildResult = BuildGraphicsPipeline(&rebuildInfo, &rebuildOut);
+      pipelineInfo->tieredCompile.pfnOptimizedPipeline(pipelineInfo->tieredCompile.pUserData, rebuildResult,
+                                                       &rebuildOut.pipelineBin);
+    });
+  }
+
   return result;
 }
 
@@ -1594,8 +1834,9 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
 Result Compiler::buildComputePipelineInternal(ComputeContext *computeContext,
                                               const ComputePipelineBuildInfo *pipelineInfo, bool buildingRelocatableElf,
                                               ElfPackage *pipelineElf, CacheAccessInfo *stageCacheAccess) {
-  Context *context = acquireContext();
+  Context *context = acquireContext(pipelineInfo->priority);
   context->attachPipelineContext(computeContext);
+  context->setCancellation(pipelineInfo->cancellation);
 
   std::vector<const PipelineShaderInfo *> shadersInfo = {
       nullptr, nullptr, nullptr, nullptr, nullptr, &pipelineInfo->cs,
@@ -1621,16 +1862,24 @@ Result Compiler::buildComputePipelineInternal(ComputeContext *computeContext,
 Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineInfo,
                                       ComputePipelineBuildOut *pipelineOut, void *pipelineDumpFile) {
   BinaryData elfBin = {};
+  pipelineOut->tieredRebuildPending = false;
 
   bool buildingRelocatableElf = pipelineInfo->options.enableRelocatableShaderElf || cl::UseRelocatableShaderElf;
   buildingRelocatableElf = buildingRelocatableElf && canUseRelocatableComputeShaderElf(pipelineInfo);
 
+  // A tiered compile first builds the pipeline quickly, and rebuilds it fully optimized in the background.
+  const bool tieredCompile = pipelineInfo->tieredCompile.pfnOptimizedPipeline && !buildingRelocatableElf;
+  bool builtQuickTier = false;
+
   Result result = validatePipelineShaderInfo(&pipelineInfo->cs);
 
   MetroHash::Hash cacheHash = {};
   MetroHash::Hash pipelineHash = {};
-  cacheHash = PipelineDumper::generateHashForComputePipeline(pipelineInfo, true, buildingRelocatableElf);
-  pipelineHash = PipelineDumper::generateHashForComputePipeline(pipelineInfo, false, buildingRelocatableElf);
+  // The pipeline hash and the whole-pipeline cache key cover the linked pipeline, so they are never the relocatable
+  // variants, which leave out state resolved when linking. The relocatable variant is only the per-stage cache key in
+  // buildPipelineWithRelocatableElf.
+  cacheHash = PipelineDumper::generateHashForComputePipeline(pipelineInfo, true, false);
+  pipelineHash = PipelineDumper::generateHashForComputePipeline(pipelineInfo, false, false);
 
   if (result == Result::Success && EnableOuts()) {
     const ShaderModuleData *moduleData = reinterpret_cast<const ShaderModuleData *>(pipelineInfo->cs.pModuleData);
@@ -1669,11 +1918,14 @@ Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineIn
 
   if (!buildingRelocatableElf) {
     if (m_cache) {
-      cacheResult = lookUpCaches(userCache, &hashId, &elfBin, &cacheEntry);
+      // A quick first tier is never stored in the cache, so it does not allocate an entry that others would wait
+      // for only to find it failed. The fully optimized rebuild allocates and populates it.
+      cacheResult = lookUpCaches(userCache, &hashId, &elfBin, &cacheEntry, !tieredCompile);
       if (cacheResult == Result::Success)
         pipelineOut->pipelineCacheAccess = CacheAccessInfo::CacheHit;
     } else {
-      cacheEntryState = lookUpShaderCaches(appCache, &cacheHash, &elfBin, &shaderCache, &hEntry);
+      cacheEntryState = lookUpShaderCaches(appCache, &cacheHash, &elfBin, &shaderCache, &hEntry,
+                                           pipelineInfo->priority, !tieredCompile);
       if (cacheEntryState == ShaderEntryState::Ready) {
         if (appCache == nullptr)
           pipelineOut->pipelineCacheAccess = CacheAccessInfo::InternalCacheHit;
@@ -1691,6 +1943,7 @@ Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineIn
   if ((cacheEntryState == ShaderEntryState::Compiling) || (m_cache && (cacheResult != Result::Success))) {
 
     ComputeContext computeContext(m_gfxIp, pipelineInfo, &pipelineHash, &cacheHash);
+    computeContext.setQuickTier(tieredCompile);
 
     result = buildComputePipelineInternal(&computeContext, pipelineInfo, buildingRelocatableElf, &candidateElf,
                                           &pipelineOut->stageCacheAccess);
@@ -1698,9 +1951,11 @@ Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineIn
     if (result == Result::Success) {
       elfBin.codeSize = candidateElf.size();
       elfBin.pCode = candidateElf.data();
+      builtQuickTier = tieredCompile;
     }
+    // NOTE: A quick first tier is not stored in the cache; the fully optimized rebuild is.
     if (!buildingRelocatableElf && !m_cache)
-      updateShaderCache((result == Result::Success), &elfBin, shaderCache, hEntry);
+      updateShaderCache((result == Result::Success) && !builtQuickTier, &elfBin, shaderCache, hEntry);
   }
 
   if (result == Result::Success) {
@@ -1722,10 +1977,31 @@ Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineIn
   }
 
   if (m_cache) {
-    bool withValue = (result == Result::Success) && (cacheResult != Result::Success);
+    bool withValue = (result == Result::Success) && (cacheResult != Result::Success) && !builtQuickTier;
     ReleaseCacheEntry(withValue, &elfBin, &cacheEntry);
   }
 
+  if (result == Result::Success && builtQuickTier) {
+    // Schedule the fully optimized rebuild. It takes the normal path with tiering off, so it is stored in the cache
+    // under the normal key. Nothing is waiting for it, so it runs at low priority.
+    pipelineOut->tieredRebuildPending = true;
+    scheduleTieredRebuild([this, pipelineInfo] {
+      std::vector<uint8_t> rebuildElf;
+      ComputePipelineBuildInfo rebuildInfo = *pipelineInfo;
+      rebuildInfo.pInstance = nullptr;
+      rebuildInfo.pUserData = &rebuildElf;
+      rebuildInfo.pfnOutputAlloc = allocateTieredRebuildOutput;
+      rebuildInfo.tieredCompile = {};
+      // The deadline and cancellation token were for the quick tier, which has already finished.
+      rebuildInfo.cancellation = {};
+      rebuildInfo.priority = CompilePriority::Low;
+      ComputePipelineBuildOut rebuildOut = {};
+      Result rebuildResult = BuildComputePipeline(&rebuildInfo, &rebuildOut);
+      pipelineInfo->tieredCompile.pfnOptimizedPipeline(pipelineInfo->tieredCompile.pUserData, rebuildResult,
+                                                       &rebuildOut.pipelineBin);
+    });
+  }
+
   return result;
 }
 
@@ -1746,6 +2022,9 @@ MetroHash::Hash Compiler::generateHashForCompileOptions(unsigned optionCount, co
                                        cl::LogFileOuts.ArgStr,
                                        cl::ExecutableName.ArgStr,
                                        "unlinked",
+                                       "use-in-tree-cache",
+                                       "in-tree-cache-budget",
+                                       "in-tree-cache-file",
                                        "o"};
 
   std::set<StringRef> effectingOptions;
@@ -1856,11 +2135,86 @@ Result Compiler::CreateShaderCache(const ShaderCacheCreateInfo *pCreateInfo, ISh
 #endif
 
 // =====================================================================================================================
-// Acquires a free context from context pool.
-Context *Compiler::acquireContext() const {
+// Schedule the fully optimized background rebuild of a tiered compile. The rebuilds are run in order on a single
+// background thread, which is started on first use, so they do not compete with the foreground compiles for more
+// than one core.
+//
+// @param rebuild : Function that rebuilds the pipeline and delivers the result through the tiered compile callback
+void Compiler::scheduleTieredRebuild(std::function<void()> rebuild) {
+  std::lock_guard<std::mutex> lock(m_tieredRebuildMutex);
+  m_tieredRebuilds.push_back(std::move(rebuild));
+  if (!m_tieredRebuildThread.joinable())
+    m_tieredRebuildThread = std::thread([this] { runTieredRebuilds(); });
+  m_tieredRebuildCondition.notify_one();
+}
+
+// =====================================================================================================================
+// Run the tiered rebuilds as they are scheduled, until the compiler is destroyed and the queue is empty.
+void Compiler::runTieredRebuilds() {
+  for (;;) {
+    std::function<void()> rebuild;
+    {
+      std::unique_lock<std::mutex> lock(m_tieredRebuildMutex);
+      m_tieredRebuildCondition.wait(lock, [this] { return m_tieredRebuildStop || !m_tieredRebuilds.empty(); });
+      if (m_tieredRebuilds.empty())
+        return;
+      rebuild = std::move(m_tieredRebuilds.front());
+      m_tieredRebuilds.pop_front();
+    }
+    rebuild();
+  }
+}
+
+// =====================================================================================================================
+// Check whether a compile of the given priority can be given a context without exceeding the limits on the number of
+// compiles holding contexts. m_contextPoolMutex must be held.
+//
+// @param priority : Priority of the compile
+bool Compiler::canAdmitContext(CompilePriority priority) {
+  if (cl::MaxConcurrentCompiles != 0 && m_activeContextCount >= cl::MaxConcurrentCompiles)
+    return false;
+  if (priority != CompilePriority::Low)
+    return true;
+  unsigned maxLowPriorityCompiles = cl::MaxLowPriorityCompiles;
+  if (maxLowPriorityCompiles == 0)
+    maxLowPriorityCompiles = std::max(1U, std::thread::hardware_concurrency() / 2);
+  return m_activeLowPriorityContextCount < maxLowPriorityCompiles;
+}
+
+// =====================================================================================================================
+// Check whether the given waiter for a context is the next one to be given a context: it can be admitted, and no
+// admissible waiter comes before it, by priority and then by arrival. m_contextPoolMutex must be held.
+//
+// @param priority : Priority of the waiter
+// @param ticket : Ticket of the waiter
+bool Compiler::isNextContextWaiter(CompilePriority priority, uint64_t ticket) {
+  if (!canAdmitContext(priority))
+    return false;
+  for (const auto &waiter : m_contextWaiters) {
+    bool comesBefore = waiter.first > priority || (waiter.first == priority && waiter.second < ticket);
+    if (comesBefore && canAdmitContext(waiter.first))
+      return false;
+  }
+  return true;
+}
+
+// =====================================================================================================================
+// Acquires a free context from context pool. The caller waits until it is admitted: compiles of higher priority are
+// admitted first, and the number of compiles (and low priority compiles) holding contexts at once may be limited.
+//
+// @param priority : Priority of the compile
+Context *Compiler::acquireContext(CompilePriority priority) const {
   Context *freeContext = nullptr;
 
-  std::lock_guard<sys::Mutex> lock(m_contextPoolMutex);
+  std::unique_lock<sys::Mutex> lock(m_contextPoolMutex);
+
+  uint64_t ticket = m_nextContextTicket++;
+  m_contextWaiters.push_back({priority, ticket});
+  m_contextPoolCondition.wait(lock, [priority, ticket] { return isNextContextWaiter(priority, ticket); });
+  m_contextWaiters.erase(std::find(m_contextWaiters.begin(), m_contextWaiters.end(), std::make_pair(priority, ticket)));
+  ++m_activeContextCount;
+  if (priority == CompilePriority::Low)
+    ++m_activeLowPriorityContextCount;
 
   // Try to find a free context from pool first
   for (auto &context : *m_contextPool) {
@@ -1887,6 +2241,10 @@ Context *Compiler::acquireContext() const {
 
   assert(freeContext);
   freeContext->setInUse(true);
+  freeContext->setCompilePriority(priority);
+
+  // Another waiter may be admissible too, if it was only waiting behind this one.
+  m_contextPoolCondition.notify_all();
 
   return freeContext;
 }
@@ -1921,6 +2279,10 @@ void Compiler::releaseContext(Context *context) const {
   std::lock_guard<sys::Mutex> lock(m_contextPoolMutex);
   context->reset();
   context->setInUse(false);
+  --m_activeContextCount;
+  if (context->getCompilePriority() == CompilePriority::Low)
+    --m_activeLowPriorityContextCount;
+  m_contextPoolCondition.notify_all();
 }
 
 // =====================================================================================================================
@@ -1936,9 +2298,11 @@ void Compiler::releaseContext(Context *context) const {
 // @param [out] elfBin : Pointer to shader data
 // @param [out] ppShaderCache : Shader cache to use
 // @param [out] phEntry : Handle to use
+// @param priority : Priority of the compile, which orders it among the compiles waiting for the same entry
 ShaderEntryState Compiler::lookUpShaderCaches(IShaderCache *appPipelineCache, MetroHash::Hash *cacheHash,
                                               BinaryData *elfBin, ShaderCache **ppShaderCache,
-                                              CacheEntryHandle *phEntry) {
+                                              CacheEntryHandle *phEntry, CompilePriority priority,
+                                              bool allocateOnMiss) {
   ShaderCache *shaderCache[2];
   unsigned shaderCacheCount = 0;
 
@@ -1952,9 +2316,9 @@ ShaderEntryState Compiler::lookUpShaderCaches(IShaderCache *appPipelineCache, Me
 
   for (unsigned i = 0; i < shaderCacheCount; i++) {
     // Lookup the shader. Allocate on miss when we've reached the last cache.
-    bool allocateOnMiss = (i + 1) == shaderCacheCount;
+    bool allocateEntry = allocateOnMiss && (i + 1) == shaderCacheCount;
     CacheEntryHandle currentEntry;
-    ShaderEntryState cacheEntryState = shaderCache[i]->findShader(*cacheHash, allocateOnMiss, &currentEntry);
+    ShaderEntryState cacheEntryState = shaderCache[i]->findShader(*cacheHash, allocateEntry, &currentEntry, priority);
     if (cacheEntryState == ShaderEntryState::Ready) {
       Result result = shaderCache[i]->retrieveShader(currentEntry, &elfBin->pCode, &elfBin->codeSize);
       if (result == Result::Success)
@@ -2008,8 +2372,9 @@ void Compiler::updateShaderCache(bool insert, const BinaryData *elfBin, ShaderCa
 // @param cacheHash : Hash code of the shader
 // @param [out] elfBin : Pointer to shader data
 // @param [out] entryHandle : Handle to use
+// @param allocateOnMiss : Whether to allocate an entry on a miss, to be populated by this compile
 Result Compiler::lookUpCaches(ICache *appPipelineCache, HashId *cacheHash, BinaryData *elfBin,
-                              EntryHandle *entryHandle) {
+                              EntryHandle *entryHandle, bool allocateOnMiss) {
   Result cacheResult = Result::Unsupported;
 
   auto LookUpCache = [](ICache *cache, bool allocateOnMiss, HashId *cacheHash, BinaryData *elfBin,
@@ -2033,10 +2398,10 @@ Result Compiler::lookUpCaches(ICache *appPipelineCache, HashId *cacheHash, Binar
   };
 
   if (m_cache)
-    cacheResult = LookUpCache(m_cache, !appPipelineCache, cacheHash, elfBin, entryHandle);
+    cacheResult = LookUpCache(m_cache, allocateOnMiss && !appPipelineCache, cacheHash, elfBin, entryHandle);
 
   if (appPipelineCache && cacheResult != Result::Success)
-    cacheResult = LookUpCache(appPipelineCache, true, cacheHash, elfBin, entryHandle);
+    cacheResult = LookUpCache(appPipelineCache, allocateOnMiss, cacheHash, elfBin, entryHandle);
 
   return cacheResult;
 }
@@ -2135,14 +2500,13 @@ void Compiler::buildShaderCacheHash(Context *context, unsigned stageMask, ArrayR
 // =====================================================================================================================
 // Link relocatable shader elf file into a pipeline elf file and apply relocations.
 //
-// @param shaderElfs : An array of pipeline elf packages, indexed by stage, containing relocatable elf.
+// @param shaderElfs : An array of pipeline elf packages, indexed by stage, containing relocatable elf. A pipeline with
+//                     tessellation or geometry shaders has its vertex-processing half-pipeline ELF in the vertex
+//                     shader slot.
 //                     TODO: This has an implicit length of ShaderStageNativeStageCount. Use ArrayRef instead.
 // @param [out] pipelineElf : Elf package containing the pipeline elf
 // @param context : Acquired context
 void Compiler::linkRelocatableShaderElf(ElfPackage *shaderElfs, ElfPackage *pipelineElf, Context *context) {
-  assert(shaderElfs[ShaderStageTessControl].empty() && "Cannot link tessellation shaders yet.");
-  assert(shaderElfs[ShaderStageTessEval].empty() && "Cannot link tessellation shaders yet.");
-  assert(shaderElfs[ShaderStageGeometry].empty() && "Cannot link geometry shaders yet.");
   assert(!context->getPipelineContext()->isUnlinked() && "Not supposed to link this pipeline.");
 
   // Set up middle-end objects, including setting up pipeline state.
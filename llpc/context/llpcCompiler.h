@@ -36,6 +36,11 @@
 #include "vkgcElfReader.h"
 #include "vkgcMetroHash.h"
 #include "lgc/CommonDefs.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 namespace llvm {
 
@@ -134,7 +139,7 @@ public:
                                          llvm::MutableArrayRef<CacheAccessInfo> stageCacheAccesses);
 
   Result buildPipelineInternal(Context *context, llvm::ArrayRef<const PipelineShaderInfo *> shaderInfo, bool unlinked,
-                               ElfPackage *pipelineElf);
+                               ElfPackage *pipelineElf, const ElfPackage *otherElf = nullptr);
 
   // Gets the count of compiler instance.
   static unsigned getInstanceCount() { return m_instanceCount; }
@@ -149,12 +154,13 @@ public:
 #endif
 
   ShaderEntryState lookUpShaderCaches(IShaderCache *appPipelineCache, MetroHash::Hash *cacheHash, BinaryData *elfBin,
-                                      ShaderCache **ppShaderCache, CacheEntryHandle *phEntry);
+                                      ShaderCache **ppShaderCache, CacheEntryHandle *phEntry,
+                                      CompilePriority priority = CompilePriority::Normal, bool allocateOnMiss = true);
 
   void updateShaderCache(bool insert, const BinaryData *elfBin, ShaderCache *shaderCache, CacheEntryHandle phEntry);
 
   Vkgc::Result lookUpCaches(Vkgc::ICache *appPipelineCache, Vkgc::HashId *cacheHash, BinaryData *elfBin,
-                            Vkgc::EntryHandle *entryHandle);
+                            Vkgc::EntryHandle *entryHandle, bool allocateOnMiss = true);
 
   void ReleaseCacheEntry(bool withValue, const BinaryData *elfBin, Vkgc::EntryHandle *entryHandle);
 
@@ -171,9 +177,14 @@ private:
 
   Result validatePipelineShaderInfo(const PipelineShaderInfo *shaderInfo) const;
 
-  Context *acquireContext() const;
+  Context *acquireContext(CompilePriority priority = CompilePriority::Normal) const;
+  static bool canAdmitContext(CompilePriority priority);
+  static bool isNextContextWaiter(CompilePriority priority, uint64_t ticket);
   void releaseContext(Context *context) const;
 
+  void scheduleTieredRebuild(std::function<void()> rebuild);
+  void runTieredRebuilds();
+
   bool runPasses(lgc::PassManager *passMgr, llvm::Module *module) const;
   void linkRelocatableShaderElf(ElfPackage *shaderElfs, ElfPackage *pipelineElf, Context *context);
   bool canUseRelocatableGraphicsShaderElf(const llvm::ArrayRef<const PipelineShaderInfo *> &shaderInfo,
@@ -190,6 +201,21 @@ private:
   static llvm::sys::Mutex m_contextPoolMutex;   // Mutex for context pool access
   static std::vector<Context *> *m_contextPool; // Context pool
   unsigned m_relocatablePipelineCompilations;   // The number of pipelines compiled using relocatable shader elf
+
+  // Admission of compiles to the context pool, in priority order. These are accessed with m_contextPoolMutex held.
+  static std::condition_variable_any m_contextPoolCondition; // Signalled when a context is released
+  static uint64_t m_nextContextTicket;                       // Ticket of the next waiter, so equal priorities are FIFO
+  static unsigned m_activeContextCount;                      // Number of contexts held by compiles
+  static unsigned m_activeLowPriorityContextCount;           // Number of contexts held by low priority compiles
+  // Priority and ticket of each compile waiting for a context
+  static std::vector<std::pair<CompilePriority, uint64_t>> m_contextWaiters;
+
+  // Background rebuilds of tiered pipeline compiles
+  std::mutex m_tieredRebuildMutex;                    // Mutex for the tiered rebuild queue
+  std::condition_variable m_tieredRebuildCondition;   // Condition variable signalled when the queue changes
+  std::deque<std::function<void()>> m_tieredRebuilds; // Queue of pending tiered rebuilds
+  std::thread m_tieredRebuildThread;                  // Thread running the tiered rebuilds, started on first use
+  bool m_tieredRebuildStop = false;                   // Whether the tiered rebuild thread should exit when idle
 };
 
 // Convert front-end LLPC shader stage to middle-end LGC shader stage
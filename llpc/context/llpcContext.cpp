@@ -42,20 +42,29 @@
 #include "llvm/Bitstream/BitstreamReader.h"
 #include "llvm/Bitstream/BitstreamWriter.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include <chrono>
 
 #define DEBUG_TYPE "llpc-context"
 
 using namespace lgc;
 using namespace llvm;
 
+// -library-cache-size: number of parsed library modules to keep in each context for reuse by later pipelines
+static cl::opt<unsigned> LibraryCacheSize("library-cache-size",
+                                          cl::desc("Number of parsed LLVM library modules kept for reuse in each "
+                                                   "context (0 to disable)"),
+                                          cl::init(8));
+
 namespace Llpc {
 
 // =====================================================================================================================
@@ -74,6 +83,27 @@ void Context::reset() {
   m_pipelineContext = nullptr;
   delete m_builder;
   m_builder = nullptr;
+  // Clear the cancellation of the last build, so a cancelled context can be reused.
+  if (m_builderContext)
+    m_builderContext->setCancelCheck(nullptr);
+}
+
+// =====================================================================================================================
+// Set the deadline and cancellation token of the pipeline build. The time limit counts from this call.
+//
+// @param cancellation : Cancellation info from the pipeline build info
+void Context::setCancellation(const CancellationInfo &cancellation) {
+  if (cancellation.timeLimitMs == 0 && !cancellation.pfnIsCancelled) {
+    getLgcContext()->setCancelCheck(nullptr);
+    return;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(cancellation.timeLimitMs);
+  getLgcContext()->setCancelCheck([cancellation, deadline] {
+    if (cancellation.timeLimitMs != 0 && std::chrono::steady_clock::now() >= deadline)
+      return true;
+    return cancellation.pfnIsCancelled && cancellation.pfnIsCancelled(cancellation.pUserData);
+  });
 }
 
 // =====================================================================================================================
@@ -91,10 +121,42 @@ LgcContext *Context::getLgcContext() {
 }
 
 // =====================================================================================================================
-// Loads library from external LLVM library.
+// Loads library from external LLVM library. Parsed libraries are kept in a small per-context cache of their bitcode,
+// so pipelines that share a shader module get a clone of the already-parsed module instead of deserializing the
+// bitcode again.
 //
 // @param lib : Bitcodes of external LLVM library
 std::unique_ptr<Module> Context::loadLibary(const BinaryData *lib) {
+  StringRef bitcode(static_cast<const char *>(lib->pCode), lib->codeSize);
+  MetroHash::Hash hash = {};
+  MetroHash64::Hash(reinterpret_cast<const uint8_t *>(bitcode.data()), bitcode.size(), hash.bytes);
+
+  for (auto it = m_libraryCache.begin(); it != m_libraryCache.end(); ++it) {
+    // The hash only rules entries out; a hit needs the same bitcode.
+    if (memcmp(&it->hash, &hash, sizeof(hash)) != 0 || it->bitcode != bitcode)
+      continue;
+    // Cache hit: move the entry to the most-recently-used end and return a copy of it.
+    m_libraryCache.splice(m_libraryCache.end(), m_libraryCache, it);
+    return CloneModule(*m_libraryCache.back().module);
+  }
+
+  std::unique_ptr<Module> libModule = parseLibrary(lib);
+  if (!libModule || LibraryCacheSize == 0)
+    return libModule;
+
+  if (m_libraryCache.size() >= LibraryCacheSize)
+    m_libraryCache.pop_front();
+  m_libraryCache.push_back({hash, bitcode.str(), CloneModule(*libModule)});
+  return libModule;
+}
+
+// =====================================================================================================================
+// Parses library from external LLVM library bitcode. The bitcode is loaded lazily, and only the functions reachable
+// from the module's entry points (the functions that are not internal) are materialized. The remaining functions
+// are deleted without their bodies ever being deserialized.
+//
+// @param lib : Bitcodes of external LLVM library
+std::unique_ptr<Module> Context::parseLibrary(const BinaryData *lib) {
   auto memBuffer =
       MemoryBuffer::getMemBuffer(StringRef(static_cast<const char *>(lib->pCode), lib->codeSize), "", false);
 
@@ -106,7 +168,7 @@ std::unique_ptr<Module> Context::loadLibary(const BinaryData *lib) {
     LLPC_ERRS("Fails to load LLVM bitcode \n");
   } else {
     libModule = std::move(*moduleOrErr);
-    if (Error errCode = libModule->materializeAll()) {
+    if (Error errCode = materializeReachable(*libModule)) {
       LLPC_ERRS("Fails to materialize \n");
       libModule = nullptr;
     }
@@ -115,6 +177,53 @@ std::unique_ptr<Module> Context::loadLibary(const BinaryData *lib) {
   return libModule;
 }
 
+// =====================================================================================================================
+// Materializes the functions of a lazily loaded module that are reachable from its non-internal functions and from
+// global variable initializers, deletes unreachable functions, then finishes materializing the module.
+//
+// @param [in/out] module : Lazily loaded module
+Error Context::materializeReachable(Module &module) {
+  SmallVector<Function *, 8> worklist;
+  SmallPtrSet<Function *, 16> reached;
+
+  // Walks a value (looking through constant expressions and aggregates) and adds any function it refers to.
+  std::function<void(Value *)> addReferenced = [&](Value *value) {
+    if (auto func = dyn_cast<Function>(value)) {
+      if (reached.insert(func).second)
+        worklist.push_back(func);
+    } else if (isa<ConstantExpr>(value) || isa<ConstantAggregate>(value)) {
+      for (Value *operand : cast<Constant>(value)->operands())
+        addReferenced(operand);
+    }
+  };
+
+  for (Function &func : module) {
+    if (!func.hasLocalLinkage())
+      addReferenced(&func);
+  }
+  for (GlobalVariable &global : module.globals()) {
+    if (global.hasInitializer())
+      addReferenced(global.getInitializer());
+  }
+
+  while (!worklist.empty()) {
+    Function *func = worklist.pop_back_val();
+    if (Error errCode = func->materialize())
+      return errCode;
+    for (Instruction &inst : instructions(func)) {
+      for (Value *operand : inst.operands())
+        addReferenced(operand);
+    }
+  }
+
+  for (Function &func : make_early_inc_range(module)) {
+    if (!reached.count(&func) && func.use_empty())
+      func.eraseFromParent();
+  }
+
+  return module.materializeAll();
+}
+
 // =====================================================================================================================
 // Sets triple and data layout in specified module from the context's target machine.
 //
@@ -32,11 +32,14 @@
 
 #include "llpcPipelineContext.h"
 #include "spirvExt.h"
+#include "vkgcMetroHash.h"
 #include "lgc/LgcContext.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Type.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Target/TargetMachine.h"
+#include <list>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -65,6 +68,12 @@ public:
   // Get the number of times this context is used.
   unsigned getUseCount() const { return m_useCount; }
 
+  // Set the priority of the compile that holds this context.
+  void setCompilePriority(CompilePriority priority) { m_compilePriority = priority; }
+
+  // Get the priority of the compile that holds this context.
+  CompilePriority getCompilePriority() const { return m_compilePriority; }
+
   // Attaches pipeline context to LLPC context.
   void attachPipelineContext(PipelineContext *pipelineContext) { m_pipelineContext = pipelineContext; }
 
@@ -80,6 +89,12 @@ public:
   // Get (create if necessary) LgcContext
   lgc::LgcContext *getLgcContext();
 
+  // Set the deadline and cancellation token of the pipeline build
+  void setCancellation(const CancellationInfo &cancellation);
+
+  // Check whether the pipeline build has been cancelled, or has run past its time limit
+  bool isBuildCancelled() { return m_builderContext && m_builderContext->isCancelled(); }
+
   // Set value of scalarBlockLayout option. This gets called with the value from PipelineOptions when
   // starting a pipeline compile.
   void setScalarBlockLayout(bool scalarBlockLayout) { m_scalarBlockLayout = scalarBlockLayout; }
@@ -137,6 +152,9 @@ private:
   Context(const Context &) = delete;
   Context &operator=(const Context &) = delete;
 
+  std::unique_ptr<llvm::Module> parseLibrary(const BinaryData *lib);
+  static llvm::Error materializeReachable(llvm::Module &module);
+
   GfxIpVersion m_gfxIp;                              // Graphics IP version info
   PipelineContext *m_pipelineContext;                // Pipeline-specific context
   bool m_isInUse = false;                            // Whether this context is in use
@@ -147,7 +165,18 @@ private:
   bool m_scalarBlockLayout = false;                     // scalarBlockLayout option from last pipeline compile
   bool m_robustBufferAccess = false;                    // robustBufferAccess option from last pipeline compile
 
-  unsigned m_useCount = 0; // Number of times this context is used.
+  unsigned m_useCount = 0;                                  // Number of times this context is used.
+  CompilePriority m_compilePriority = CompilePriority::Normal; // Priority of the compile that holds this context
+
+  // Parsed library module, with the bitcode it was parsed from
+  struct LibraryCacheEntry {
+    MetroHash::Hash hash;                 // Hash of the bitcode, to skip most entries without comparing it
+    std::string bitcode;                  // Bitcode of the library
+    std::unique_ptr<llvm::Module> module; // Parsed library module
+  };
+
+  // Parsed library modules, least recently used first
+  std::list<LibraryCacheEntry> m_libraryCache;
 };
 
 } // namespace Llpc
@@ -234,6 +234,13 @@ void PipelineContext::setPipelineState(Pipeline *pipeline, bool unlinked) const
     pipeline->setDeviceIndex(static_cast<const ComputePipelineBuildInfo *>(getPipelineBuildInfo())->deviceIndex);
 }
 
+// =====================================================================================================================
+// Check whether the color export state is compiled into an unlinked fragment shader (because color export shaders are
+// disabled), instead of into the color export shader linked with it.
+bool PipelineContext::isColorExportInUnlinkedShader() {
+  return DisableColorExportShader;
+}
+
 // =====================================================================================================================
 // Give the pipeline options to the middle-end.
 //
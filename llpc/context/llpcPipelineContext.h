@@ -131,6 +131,10 @@ public:
   // Set pipeline state in lgc::Pipeline object for middle-end
   void setPipelineState(lgc::Pipeline *pipeline, bool unlinked) const;
 
+  // Check whether the color export state is compiled into an unlinked fragment shader, instead of into the color export
+  // shader linked with it
+  static bool isColorExportInUnlinkedShader();
+
   // Get ShaderFpMode struct for the given shader stage
   ShaderFpMode &getShaderFpMode(ShaderStage stage) { return m_shaderFpModes[stage]; }
 
@@ -144,6 +148,12 @@ public:
   // Get whether we are building a relocatable (unlinked) ElF
   bool isUnlinked() const { return m_unlinked; }
 
+  // Set whether we are building the quick, minimally optimized, first tier of a tiered pipeline compile
+  void setQuickTier(bool quickTier) { m_quickTier = quickTier; }
+
+  // Get whether we are building the quick first tier of a tiered pipeline compile
+  bool isQuickTier() const { return m_quickTier; }
+
   // Gets pipeline resource mapping data
   const ResourceMappingData *getResourceMapping() const { return &m_resourceMapping; }
 
@@ -194,7 +204,8 @@ private:
   void setColorExportState(lgc::Pipeline *pipeline) const;
 
   ShaderFpMode m_shaderFpModes[ShaderStageCountInternal] = {};
-  bool m_unlinked = false; // Whether we are building an "unlinked" half-pipeline ELF
+  bool m_unlinked = false;  // Whether we are building an "unlinked" half-pipeline ELF
+  bool m_quickTier = false; // Whether we are building the quick first tier of a tiered pipeline compile
 };
 
 } // namespace Llpc
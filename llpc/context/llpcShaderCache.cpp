@@ -386,7 +386,9 @@ void ShaderCache::resetCacheFile() {
 // @param hash : Hash code of shader
 // @param allocateOnMiss : Whether allocate a new entry for new hash
 // @param [out] phEntry : Handle of shader cache entry
-ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMiss, CacheEntryHandle *phEntry) {
+// @param priority : Priority of the compile looking up the shader
+ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMiss, CacheEntryHandle *phEntry,
+                                         CompilePriority priority) {
   // Early return if shader cache is disabled
   if (m_disableCache) {
     *phEntry = nullptr;
@@ -415,14 +417,7 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
     mapResult = Result::ErrorUnavailable;
 
   if (mapResult == Result::Success) {
-    if (existed) {
-      // We don't need to hold on to the write lock if we're not the one doing the compile
-      if (!readOnlyLock) {
-        unlockCacheMap(readOnlyLock);
-        readOnlyLock = true;
-        lockCacheMap(readOnlyLock);
-      }
-    } else {
+    if (!existed) {
       bool needsInit = true;
 
       // We didn't find the entry in our own hash map, now search the external cache if available
@@ -473,9 +468,25 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
       }
     } // End if (existed == false)
 
-    if (index->state == ShaderEntryState::Compiling) {
-      // The shader is being compiled by another thread, we should release the lock and wait for it to complete
-      while (index->state == ShaderEntryState::Compiling) {
+    // A ready shader only needs the read lock. Otherwise the waiter counts and the state are updated below, which
+    // needs the write lock, as other threads waiting for the same entry update them too.
+    if (index->state == ShaderEntryState::Ready) {
+      if (!readOnlyLock) {
+        unlockCacheMap(readOnlyLock);
+        readOnlyLock = true;
+        lockCacheMap(readOnlyLock);
+      }
+    } else if (readOnlyLock) {
+      unlockCacheMap(readOnlyLock);
+      readOnlyLock = false;
+      lockCacheMap(readOnlyLock);
+    }
+
+    if (mustWaitForShader(index, priority)) {
+      // The shader is being compiled by another thread, we should release the lock and wait for it to complete. If
+      // that compile fails, the waiter with the highest priority takes over compiling it.
+      updateWaiterCount(index, priority, 1);
+      while (mustWaitForShader(index, priority)) {
         unlockCacheMap(readOnlyLock);
         {
           std::unique_lock<std::mutex> lock(m_conditionMutex);
@@ -484,6 +495,7 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
         }
         lockCacheMap(readOnlyLock);
       }
+      updateWaiterCount(index, priority, -1);
       // At this point the shader entry is either Ready, New or something failed. We've already
       // initialized our result code to an error code above, the Ready and New cases are handled below so
       // nothing else to do here.
@@ -508,6 +520,40 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
   return result;
 }
 
+// =====================================================================================================================
+// Check whether a compile looking up a shader must wait for it: either the shader is being compiled by another thread,
+// or its compile failed and a compile of higher priority is waiting to take it over. The cache map must be locked
+// for writing.
+//
+// @param index : Shader cache entry
+// @param priority : Priority of the compile looking up the shader
+bool ShaderCache::mustWaitForShader(const ShaderIndex *index, CompilePriority priority) {
+  if (index->state == ShaderEntryState::Compiling)
+    return true;
+  if (index->state != ShaderEntryState::New)
+    return false;
+  unsigned higherPriorityWaiters = 0;
+  if (priority < CompilePriority::High)
+    higherPriorityWaiters += index->highPriorityWaiters;
+  if (priority < CompilePriority::Normal)
+    higherPriorityWaiters += index->normalPriorityWaiters;
+  return higherPriorityWaiters != 0;
+}
+
+// =====================================================================================================================
+// Add to or subtract from the count of compiles of the given priority waiting for a shader. Low priority waiters are
+// not counted, as no waiter gives way to them. The cache map must be locked for writing.
+//
+// @param [in/out] index : Shader cache entry
+// @param priority : Priority of the waiting compile
+// @param delta : Amount to add to the count
+void ShaderCache::updateWaiterCount(ShaderIndex *index, CompilePriority priority, int delta) {
+  if (priority == CompilePriority::High)
+    index->highPriorityWaiters += delta;
+  else if (priority == CompilePriority::Normal)
+    index->normalPriorityWaiters += delta;
+}
+
 // =====================================================================================================================
 // Inserts a new shader into the cache. The new shader is written to the cache file if it is in-use, and will also
 // upload it to the client's external cache if it is in-use.
@@ -69,9 +69,12 @@ enum ShaderCacheMode {
 // Stores data in the hash map of cached shaders and helps correlated a shader in the hash to a location in the
 // cache's linear allocators where the shader is actually stored.
 struct ShaderIndex {
-  ShaderHeader header;             // Shader header data (key, crc, size)
-  volatile ShaderEntryState state; // Shader entry state
-  void *dataBlob;                  // Serialized data blob representing a cached RelocatableShader object.
+  ShaderHeader header;                // Shader header data (key, crc, size)
+  volatile ShaderEntryState state;    // Shader entry state
+  void *dataBlob;                     // Serialized data blob representing a cached RelocatableShader object.
+  // The counts of waiters are only read and updated with the cache map locked for writing.
+  unsigned highPriorityWaiters = 0;   // Number of high priority compiles waiting for the entry to be compiled
+  unsigned normalPriorityWaiters = 0; // Number of normal priority compiles waiting for the entry to be compiled
 };
 
 // The key in hash map is a 64-bit compacted Shader Hash
@@ -131,7 +134,8 @@ public:
 
   virtual Result Merge(unsigned srcCacheCount, const IShaderCache **ppSrcCaches);
 
-  ShaderEntryState findShader(MetroHash::Hash hash, bool allocateOnMiss, CacheEntryHandle *phEntry);
+  ShaderEntryState findShader(MetroHash::Hash hash, bool allocateOnMiss, CacheEntryHandle *phEntry,
+                              CompilePriority priority = CompilePriority::Normal);
 
   void insertShader(CacheEntryHandle hEntry, const void *blob, size_t size);
 
@@ -166,6 +170,9 @@ private:
 
   bool useExternalCache() { return m_getValueFunc && m_storeValueFunc; }
 
+  static bool mustWaitForShader(const ShaderIndex *index, CompilePriority priority);
+  static void updateWaiterCount(ShaderIndex *index, CompilePriority priority, int delta);
+
   void resetRuntimeCache();
   void getBuildTime(BuildUniqueId *buildId);
 
@@ -37,7 +37,9 @@ namespace Llpc {
 using Vkgc::BasicType;
 using Vkgc::BinaryData;
 using Vkgc::BinaryType;
+using Vkgc::CancellationInfo;
 using Vkgc::ColorTarget;
+using Vkgc::CompilePriority;
 using Vkgc::ComputePipelineBuildInfo;
 using Vkgc::DenormalMode;
 #if LLPC_CLIENT_INTERFACE_MAJOR_VERSION < 41
@@ -121,6 +123,8 @@ struct GraphicsPipelineBuildOut {
   BinaryData pipelineBin; ///< Output pipeline binary data
   CacheAccessInfo pipelineCacheAccess; ///< Pipeline cache access status i.e., hit, miss, or not checked
   CacheAccessInfo stageCacheAccesses[ShaderStageCount]; ///< Shader cache access status i.e., hit, miss, or not checked
+  bool tieredRebuildPending; ///< True if pipelineBin is a quick build, and a fully optimized rebuild will be
+                             ///  delivered through GraphicsPipelineBuildInfo::tieredCompile
 };
 
 /// Represents output of building a compute pipeline.
@@ -128,6 +132,8 @@ struct ComputePipelineBuildOut {
   BinaryData pipelineBin; ///< Output pipeline binary data
   CacheAccessInfo pipelineCacheAccess; ///< Pipeline cache access status i.e., hit, miss, or not checked
   CacheAccessInfo stageCacheAccess;    ///< Shader cache access status i.e., hit, miss, or not checked
+  bool tieredRebuildPending;           ///< True if pipelineBin is a quick build, and a fully optimized rebuild will
+                                       ///  be delivered through ComputePipelineBuildInfo::tieredCompile
 };
 
 /// Defines callback function used to lookup shader cache info in an external cache
@@ -213,7 +219,7 @@ public:
   /// @returns : True if the specified format is supported by fetch shader. Otherwise, FALSE is returned.
   static bool VKAPI_CALL IsVertexFormatSupported(VkFormat format);
 
-  /// Destroys the pipeline compiler.
+  /// Destroys the pipeline compiler. This first waits for the pending tiered pipeline rebuilds to be delivered.
   virtual void VKAPI_CALL Destroy() = 0;
 
   /// Convert ColorBufferFormat to fragment shader export format
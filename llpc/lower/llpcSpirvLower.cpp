@@ -214,6 +214,39 @@ void SpirvLower::addPasses(Context *context, ShaderStage stage, legacy::PassMana
   }
 }
 
+// =====================================================================================================================
+// Add passes to pass manager that bind the specialization constants of a shader module that was lowered with symbolic
+// specialization constants, then fold and remove the code that the constant values make dead.
+//
+// @param context : LLPC context
+// @param specializationInfo : Specialization info of the shader, nullptr if none
+// @param [in/out] passMgr : Pass manager to add passes to
+// @param lowerTimer : Timer to time lower passes with, nullptr if not timing
+void SpirvLower::addSpecConstPasses(Context *context, const VkSpecializationInfo *specializationInfo,
+                                    legacy::PassManager &passMgr, Timer *lowerTimer) {
+  context->getLgcContext()->preparePassManager(&passMgr);
+
+  if (lowerTimer)
+    passMgr.add(LgcContext::createStartStopTimer(lowerTimer, true));
+
+  passMgr.add(createSpirvLowerSpecConst(specializationInfo));
+  passMgr.add(createIPSCCPPass());
+  passMgr.add(createInstructionCombiningPass(3));
+  passMgr.add(createCFGSimplificationPass());
+  passMgr.add(createEarlyCSEPass());
+  passMgr.add(createAggressiveDCEPass());
+
+  if (lowerTimer)
+    passMgr.add(LgcContext::createStartStopTimer(lowerTimer, false));
+
+  if (EnableOuts()) {
+    passMgr.add(createPrintModulePass(
+        outs(), "\n"
+                "===============================================================================\n"
+                "// LLPC SPIR-V specialization results\n"));
+  }
+}
+
 // =====================================================================================================================
 // Initializes the pass according to the specified module.
 //
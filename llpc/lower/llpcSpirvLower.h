@@ -55,6 +55,7 @@ void initializeSpirvLowerMemoryOpPass(PassRegistry &);
 void initializeSpirvLowerGlobalPass(PassRegistry &);
 void initializeSpirvLowerInstMetaRemovePass(PassRegistry &);
 void initializeSpirvLowerResourceCollectPass(PassRegistry &);
+void initializeSpirvLowerSpecConstPass(PassRegistry &);
 void initializeSpirvLowerTerminatorPass(PassRegistry &);
 void initializeSpirvLowerTranslatorPass(PassRegistry &);
 } // namespace llvm
@@ -79,6 +80,7 @@ inline static void initializeLowerPasses(llvm::PassRegistry &passRegistry) {
   initializeSpirvLowerGlobalPass(passRegistry);
   initializeSpirvLowerInstMetaRemovePass(passRegistry);
   initializeSpirvLowerResourceCollectPass(passRegistry);
+  initializeSpirvLowerSpecConstPass(passRegistry);
   initializeSpirvLowerTerminatorPass(passRegistry);
   initializeSpirvLowerTranslatorPass(passRegistry);
 }
@@ -93,8 +95,10 @@ llvm::ModulePass *createSpirvLowerMemoryOp();
 llvm::ModulePass *createSpirvLowerGlobal();
 llvm::ModulePass *createSpirvLowerInstMetaRemove();
 llvm::ModulePass *createSpirvLowerResourceCollect(bool collectDetailUsage);
+llvm::ModulePass *createSpirvLowerSpecConst(const VkSpecializationInfo *specializationInfo);
 llvm::ModulePass *createSpirvLowerTerminator();
-llvm::ModulePass *createSpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo);
+llvm::ModulePass *createSpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo,
+                                             bool symbolicSpecConsts = false);
 
 // =====================================================================================================================
 // Represents the pass of SPIR-V lowering operations, as the base class.
@@ -108,6 +112,10 @@ public:
   static void addPasses(Context *context, ShaderStage stage, llvm::legacy::PassManager &passMgr, llvm::Timer *lowerTimer
   );
 
+  // Add passes that bind the specialization constants of a pre-lowered shader and fold what they enable
+  static void addSpecConstPasses(Context *context, const VkSpecializationInfo *specializationInfo,
+                                 llvm::legacy::PassManager &passMgr, llvm::Timer *lowerTimer);
+
   static void removeConstantExpr(Context *context, llvm::GlobalVariable *global);
   static void replaceConstWithInsts(Context *context, llvm::Constant *const constVal);
 
@@ -168,6 +168,11 @@ bool SpirvLowerResourceCollect::runOnModule(Module &module) {
 
   // Collect resource usages from globals
   for (auto global = m_module->global_begin(), end = m_module->global_end(); global != end; ++global) {
+    // A placeholder of a symbolic specialization constant is not a resource; SpirvLowerSpecConst binds it when the
+    // pipeline is built.
+    if (global->hasMetadata(gSPIRVMD::SpecConst))
+      continue;
+
     auto addrSpace = global->getType()->getAddressSpace();
     switch (addrSpace) {
     case SPIRAS_Constant: {
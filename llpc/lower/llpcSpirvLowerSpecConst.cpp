@@ -0,0 +1,175 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2019-2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcSpirvLowerSpecConst.cpp
+ * @brief LLPC source file: contains implementation of class Llpc::SpirvLowerSpecConst.
+ * @details This pass binds the specialization constants of a shader module that was translated and lowered before its
+ *          specialization was known. Each scalar specialization constant was translated to a ptrtoint of a placeholder
+ *          global "spirv.SpecConst.<SpecId>", which LLVM cannot fold; this pass replaces it with the value given by
+ *          the specialization info, or the default value of the constant.
+ ***********************************************************************************************************************
+ */
+#include "SPIRVInternal.h"
+#include "llpcContext.h"
+#include "llpcDebug.h"
+#include "llpcSpirvLower.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+#include <cstring>
+
+#define DEBUG_TYPE "llpc-spirv-lower-spec-const"
+
+using namespace llvm;
+using namespace SPIRV;
+using namespace Llpc;
+
+namespace Llpc {
+
+// =====================================================================================================================
+// Represents the pass of SPIR-V lowering specialization constants.
+class SpirvLowerSpecConst : public SpirvLower {
+public:
+  SpirvLowerSpecConst(const VkSpecializationInfo *specializationInfo = nullptr);
+
+  virtual bool runOnModule(llvm::Module &module);
+
+  static char ID; // ID of this pass
+
+private:
+  SpirvLowerSpecConst(const SpirvLowerSpecConst &) = delete;
+  SpirvLowerSpecConst &operator=(const SpirvLowerSpecConst &) = delete;
+
+  bool getSpecializedValue(unsigned specId, uint64_t *value) const;
+
+  const VkSpecializationInfo *m_specializationInfo; // Specialization info of the shader, nullptr if none
+};
+
+// =====================================================================================================================
+// Initializes static members.
+char SpirvLowerSpecConst::ID = 0;
+
+// =====================================================================================================================
+// Pass creator, creates the pass of SPIR-V lowering specialization constants
+//
+// @param specializationInfo : Specialization info of the shader, nullptr if none
+ModulePass *createSpirvLowerSpecConst(const VkSpecializationInfo *specializationInfo) {
+  return new SpirvLowerSpecConst(specializationInfo);
+}
+
+// =====================================================================================================================
+//
+// @param specializationInfo : Specialization info of the shader, nullptr if none
+SpirvLowerSpecConst::SpirvLowerSpecConst(const VkSpecializationInfo *specializationInfo)
+    : SpirvLower(ID), m_specializationInfo(specializationInfo) {
+}
+
+// =====================================================================================================================
+// Executes this SPIR-V lowering pass on the specified LLVM module.
+//
+// @param [in/out] module : LLVM module to be run on
+bool SpirvLowerSpecConst::runOnModule(Module &module) {
+  LLVM_DEBUG(dbgs() << "Run the pass Spirv-Lower-Spec-Const\n");
+
+  SpirvLower::init(&module);
+
+  bool changed = false;
+  for (auto globalIt = module.global_begin(), end = module.global_end(); globalIt != end;) {
+    GlobalVariable *global = &*globalIt++;
+    MDNode *specConstMeta = global->getMetadata(gSPIRVMD::SpecConst);
+    if (!specConstMeta)
+      continue;
+
+    // The metadata is { SpecId, default value }; the type of the default value is the integer type the placeholder
+    // was converted to.
+    unsigned specId = mdconst::extract<ConstantInt>(specConstMeta->getOperand(0))->getZExtValue();
+    APInt value = mdconst::extract<ConstantInt>(specConstMeta->getOperand(1))->getValue();
+    uint64_t specializedValue = 0;
+    if (getSpecializedValue(specId, &specializedValue)) {
+      if (value.getBitWidth() == 1)
+        value = APInt(1, specializedValue != 0);
+      else
+        value = APInt(value.getBitWidth(), specializedValue);
+    }
+    LLVM_DEBUG(dbgs() << "SpecId " << specId << " = " << value << "\n");
+
+    // Replace the ptrtoint of the placeholder, whatever integer type it was canonicalized to. Any other use, such as
+    // a compare with null, gets the value as a pointer.
+    global->removeDeadConstantUsers();
+    SmallVector<Constant *, 4> constantUsers;
+    for (User *user : global->users()) {
+      if (auto constExpr = dyn_cast<ConstantExpr>(user)) {
+        if (constExpr->getOpcode() == Instruction::PtrToInt)
+          constantUsers.push_back(constExpr);
+      }
+    }
+    for (Constant *constantUser : constantUsers) {
+      Type *intTy = constantUser->getType();
+      constantUser->replaceAllUsesWith(ConstantInt::get(intTy, value.zextOrTrunc(intTy->getScalarSizeInBits())));
+    }
+
+    global->removeDeadConstantUsers();
+    if (!global->use_empty()) {
+      Type *intPtrTy = module.getDataLayout().getIntPtrType(global->getType());
+      Constant *intValue = ConstantInt::get(intPtrTy, value.zextOrTrunc(intPtrTy->getScalarSizeInBits()));
+      global->replaceAllUsesWith(ConstantExpr::getIntToPtr(intValue, global->getType()));
+    }
+    global->eraseFromParent();
+    changed = true;
+  }
+
+  return changed;
+}
+
+// =====================================================================================================================
+// Gets the value that the specialization info gives a specialization constant. Returns false if it gives none.
+//
+// @param specId : SpecId of the specialization constant
+// @param [out] value : Value of the specialization constant, zero-extended
+bool SpirvLowerSpecConst::getSpecializedValue(unsigned specId, uint64_t *value) const {
+  if (!m_specializationInfo)
+    return false;
+
+  for (unsigned i = 0; i < m_specializationInfo->mapEntryCount; ++i) {
+    const VkSpecializationMapEntry &mapEntry = m_specializationInfo->pMapEntries[i];
+    if (mapEntry.constantID != specId)
+      continue;
+    *value = 0;
+    memcpy(value, static_cast<const uint8_t *>(m_specializationInfo->pData) + mapEntry.offset,
+           std::min(mapEntry.size, sizeof(*value)));
+    return true;
+  }
+  return false;
+}
+
+} // namespace Llpc
+
+// =====================================================================================================================
+// Initializes the pass of SPIR-V lowering specialization constants.
+INITIALIZE_PASS(SpirvLowerSpecConst, DEBUG_TYPE, "Lower SPIR-V specialization constants", false, false)
@@ -33,6 +33,11 @@
 #include "llpcCompiler.h"
 #include "llpcContext.h"
 #include "lgc/Builder.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include <cstring>
+#include <list>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -41,6 +46,92 @@
 using namespace llvm;
 using namespace Llpc;
 
+namespace llvm {
+
+namespace cl {
+
+// -spirv-module-cache-size: number of parsed SPIR-V modules kept for reuse by later compiles
+opt<unsigned> SpirvModuleCacheSize("spirv-module-cache-size",
+                                   desc("Number of parsed SPIR-V modules kept for reuse by later compiles "
+                                        "(0 disables the cache)"),
+                                   init(64));
+
+} // namespace cl
+
+} // namespace llvm
+
+namespace {
+
+// =====================================================================================================================
+// Process-wide cache of parsed SPIR-V modules, keyed by shader module hash. Translation leaves a parsed module
+// unmodified, so every pipeline using a shader module, including concurrent compiles, can share one parsed copy
+// rather than each parsing the SPIR-V again. The least recently used module is evicted when the cache is full;
+// compiles still translating it keep it alive through their reference.
+class SpirvModuleCache {
+public:
+  std::shared_ptr<SPIRV::SPIRVModule> getModule(const ShaderModuleData *moduleData);
+
+private:
+  struct Entry {
+    unsigned hash[4];                                // Shader module hash
+    std::shared_ptr<SPIRV::SPIRVModule> spirvModule; // Parsed SPIR-V module
+  };
+
+  std::mutex m_mutex;         // Protects m_entries
+  std::list<Entry> m_entries; // Cached modules, most recently used first
+};
+
+ManagedStatic<SpirvModuleCache> SpirvModules;
+
+// =====================================================================================================================
+// Returns the parsed SPIR-V module for the given shader module, optimizing and parsing its SPIR-V only if it is not
+// already cached.
+//
+// @param moduleData : Shader module data; its hash is the cache key
+std::shared_ptr<SPIRV::SPIRVModule> SpirvModuleCache::getModule(const ShaderModuleData *moduleData) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+      if (memcmp(it->hash, moduleData->hash, sizeof(it->hash)) == 0) {
+        m_entries.splice(m_entries.begin(), m_entries, it);
+        return it->spirvModule;
+      }
+    }
+  }
+
+  // Parse outside the lock, so that compiles of other shader modules are not held up. Two compiles missing on the
+  // same module at once both parse it, and the second simply replaces the first in the cache.
+  BinaryData optimizedSpirvBin = {};
+  const BinaryData *spirvBin = &moduleData->binCode;
+  if (ShaderModuleHelper::optimizeSpirv(spirvBin, &optimizedSpirvBin) == Result::Success)
+    spirvBin = &optimizedSpirvBin;
+
+  std::string spirvCode(static_cast<const char *>(spirvBin->pCode), spirvBin->codeSize);
+  std::istringstream spirvStream(spirvCode);
+  std::shared_ptr<SPIRV::SPIRVModule> spirvModule = parseSpirv(spirvStream);
+  ShaderModuleHelper::cleanOptimizedSpirv(&optimizedSpirvBin);
+
+  if (cl::SpirvModuleCacheSize == 0)
+    return spirvModule;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (memcmp(it->hash, moduleData->hash, sizeof(it->hash)) == 0) {
+      m_entries.erase(it);
+      break;
+    }
+  }
+  Entry entry = {};
+  memcpy(entry.hash, moduleData->hash, sizeof(entry.hash));
+  entry.spirvModule = spirvModule;
+  m_entries.push_front(std::move(entry));
+  while (m_entries.size() > cl::SpirvModuleCacheSize)
+    m_entries.pop_back();
+  return spirvModule;
+}
+
+} // anonymous namespace
+
 char SpirvLowerTranslator::ID = 0;
 
 // =====================================================================================================================
@@ -48,8 +139,10 @@ char SpirvLowerTranslator::ID = 0;
 //
 // @param stage : Shader stage
 // @param shaderInfo : Shader info for this shader
-ModulePass *Llpc::createSpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo) {
-  return new SpirvLowerTranslator(stage, shaderInfo);
+// @param symbolicSpecConsts : Keep specialization constants symbolic, for SpirvLowerSpecConst to specialize later
+ModulePass *Llpc::createSpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo,
+                                             bool symbolicSpecConsts) {
+  return new SpirvLowerTranslator(stage, shaderInfo, symbolicSpecConsts);
 }
 
 // =====================================================================================================================
@@ -78,15 +171,10 @@ bool SpirvLowerTranslator::runOnModule(Module &module) {
 // @param shaderInfo : Specialization info
 // @param [in/out] module : Module to translate into, initially empty
 void SpirvLowerTranslator::translateSpirvToLlvm(const PipelineShaderInfo *shaderInfo, Module *module) {
-  BinaryData optimizedSpirvBin = {};
   const ShaderModuleData *moduleData = reinterpret_cast<const ShaderModuleData *>(shaderInfo->pModuleData);
   assert(moduleData->binType == BinaryType::Spirv);
-  const BinaryData *spirvBin = &moduleData->binCode;
-  if (ShaderModuleHelper::optimizeSpirv(spirvBin, &optimizedSpirvBin) == Result::Success)
-    spirvBin = &optimizedSpirvBin;
+  std::shared_ptr<SPIRV::SPIRVModule> spirvModule = SpirvModules->getModule(moduleData);
 
-  std::string spirvCode(static_cast<const char *>(spirvBin->pCode), spirvBin->codeSize);
-  std::istringstream spirvStream(spirvCode);
   std::string errMsg;
   SPIRV::SPIRVSpecConstMap specConstMap;
   ShaderStage entryStage = shaderInfo->entryStage;
@@ -116,9 +204,12 @@ void SpirvLowerTranslator::translateSpirvToLlvm(const PipelineShaderInfo *shader
     }
   }
 
-  if (!readSpirv(context->getBuilder(), &(moduleData->usage), &(shaderInfo->options), spirvStream,
-                 convertToExecModel(entryStage), shaderInfo->pEntryTarget, specConstMap, convertingSamplers, module,
-                 errMsg)) {
+  if (!readSpirv(context->getBuilder(), &(moduleData->usage), &(shaderInfo->options), spirvModule.get(),
+                 convertToExecModel(entryStage), shaderInfo->pEntryTarget, specConstMap, m_symbolicSpecConsts,
+                 convertingSamplers, module, errMsg)) {
+    // A cancelled build stops translating part way through, and is abandoned by the caller.
+    if (context->isBuildCancelled())
+      return;
     report_fatal_error(Twine("Failed to translate SPIR-V to LLVM (") +
                            getShaderStageName(static_cast<ShaderStage>(entryStage)) + " shader): " + errMsg,
                        false);
@@ -128,8 +219,6 @@ void SpirvLowerTranslator::translateSpirvToLlvm(const PipelineShaderInfo *shader
   // rather than a pipeline compile.
   m_context->getBuilder()->recordShaderModes(module);
 
-  ShaderModuleHelper::cleanOptimizedSpirv(&optimizedSpirvBin);
-
   // NOTE: Our shader entrypoint is marked in the SPIR-V reader as dllexport. Here we tell LGC that it is the
   // shader entry-point, and mark other functions as internal and always_inline.
   //
@@ -44,8 +44,9 @@ public:
   //
   // @param stage : Shader stage
   // @param shaderInfo : Shader info for this shader
-  SpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo)
-      : SpirvLower(ID), m_shaderInfo(shaderInfo) {}
+  // @param symbolicSpecConsts : Keep specialization constants symbolic, ignoring the specialization info
+  SpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo, bool symbolicSpecConsts)
+      : SpirvLower(ID), m_shaderInfo(shaderInfo), m_symbolicSpecConsts(symbolicSpecConsts) {}
 
   bool runOnModule(llvm::Module &module) override;
 
@@ -58,6 +59,7 @@ private:
   // -----------------------------------------------------------------------------------------------------------------
 
   const PipelineShaderInfo *m_shaderInfo; // Input shader info
+  bool m_symbolicSpecConsts = false;      // Whether to keep specialization constants symbolic
 };
 
 } // namespace Llpc
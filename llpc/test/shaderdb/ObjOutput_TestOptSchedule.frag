@@ -0,0 +1,25 @@
+#version 450
+
+layout(location = 0) in vec4 inColor;
+layout(location = 1) flat in int inCount;
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    vec4 color = vec4(0.0);
+    for (int i = 0; i < inCount; ++i)
+        color += inColor * float(i);
+    outColor = color;
+}
+// BEGIN_SHADERTEST
+/*
+; RUN: amdllpc -spvgen-dir=%spvgendir% -v %gfxip %s | FileCheck --check-prefixes=SHADERTEST,TRIVIAL %s
+; RUN: amdllpc -disable-adaptive-opt -spvgen-dir=%spvgendir% -v %gfxip %s | FileCheck --check-prefixes=SHADERTEST,FULL %s
+; RUN: amdllpc -opt-trivial-inst-count=0 -opt-huge-inst-count=0 -spvgen-dir=%spvgendir% -v %gfxip %s | FileCheck --check-prefixes=SHADERTEST,HUGE %s
+; SHADERTEST-LABEL: {{^// LLPC}} SPIRV-to-LLVM translation results
+; TRIVIAL: PassManager optimization schedule: {{[0-9]+}} instructions, 1 loops, trivial{{$}}
+; FULL: PassManager optimization schedule: {{[0-9]+}} instructions, 1 loops{{$}}
+; HUGE: PassManager optimization schedule: {{[0-9]+}} instructions, 1 loops, huge{{$}}
+; SHADERTEST: AMDLLPC SUCCESS
+*/
+// END_SHADERTEST
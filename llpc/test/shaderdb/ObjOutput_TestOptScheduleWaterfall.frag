@@ -0,0 +1,23 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 5) uniform sampler samp;
+layout(set = 0, binding = 6) uniform texture2D data[];
+layout(location = 0) in flat int inIndex;
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    outColor = texture(nonuniformEXT(sampler2D(data[inIndex], samp)), vec2(0.0));
+}
+// BEGIN_SHADERTEST
+/*
+; The shader has no loops, but the non-uniform sample gets a waterfall loop when the Builder calls are replayed, so
+; the loop passes stay in the optimization schedule.
+; RUN: amdllpc -spvgen-dir=%spvgendir% -v %gfxip %s | FileCheck -check-prefix=SHADERTEST %s
+; SHADERTEST-LABEL: {{^// LLPC}} SPIRV-to-LLVM translation results
+; SHADERTEST: PassManager optimization schedule: {{[0-9]+}} instructions, 1 loops
+; SHADERTEST-NOT: no loop passes
+; SHADERTEST: AMDLLPC SUCCESS
+*/
+// END_SHADERTEST
@@ -0,0 +1,20 @@
+#version 450
+
+layout(location = 0) in vec4 inColor;
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    outColor = inColor * 0.5;
+}
+// BEGIN_SHADERTEST
+/*
+; RUN: amdllpc -tiered-compile -spvgen-dir=%spvgendir% -v %gfxip %s | FileCheck -check-prefix=SHADERTEST %s
+; Check that the quick build uses the minimal optimization set, and that the fully optimized rebuild follows it.
+; SHADERTEST-LABEL: {{^// LLPC}} calculated hash results (graphics pipline)
+; SHADERTEST: PassManager optimization level = 0
+; SHADERTEST-LABEL: {{^// LLPC}} calculated hash results (graphics pipline)
+; SHADERTEST: PassManager optimization level = 2
+; SHADERTEST: AMDLLPC SUCCESS
+*/
+// END_SHADERTEST
@@ -0,0 +1,40 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform Uniforms
+{
+    vec3 u;
+};
+
+layout(set = 0, binding = 1) buffer Data
+{
+    vec3 d[];
+};
+
+layout(location = 0) flat in int index;
+layout(location = 0) out vec4 o;
+
+void main()
+{
+    // Uniform load with a dead component: kept wide for a scalar memory load.
+    // Divergent load with a dead component: split, and the dead component is not loaded.
+    o = vec4(u.x + d[index].x, u.z + d[index].z, 0.0, 1.0);
+}
+// BEGIN_SHADERTEST
+/*
+; RUN: amdllpc -spvgen-dir=%spvgendir% -v %gfxip %s | FileCheck -check-prefix=SHADERTEST %s
+; SHADERTEST-LABEL: {{^// LLPC}} pipeline patching results
+; SHADERTEST: call <3 x i32> @llvm.amdgcn.s.buffer.load.v3i32
+; SHADERTEST-NOT: call <3 x {{i32|float}}> @llvm.amdgcn.raw.buffer.load
+; SHADERTEST-COUNT-2: call {{i32|float}} @llvm.amdgcn.raw.buffer.load.{{i32|f32}}
+; SHADERTEST-NOT: call {{i32|float}} @llvm.amdgcn.raw.buffer.load.{{i32|f32}}
+; SHADERTEST: AMDLLPC SUCCESS
+
+; The new pass manager version of the pass gets the same uniformity from its divergence analysis.
+; RUN: amdllpc -lgc-new-pass-manager -spvgen-dir=%spvgendir% -v %gfxip %s | FileCheck -check-prefix=SHADERTEST %s
+
+; RUN: amdllpc -load-scalarizer-cost-model=false -spvgen-dir=%spvgendir% -v %gfxip %s | FileCheck -check-prefix=NOCOST %s
+; NOCOST-LABEL: {{^// LLPC}} pipeline patching results
+; NOCOST-NOT: call <3 x i32> @llvm.amdgcn.s.buffer.load.v3i32
+; NOCOST: AMDLLPC SUCCESS
+*/
+// END_SHADERTEST
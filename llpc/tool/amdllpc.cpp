@@ -61,8 +61,11 @@
 #endif
 #endif
 
+#include <future>
+#include <memory>
 #include <sstream>
 #include <stdlib.h> // getenv
+#include <thread>
 
 // NOTE: To enable VLD, please add option BUILD_WIN_VLD=1 in build option.To run amdllpc with VLD enabled,
 // please copy vld.ini and all files in.\winVisualMemDetector\bin\Win64 to current directory of amdllpc.
@@ -74,6 +77,8 @@
 #define SPVGEN_STATIC_LIB 1
 #endif
 #include "llpc.h"
+#include "llpcCache.h"
+#include "llpcCompiler.h"
 #include "llpcDebug.h"
 #include "llpcShaderModuleHelper.h"
 #include "llpcSpirvLowerUtil.h"
@@ -232,11 +237,84 @@ static cl::opt<bool> EnableRelocatableShaderElf("enable-relocatable-shader-elf",
                                                 cl::desc("Compile pipelines using relocatable shader elf"),
                                                 cl::init(false));
 
+// -tiered-compile: build pipelines as a tiered compile, and output the fully optimized rebuild
+static cl::opt<bool> TieredCompile("tiered-compile",
+                                   cl::desc("Build pipelines as a tiered compile, and output the fully optimized "
+                                            "rebuild instead of the quick build"),
+                                   cl::init(false));
+
+// -cancel-after-checks: cancel each pipeline build after it has polled its cancel check the specified number of times
+static cl::opt<unsigned> CancelAfterChecks("cancel-after-checks",
+                                           cl::desc("Cancel each pipeline build once it has polled its cancel check "
+                                                    "the specified number of times, then build it again without "
+                                                    "cancellation (0 disables)"),
+                                           cl::value_desc("count"), cl::init(0));
+
 // -check-auto-layout-compatible: check if auto descriptor layout got from spv file is commpatible with real layout
 static cl::opt<bool> CheckAutoLayoutCompatible(
     "check-auto-layout-compatible",
     cl::desc("check if auto descriptor layout got from spv file is commpatible with real layout"));
 
+// -bench-repeat: benchmark compile time, compiling each input file separately the specified number of times
+static cl::opt<unsigned> BenchRepeat("bench-repeat",
+                                     cl::desc("Benchmark compile time, compiling each input file as its own pipeline "
+                                              "the specified number of times (0 disables benchmarking)"),
+                                     cl::value_desc("count"), cl::init(0));
+
+// -bench-output: file to write the benchmark results to
+static cl::opt<std::string> BenchOutput("bench-output", cl::desc("Output file of benchmark results in JSON"),
+                                        cl::value_desc("filename (\"-\" for stdout)"));
+
+// -bench-baseline: benchmark result file to compare the benchmark results against
+static cl::opt<std::string> BenchBaseline("bench-baseline",
+                                          cl::desc("Benchmark result file to compare the benchmark results against, "
+                                                   "failing if any compile time has regressed"),
+                                          cl::value_desc("filename"));
+
+// -bench-input-root: directory the input names in the benchmark results are relative to
+static cl::opt<std::string> BenchInputRoot("bench-input-root",
+                                           cl::desc("Directory the input names in benchmark results are relative to, "
+                                                    "so that results from different checkouts can be compared"),
+                                           cl::value_desc("dir"));
+
+// -bench-threshold: relative threshold of a compile time regression
+static cl::opt<double> BenchThreshold("bench-threshold",
+                                      cl::desc("Percentage by which a compile time must exceed its baseline to be "
+                                               "reported as a regression (default: 5)"),
+                                      cl::value_desc("percent"), cl::init(5.0));
+
+// -bench-min-delta-ms: absolute threshold of a compile time regression
+static cl::opt<double> BenchMinDeltaMs("bench-min-delta-ms",
+                                       cl::desc("Milliseconds by which a compile time must exceed its baseline to be "
+                                                "reported as a regression, to ignore noise in short phases "
+                                                "(default: 1)"),
+                                       cl::value_desc("ms"), cl::init(1.0));
+
+// -use-in-tree-cache: compile with LLPC's own ICache implementation as the compiler's cache
+static cl::opt<bool> UseInTreeCache("use-in-tree-cache",
+                                    cl::desc("Use LLPC's in-tree cache as the pipeline cache, and report whether each "
+                                             "pipeline hit it"),
+                                    cl::init(false));
+
+// -in-tree-cache-budget: memory budget of the in-tree cache
+static cl::opt<uint64_t> InTreeCacheBudget("in-tree-cache-budget",
+                                           cl::desc("Bytes of ELF the in-tree cache may hold (0 for no limit)"),
+                                           cl::value_desc("bytes"), cl::init(0));
+
+// -in-tree-cache-file: file to load the in-tree cache from and save it to
+static cl::opt<std::string> InTreeCacheFile("in-tree-cache-file",
+                                            cl::desc("File to load the in-tree cache from and save it to on exit"),
+                                            cl::value_desc("filename"));
+
+// -cache-stress-threads: run the stress test of the in-tree cache instead of compiling
+static cl::opt<unsigned> CacheStressThreads("cache-stress-threads",
+                                            cl::desc("Run the stress test of the in-tree cache with the specified "
+                                                     "number of threads instead of compiling (0 disables the test)"),
+                                            cl::value_desc("count"), cl::init(0));
+
+// The in-tree cache used as the compiler's cache with -use-in-tree-cache.
+static std::unique_ptr<Cache> InTreeCache;
+
 namespace llvm {
 
 namespace cl {
@@ -449,7 +527,20 @@ static Result init(int argc, char *argv[], ICompiler **ppCompiler) {
       *static_cast<cl::opt<std::string> *>(opt) = ".";
     }
 
-    result = ICompiler::Create(ParsedGfxIp, argc, argv, ppCompiler);
+    if (UseInTreeCache) {
+      CacheCreateInfo cacheInfo = {};
+      cacheInfo.memoryBudget = InTreeCacheBudget;
+      cacheInfo.fileName = InTreeCacheFile.c_str();
+      cacheInfo.gfxIp = ParsedGfxIp;
+      cacheInfo.optionHash = Compiler::generateHashForCompileOptions(argc, argv);
+      InTreeCache.reset(new Cache());
+      if (InTreeCache->init(&cacheInfo) != Result::Success) {
+        outs() << "WARNING: Failed to load in-tree cache file " << InTreeCacheFile
+               << ", starting with an empty cache\n";
+      }
+    }
+
+    result = ICompiler::Create(ParsedGfxIp, argc, argv, ppCompiler, InTreeCache.get());
   }
 
   if (result == Result::Success && SpvGenDir != "") {
@@ -538,6 +629,66 @@ void *VKAPI_CALL allocateBuffer(void *instance, void *userData, size_t size) {
   return allocBuf;
 }
 
+// Fully optimized rebuild of a tiered pipeline compile
+struct TieredRebuild {
+  Result result;            // Result of the rebuild
+  std::vector<uint8_t> elf; // Rebuilt pipeline ELF
+};
+
+// =====================================================================================================================
+// Callback function to receive the fully optimized rebuild of a tiered pipeline compile.
+//
+// @param userData : std::promise<TieredRebuild> to fulfil
+// @param result : Result of the rebuild
+// @param pipelineBin : Rebuilt pipeline ELF, only valid for the duration of the call
+static void VKAPI_CALL receiveTieredRebuild(void *userData, Result result, const BinaryData *pipelineBin) {
+  TieredRebuild rebuild = {result, {}};
+  if (result == Result::Success) {
+    const uint8_t *code = static_cast<const uint8_t *>(pipelineBin->pCode);
+    rebuild.elf.assign(code, code + pipelineBin->codeSize);
+  }
+  static_cast<std::promise<TieredRebuild> *>(userData)->set_value(std::move(rebuild));
+}
+
+// State of the cancel check of a pipeline build forced by -cancel-after-checks
+struct ForcedCancel {
+  unsigned checkCount;      // Number of times the cancel check has been polled
+  std::thread::id threadId; // Thread doing the build
+};
+
+// =====================================================================================================================
+// Cancel check callback for -cancel-after-checks. It cancels the build once it has been polled the specified number of
+// times. A poll from another thread could only come from a tiered rebuild that kept the cancellation of the quick
+// build, so it cancels straight away, and the rebuild fails.
+//
+// @param userData : ForcedCancel state of the build
+static bool VKAPI_CALL forceCancel(void *userData) {
+  auto forcedCancel = static_cast<ForcedCancel *>(userData);
+  if (std::this_thread::get_id() != forcedCancel->threadId)
+    return true;
+  return ++forcedCancel->checkCount >= CancelAfterChecks;
+}
+
+// =====================================================================================================================
+// Waits for the fully optimized rebuild of a tiered pipeline compile, and replaces the quick build with it.
+//
+// @param tieredRebuild : Promise fulfilled by receiveTieredRebuild
+// @param [in/out] compileInfo : Compilation info of LLPC standalone tool
+// @param [in/out] pipelineBin : Pipeline binary to replace
+static Result waitForTieredRebuild(std::promise<TieredRebuild> &tieredRebuild, CompileInfo *compileInfo,
+                                   BinaryData *pipelineBin) {
+  TieredRebuild rebuild = tieredRebuild.get_future().get();
+  if (rebuild.result != Result::Success)
+    return rebuild.result;
+
+  free(compileInfo->pipelineBuf);
+  void *code = allocateBuffer(nullptr, &compileInfo->pipelineBuf, rebuild.elf.size());
+  memcpy(code, rebuild.elf.data(), rebuild.elf.size());
+  pipelineBin->codeSize = rebuild.elf.size();
+  pipelineBin->pCode = code;
+  return Result::Success;
+}
+
 // =====================================================================================================================
 // Checks whether the specified file name represents a SPIR-V assembly text file (.spvasm).
 static bool isSpirvTextFile(const std::string &fileName) {
@@ -1062,7 +1213,30 @@ static Result buildPipeline(ICompiler *compiler, CompileInfo *compileInfo) {
       outs().flush();
     }
 
+    std::promise<TieredRebuild> tieredRebuild;
+    if (TieredCompile) {
+      pipelineInfo->tieredCompile.pfnOptimizedPipeline = receiveTieredRebuild;
+      pipelineInfo->tieredCompile.pUserData = &tieredRebuild;
+    }
+
+    ForcedCancel forcedCancel = {0, std::this_thread::get_id()};
+    if (CancelAfterChecks > 0) {
+      pipelineInfo->cancellation.pfnIsCancelled = forceCancel;
+      pipelineInfo->cancellation.pUserData = &forcedCancel;
+    }
+
     result = compiler->BuildGraphicsPipeline(pipelineInfo, pipelineOut, pipelineDumpHandle);
+    if (result == Result::ErrorCancelled && CancelAfterChecks > 0) {
+      outs() << "LLPC pipeline build cancelled, building it again without cancellation\n";
+      pipelineInfo->cancellation = {};
+      result = compiler->BuildGraphicsPipeline(pipelineInfo, pipelineOut, pipelineDumpHandle);
+    }
+    if (result == Result::Success && InTreeCache) {
+      outs() << "LLPC pipeline cache access: "
+             << (pipelineOut->pipelineCacheAccess == CacheAccessInfo::CacheHit ? "hit" : "miss") << "\n";
+    }
+    if (result == Result::Success && pipelineOut->tieredRebuildPending)
+      result = waitForTieredRebuild(tieredRebuild, compileInfo, &pipelineOut->pipelineBin);
 
     if (result == Result::Success) {
       if (cl::EnablePipelineDump) {
@@ -1136,7 +1310,30 @@ static Result buildPipeline(ICompiler *compiler, CompileInfo *compileInfo) {
       outs().flush();
     }
 
+    std::promise<TieredRebuild> tieredRebuild;
+    if (TieredCompile) {
+      pipelineInfo->tieredCompile.pfnOptimizedPipeline = receiveTieredRebuild;
+      pipelineInfo->tieredCompile.pUserData = &tieredRebuild;
+    }
+
+    ForcedCancel forcedCancel = {0, std::this_thread::get_id()};
+    if (CancelAfterChecks > 0) {
+      pipelineInfo->cancellation.pfnIsCancelled = forceCancel;
+      pipelineInfo->cancellation.pUserData = &forcedCancel;
+    }
+
     result = compiler->BuildComputePipeline(pipelineInfo, pipelineOut, pipelineDumpHandle);
+    if (result == Result::ErrorCancelled && CancelAfterChecks > 0) {
+      outs() << "LLPC pipeline build cancelled, building it again without cancellation\n";
+      pipelineInfo->cancellation = {};
+      result = compiler->BuildComputePipeline(pipelineInfo, pipelineOut, pipelineDumpHandle);
+    }
+    if (result == Result::Success && InTreeCache) {
+      outs() << "LLPC pipeline cache access: "
+             << (pipelineOut->pipelineCacheAccess == CacheAccessInfo::CacheHit ? "hit" : "miss") << "\n";
+    }
+    if (result == Result::Success && pipelineOut->tieredRebuildPending)
+      result = waitForTieredRebuild(tieredRebuild, compileInfo, &pipelineOut->pipelineBin);
 
     if (result == Result::Success) {
       if (cl::EnablePipelineDump) {
@@ -1507,7 +1704,7 @@ static Result processPipeline(ICompiler *compiler, ArrayRef<std::string> inFiles
     if (result == Result::Success && ToLink) {
       compileInfo.fileNames = fileNames.c_str();
       result = buildPipeline(compiler, &compileInfo);
-      if (result == Result::Success)
+      if (result == Result::Success && BenchRepeat == 0)
         result = outputElf(&compileInfo, OutFile, inFiles[0]);
     }
   }
@@ -1519,6 +1716,48 @@ static Result processPipeline(ICompiler *compiler, ArrayRef<std::string> inFiles
   return result;
 }
 
+// =====================================================================================================================
+// Benchmarks the compile time of each input file, compiling each one as its own pipeline the number of times given by
+// -bench-repeat. An input that fails to compile is recorded as skipped rather than ending the run, so that the lit
+// test corpus can be used as it is, including the tests that are expected to fail.
+//
+// @param compiler : LLPC compiler
+// @param inFiles : Input filenames
+static Result runBenchmark(ICompiler *compiler, ArrayRef<std::string> inFiles) {
+  std::vector<BenchmarkResult> results;
+  unsigned skippedCount = 0;
+
+  for (const std::string &inFile : inFiles) {
+    std::vector<PhaseTimes> samples;
+    for (unsigned i = 0; i < BenchRepeat; ++i) {
+      PhaseTimes times = {};
+      unsigned nextFile = 0;
+      TimerProfiler::setPhaseTimeSink(&times);
+      Result result = processPipeline(compiler, {inFile}, 0, &nextFile);
+      TimerProfiler::setPhaseTimeSink(nullptr);
+      if (result != Result::Success) {
+        samples.clear();
+        break;
+      }
+      samples.push_back(times);
+    }
+
+    results.push_back(summarizeBenchmarkSamples(getBenchmarkInputName(inFile, BenchInputRoot), samples));
+    if (results.back().skipped)
+      ++skippedCount;
+  }
+
+  outs() << "Benchmark: compiled " << (results.size() - skippedCount) << " inputs " << BenchRepeat
+         << " times each, skipped " << skippedCount << " inputs that failed to compile\n";
+
+  Result result = Result::Success;
+  if (!BenchOutput.empty())
+    result = writeBenchmarkResults(BenchOutput, BenchRepeat, results);
+  if (result == Result::Success && !BenchBaseline.empty())
+    result = compareBenchmarkResults(BenchBaseline, results, BenchThreshold, BenchMinDeltaMs);
+  return result;
+}
+
 #ifdef WIN_OS
 // =====================================================================================================================
 // Finds all filenames which can match input file name
@@ -1635,7 +1874,24 @@ int main(int argc, char *argv[]) {
   if (isFailure())
     return onFailure();
 
-  if (isPipelineInfoFile(expandedInputFiles[0]) || isLlvmIrFile(expandedInputFiles[0])) {
+  if (CacheStressThreads > 0) {
+    // Stress test the in-tree cache instead of compiling.
+    result = runCacheStressTest(CacheStressThreads);
+    if (result != Result::Success) {
+      compiler->Destroy();
+      LLPC_ERRS("\n=====  AMDLLPC FAILED  =====\n");
+      return 1;
+    }
+  } else if (BenchRepeat > 0) {
+    // Benchmark the compile time of each input file. This reports its own failure, as a regression in compile time
+    // is a failure of the run even though every pipeline compiled.
+    result = runBenchmark(compiler, expandedInputFiles);
+    if (result != Result::Success) {
+      compiler->Destroy();
+      LLPC_ERRS("\n=====  AMDLLPC FAILED  =====\n");
+      return 1;
+    }
+  } else if (isPipelineInfoFile(expandedInputFiles[0]) || isLlvmIrFile(expandedInputFiles[0])) {
     // The first input file is a pipeline file or LLVM IR file. Assume they all are, and compile each one
     // separately but in the same context.
     unsigned nextFile = 0;
@@ -1656,6 +1912,8 @@ int main(int argc, char *argv[]) {
 
   assert(!isFailure());
   compiler->Destroy();
+  // Destroying the in-tree cache saves it to its file, if it has one.
+  InTreeCache.reset();
   LLPC_OUTS("\n=====  AMDLLPC SUCCESS  =====\n");
   return 0;
 }
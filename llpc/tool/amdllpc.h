@@ -31,9 +31,11 @@
 #pragma once
 
 #include "llpc.h"
+#include "llpcTimerProfiler.h"
 
 #include <vector>
 #include <map>
+#include <string>
 
 struct ResourceNodeSet {
   std::vector<Llpc::ResourceMappingNode> nodes; // Vector of resource mapping nodes
@@ -73,3 +75,23 @@ bool checkShaderInfoComptible(Llpc::PipelineShaderInfo *shaderInfo, unsigned aut
 
 bool checkPipelineStateCompatible(const Llpc::ICompiler *compiler, Llpc::GraphicsPipelineBuildInfo *pipelineInfo,
                                   Llpc::GraphicsPipelineBuildInfo *autoLayoutPipelineInfo, Llpc::GfxIpVersion gfxIp);
+
+// Compile time of one input in the benchmark mode of amdllpc, in milliseconds.
+struct BenchmarkResult {
+  std::string name;                // Name of the input file
+  bool skipped;                    // Whether the input was skipped because it failed to compile
+  double total;                    // Median total compile time
+  double phases[Llpc::TimerCount]; // Median compile time of each phase, indexed by Llpc::TimerKind
+};
+
+std::string getBenchmarkInputName(const std::string &inFile, const std::string &inputRoot);
+
+BenchmarkResult summarizeBenchmarkSamples(const std::string &name, const std::vector<Llpc::PhaseTimes> &samples);
+
+Llpc::Result writeBenchmarkResults(const std::string &fileName, unsigned repeatCount,
+                                   const std::vector<BenchmarkResult> &results);
+
+Llpc::Result compareBenchmarkResults(const std::string &baselineFile, const std::vector<BenchmarkResult> &results,
+                                     double thresholdPercent, double minDeltaMs);
+
+Llpc::Result runCacheStressTest(unsigned threadCount);
@@ -0,0 +1,310 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2019-2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcBenchmark.cpp
+ * @brief LLPC source file: compile time results of the benchmark mode of AMDLLPC
+ ***********************************************************************************************************************
+ */
+#ifdef WIN_OS
+// NOTE: Disable Windows-defined min()/max() because we use STL-defined std::min()/std::max() in LLPC.
+#define NOMINMAX
+#endif
+
+#include "amdllpc.h"
+#include "llpcDebug.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+#define DEBUG_TYPE "llpc-benchmark"
+
+using namespace llvm;
+using namespace Llpc;
+
+// Version of the benchmark result file format, bumped whenever the format changes incompatibly.
+static const int BenchmarkResultVersion = 1;
+
+// Names of the compilation phases in the benchmark result file, indexed by TimerKind.
+static const char *const PhaseNames[TimerCount] = {"translate", "lower", "loadBc", "patch", "opt", "codeGen"};
+
+// Percentage of the inputs compiled in this run that must be found in the baseline for the comparison to be valid.
+static const unsigned MinComparedPercent = 50;
+
+// =====================================================================================================================
+// Gets the name of an input file in the benchmark results: its path relative to the input root, with '/' separators,
+// so that the results of runs from different checkouts or build directories can be compared. An input outside the
+// root, or any input if there is no root, is named by its path as given.
+//
+// @param inFile : Path of the input file
+// @param inputRoot : Directory the input names are relative to, or empty
+std::string getBenchmarkInputName(const std::string &inFile, const std::string &inputRoot) {
+  if (inputRoot.empty())
+    return inFile;
+
+  SmallString<256> path(inFile);
+  SmallString<256> root(inputRoot);
+  if (sys::fs::make_absolute(path) || sys::fs::make_absolute(root))
+    return inFile;
+  sys::path::remove_dots(path, /*remove_dot_dot=*/true);
+  sys::path::remove_dots(root, /*remove_dot_dot=*/true);
+
+  // Compare whole components, so that a root of "a/b" does not match a path in "a/bc".
+  auto pathIt = sys::path::begin(path);
+  const auto pathEnd = sys::path::end(path);
+  for (auto rootIt = sys::path::begin(root), rootEnd = sys::path::end(root); rootIt != rootEnd; ++rootIt, ++pathIt) {
+    if (pathIt == pathEnd || *pathIt != *rootIt)
+      return inFile;
+  }
+
+  SmallString<256> name;
+  for (; pathIt != pathEnd; ++pathIt)
+    sys::path::append(name, sys::path::Style::posix, *pathIt);
+  if (name.empty())
+    return inFile;
+  return name.str().str();
+}
+
+// =====================================================================================================================
+// Gets the median of the specified times.
+//
+// @param times : Times to get the median of; they are reordered
+static double getMedian(std::vector<double> &times) {
+  if (times.empty())
+    return 0.0;
+
+  std::sort(times.begin(), times.end());
+  const size_t middle = times.size() / 2;
+  if (times.size() % 2 != 0)
+    return times[middle];
+  return (times[middle - 1] + times[middle]) / 2.0;
+}
+
+// =====================================================================================================================
+// Summarizes the times of the repeated compiles of one input as the median of each time, in milliseconds. The median
+// is used rather than the mean so that an outlier caused by noise on the machine does not skew the result.
+//
+// @param name : Name of the input file
+// @param samples : Times of each compile of the input, in seconds
+BenchmarkResult summarizeBenchmarkSamples(const std::string &name, const std::vector<PhaseTimes> &samples) {
+  BenchmarkResult result = {};
+  result.name = name;
+  result.skipped = samples.empty();
+
+  std::vector<double> times;
+  times.reserve(samples.size());
+  for (const PhaseTimes &sample : samples)
+    times.push_back(sample.total * 1000.0);
+  result.total = getMedian(times);
+
+  for (unsigned timerKind = 0; timerKind < TimerCount; ++timerKind) {
+    times.clear();
+    for (const PhaseTimes &sample : samples)
+      times.push_back(sample.phases[timerKind] * 1000.0);
+    result.phases[timerKind] = getMedian(times);
+  }
+  return result;
+}
+
+// =====================================================================================================================
+// Writes the benchmark results to a JSON file, which can be used as the baseline of a later run.
+//
+// @param fileName : Name of the output file ("-" for stdout)
+// @param repeatCount : Number of times each input was compiled
+// @param results : Results of each input
+Result writeBenchmarkResults(const std::string &fileName, unsigned repeatCount,
+                             const std::vector<BenchmarkResult> &results) {
+  json::Array inputs;
+  for (const BenchmarkResult &result : results) {
+    json::Object input{{"name", result.name}};
+    if (result.skipped) {
+      input["skipped"] = true;
+    } else {
+      json::Object phases;
+      for (unsigned timerKind = 0; timerKind < TimerCount; ++timerKind)
+        phases[PhaseNames[timerKind]] = result.phases[timerKind];
+      input["total"] = result.total;
+      input["phases"] = std::move(phases);
+    }
+    inputs.push_back(std::move(input));
+  }
+
+  json::Value root = json::Object{{"version", BenchmarkResultVersion},
+                                  {"repeat", static_cast<int64_t>(repeatCount)},
+                                  {"inputs", std::move(inputs)}};
+
+  std::error_code errCode;
+  raw_fd_ostream outStream(fileName, errCode, sys::fs::F_Text);
+  if (errCode) {
+    LLPC_ERRS("Fails to open benchmark output file: " << fileName << "\n");
+    return Result::ErrorUnavailable;
+  }
+  outStream << formatv("{0:2}", root) << "\n";
+  return Result::Success;
+}
+
+// =====================================================================================================================
+// Reads the total and phase times of each input from a benchmark result file.
+//
+// @param fileName : Name of the result file
+// @param [out] results : Results of each input that was not skipped, keyed by input name
+static Result readBenchmarkResults(const std::string &fileName, StringMap<BenchmarkResult> &results) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> fileOrErr = MemoryBuffer::getFile(fileName);
+  if (!fileOrErr) {
+    LLPC_ERRS("Fails to open benchmark baseline file: " << fileName << "\n");
+    return Result::ErrorUnavailable;
+  }
+
+  Expected<json::Value> root = json::parse((*fileOrErr)->getBuffer());
+  if (!root) {
+    LLPC_ERRS("Fails to parse benchmark baseline file " << fileName << ": " << toString(root.takeError()) << "\n");
+    return Result::ErrorInvalidValue;
+  }
+
+  const json::Object *rootObj = root->getAsObject();
+  const json::Array *inputs = rootObj ? rootObj->getArray("inputs") : nullptr;
+  if (!inputs || rootObj->getInteger("version").getValueOr(0) != BenchmarkResultVersion) {
+    LLPC_ERRS("Benchmark baseline file " << fileName << " has an unsupported format\n");
+    return Result::ErrorInvalidValue;
+  }
+
+  for (const json::Value &inputValue : *inputs) {
+    const json::Object *input = inputValue.getAsObject();
+    if (!input)
+      continue;
+    Optional<StringRef> name = input->getString("name");
+    Optional<double> total = input->getNumber("total");
+    const json::Object *phases = input->getObject("phases");
+    if (!name || !total || !phases)
+      continue;
+
+    BenchmarkResult result = {};
+    result.name = name->str();
+    result.total = *total;
+    for (unsigned timerKind = 0; timerKind < TimerCount; ++timerKind)
+      result.phases[timerKind] = phases->getNumber(PhaseNames[timerKind]).getValueOr(0.0);
+    results[*name] = result;
+  }
+  return Result::Success;
+}
+
+// =====================================================================================================================
+// Checks whether a time has regressed from its baseline. It has only regressed if it is slower by both more than the
+// relative threshold and more than the absolute minimum delta, so that noise in very short phases is not reported.
+//
+// @param time : Time of this run, in milliseconds
+// @param baselineTime : Time of the baseline, in milliseconds
+// @param thresholdPercent : Relative threshold, as a percentage of the baseline time
+// @param minDeltaMs : Absolute minimum delta, in milliseconds
+static bool isRegression(double time, double baselineTime, double thresholdPercent, double minDeltaMs) {
+  const double delta = time - baselineTime;
+  return delta > minDeltaMs && delta > baselineTime * thresholdPercent / 100.0;
+}
+
+// =====================================================================================================================
+// Compares the benchmark results against the results in a baseline file, and reports every input whose total or
+// phase time has regressed. Inputs that are skipped in this run or missing from the baseline are not compared, but if
+// fewer than MinComparedPercent of the inputs compiled in this run are found in the baseline, the baseline is taken
+// to be for another set of inputs or another input root, and the comparison fails rather than passing vacuously.
+//
+// Returns Result::Success if nothing has regressed, Result::ErrorUnknown if something has, Result::ErrorInvalidValue
+// if too few inputs match the baseline, or the error reading the baseline file.
+//
+// @param baselineFile : Name of the baseline result file
+// @param results : Results of each input
+// @param thresholdPercent : Relative threshold for a regression, as a percentage of the baseline time
+// @param minDeltaMs : Absolute minimum delta for a regression, in milliseconds
+Result compareBenchmarkResults(const std::string &baselineFile, const std::vector<BenchmarkResult> &results,
+                               double thresholdPercent, double minDeltaMs) {
+  StringMap<BenchmarkResult> baselines;
+  Result result = readBenchmarkResults(baselineFile, baselines);
+  if (result != Result::Success)
+    return result;
+
+  unsigned compiledCount = 0;
+  unsigned comparedCount = 0;
+  unsigned regressionCount = 0;
+  const BenchmarkResult *firstUnmatched = nullptr;
+  double totalTime = 0.0;
+  double baselineTotalTime = 0.0;
+  auto reportRegression = [](const std::string &name, StringRef what, double time, double baselineTime) {
+    outs() << "Regression: " << name << " (" << what << "): " << format("%.3f", baselineTime) << " ms -> "
+           << format("%.3f", time) << " ms";
+    if (baselineTime > 0.0)
+      outs() << " (" << format("%+.1f", (time / baselineTime - 1.0) * 100.0) << "%)";
+    outs() << "\n";
+  };
+
+  for (const BenchmarkResult &current : results) {
+    if (current.skipped)
+      continue;
+    ++compiledCount;
+    auto it = baselines.find(current.name);
+    if (it == baselines.end()) {
+      if (!firstUnmatched)
+        firstUnmatched = &current;
+      continue;
+    }
+
+    const BenchmarkResult &baseline = it->second;
+    ++comparedCount;
+    totalTime += current.total;
+    baselineTotalTime += baseline.total;
+
+    bool regressed = false;
+    if (isRegression(current.total, baseline.total, thresholdPercent, minDeltaMs)) {
+      reportRegression(current.name, "total", current.total, baseline.total);
+      regressed = true;
+    }
+    for (unsigned timerKind = 0; timerKind < TimerCount; ++timerKind) {
+      if (isRegression(current.phases[timerKind], baseline.phases[timerKind], thresholdPercent, minDeltaMs)) {
+        reportRegression(current.name, PhaseNames[timerKind], current.phases[timerKind], baseline.phases[timerKind]);
+        regressed = true;
+      }
+    }
+    if (regressed)
+      ++regressionCount;
+  }
+
+  outs() << "Benchmark: compared " << comparedCount << " inputs against " << baselineFile << ", total "
+         << format("%.3f", baselineTotalTime) << " ms -> " << format("%.3f", totalTime) << " ms, " << regressionCount
+         << " regressed\n";
+
+  if (comparedCount == 0 || comparedCount * 100 < compiledCount * MinComparedPercent) {
+    const std::string example = firstUnmatched ? " (such as " + firstUnmatched->name + ")" : "";
+    LLPC_ERRS("Only " << comparedCount << " of " << compiledCount << " compiled inputs" << example
+                      << " were found in benchmark baseline " << baselineFile
+                      << "; check that it is for the same inputs and -bench-input-root\n");
+    return Result::ErrorInvalidValue;
+  }
+  return regressionCount == 0 ? Result::Success : Result::ErrorUnknown;
+}
@@ -0,0 +1,232 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcCacheStress.cpp
+ * @brief LLPC source file: stress test of the in-tree cache, run by amdllpc -cache-stress-threads
+ ***********************************************************************************************************************
+ */
+#include "amdllpc.h"
+#include "llpcCache.h"
+#include "llpcDebug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define DEBUG_TYPE "llpc-cache-stress"
+
+using namespace llvm;
+using namespace Llpc;
+using Vkgc::EntryHandle;
+using Vkgc::HashId;
+
+// Number of distinct hashes the threads of the race test look up
+static const unsigned RaceHashCount = 16;
+
+// Number of shards the hashes of the race test fall in, so that shards go over budget and evict
+static const unsigned RaceShardCount = 4;
+
+// Size of each value in the race test
+static const size_t RaceValueSize = 64;
+
+// Number of lookups made by each thread of the race test
+static const unsigned RaceLookupCount = 2000;
+
+// =====================================================================================================================
+// Makes a hash key for a test entry. The low byte of the hash selects the shard of the cache.
+//
+// @param shard : Low byte of the hash
+// @param index : Distinguishes hashes with the same low byte
+static HashId makeHash(unsigned shard, unsigned index) {
+  HashId hash = {};
+  hash.bytes[0] = static_cast<uint8_t>(shard);
+  hash.dwords[1] = index;
+  hash.qwords[1] = 0x9E3779B97F4A7C15ull * (index + 1);
+  return hash;
+}
+
+// =====================================================================================================================
+// Reports a failed check of the stress test.
+//
+// @param passed : Whether the check passed
+// @param what : Description of the check
+// @param [in/out] result : Set to ErrorUnknown if the check failed
+static void check(bool passed, const char *what, Result &result) {
+  if (passed)
+    return;
+  LLPC_ERRS("In-tree cache stress test: " << what << "\n");
+  result = Result::ErrorUnknown;
+}
+
+// =====================================================================================================================
+// Checks each transition of the entry state machine, and eviction, from a single thread.
+static Result checkStateMachine() {
+  Result result = Result::Success;
+  const uint32_t value = 0x12345678;
+
+  {
+    Cache cache;
+    CacheCreateInfo createInfo = {};
+    cache.init(&createInfo);
+    const HashId hash = makeHash(1, 1);
+
+    EntryHandle lookup;
+    check(cache.GetEntry(hash, false, &lookup) == Result::NotFound && lookup.IsEmpty(),
+          "lookup without allocation of a missing entry returned a handle", result);
+
+    EntryHandle creator;
+    check(cache.GetEntry(hash, true, &creator) == Result::NotFound && !creator.IsEmpty(),
+          "lookup with allocation of a missing entry did not allocate it", result);
+
+    EntryHandle waiter;
+    check(cache.GetEntry(hash, true, &waiter) == Result::NotReady,
+          "lookup of a pending entry did not return NotReady", result);
+    size_t dataLen = 0;
+    check(waiter.GetValue(nullptr, &dataLen) == Result::NotReady, "value of a pending entry is ready", result);
+
+    // The creator fails: the waiter gets an error, and the entry is allocated again by the next lookup.
+    creator.SetValue(false, nullptr, 0);
+    EntryHandle::ReleaseHandle(std::move(creator));
+    check(waiter.WaitForEntry() != Result::Success, "wait for a failed entry succeeded", result);
+    EntryHandle::ReleaseHandle(std::move(waiter));
+
+    check(cache.GetEntry(hash, true, &creator) == Result::NotFound && !creator.IsEmpty(),
+          "failed entry was not allocated again", result);
+    creator.SetValue(true, &value, sizeof(value));
+    EntryHandle::ReleaseHandle(std::move(creator));
+
+    check(cache.GetEntry(hash, false, &lookup) == Result::Success, "lookup of a ready entry failed", result);
+    const void *data = nullptr;
+    check(lookup.GetValueZeroCopy(&data, &dataLen) == Result::Success && dataLen == sizeof(value) &&
+              memcmp(data, &value, sizeof(value)) == 0,
+          "value of a ready entry is wrong", result);
+    check(cache.getTotalSize() == sizeof(value), "total size of the cache is wrong", result);
+  }
+
+  {
+    // Budget for one value in each shard. Entries in the same shard evict the least recently used entry that has no
+    // handle, but never an entry that has one.
+    Cache cache;
+    CacheCreateInfo createInfo = {};
+    createInfo.memoryBudget = sizeof(value) * 16;
+    cache.init(&createInfo);
+    const HashId first = makeHash(0, 1);
+    const HashId second = makeHash(0, 2);
+    const HashId third = makeHash(0, 3);
+
+    auto populate = [&](const HashId &hash) {
+      EntryHandle creator;
+      cache.GetEntry(hash, true, &creator);
+      creator.SetValue(true, &value, sizeof(value));
+    };
+
+    populate(first);
+    populate(second);
+    EntryHandle lookup;
+    check(cache.GetEntry(first, false, &lookup) == Result::NotFound, "least recently used entry not evicted", result);
+
+    EntryHandle kept;
+    check(cache.GetEntry(second, false, &kept) == Result::Success, "most recently used entry evicted", result);
+    populate(third);
+    check(cache.GetEntry(second, false, &lookup) == Result::Success, "entry with a handle evicted", result);
+    EntryHandle::ReleaseHandle(std::move(lookup));
+    check(cache.GetEntry(third, false, &lookup) == Result::NotFound, "cache over budget after eviction", result);
+    check(cache.getTotalSize() == sizeof(value), "total size of the cache is wrong after eviction", result);
+  }
+
+  return result;
+}
+
+// =====================================================================================================================
+// Races threads looking up, populating and failing to populate a few entries of a cache with a small budget, checking
+// that every value read is the one written for its hash.
+//
+// @param threadCount : Number of threads
+static Result checkRace(unsigned threadCount) {
+  Cache cache;
+  CacheCreateInfo createInfo = {};
+  createInfo.memoryBudget = RaceValueSize * 2 * 16;
+  cache.init(&createInfo);
+
+  std::atomic<unsigned> errorCount(0);
+  auto runThread = [&](unsigned threadIdx) {
+    std::mt19937 random(threadIdx);
+    for (unsigned i = 0; i != RaceLookupCount; ++i) {
+      const unsigned hashIdx = random() % RaceHashCount;
+      const HashId hash = makeHash(hashIdx % RaceShardCount, hashIdx);
+      uint8_t expected[RaceValueSize];
+      memset(expected, hashIdx, sizeof(expected));
+
+      EntryHandle handle;
+      Result result = cache.GetEntry(hash, true, &handle);
+      if (result == Result::NotFound) {
+        // Fail to populate a quarter of the entries, so that waiters see failures.
+        if (random() % 4 == 0)
+          handle.SetValue(false, nullptr, 0);
+        else
+          handle.SetValue(true, expected, sizeof(expected));
+        continue;
+      }
+
+      if (result == Result::NotReady)
+        result = handle.WaitForEntry();
+      if (result != Result::Success)
+        continue;
+
+      const void *data = nullptr;
+      size_t dataLen = 0;
+      if (handle.GetValueZeroCopy(&data, &dataLen) != Result::Success || dataLen != sizeof(expected) ||
+          memcmp(data, expected, sizeof(expected)) != 0)
+        ++errorCount;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned threadIdx = 0; threadIdx != threadCount; ++threadIdx)
+    threads.emplace_back(runThread, threadIdx);
+  for (std::thread &thread : threads)
+    thread.join();
+
+  Result result = Result::Success;
+  check(errorCount == 0, "a thread read a wrong value", result);
+  check(cache.getTotalSize() <= createInfo.memoryBudget, "cache over budget after the race", result);
+  return result;
+}
+
+// =====================================================================================================================
+// Runs the stress test of the in-tree cache.
+//
+// @param threadCount : Number of threads racing on the cache
+Result runCacheStressTest(unsigned threadCount) {
+  Result result = checkStateMachine();
+  if (result == Result::Success)
+    result = checkRace(threadCount);
+  if (result == Result::Success)
+    outs() << "In-tree cache stress test passed with " << threadCount << " threads\n";
+  return result;
+}
@@ -43,6 +43,7 @@
 
 #include <string>
 #include <iostream>
+#include <memory>
 #include "spirvExt.h"
 
 namespace llvm {
@@ -118,6 +119,21 @@ bool readSpirv(lgc::Builder *Builder, const Vkgc::ShaderModuleUsage *ModuleData,
                const char *EntryName, const SPIRV::SPIRVSpecConstMap &SpecConstMap,
                llvm::ArrayRef<SPIRV::ConvertingSampler> ConvertingSamplers, llvm::Module *M, std::string &ErrMsg);
 
+/// \brief Load SPIRV from istream into a module for readSpirv. Translation does not modify the module, so one
+/// parsed module can be translated any number of times, including concurrently from several threads.
+/// @returns : The parsed module.
+std::shared_ptr<SPIRV::SPIRVModule> parseSpirv(std::istream &IS);
+
+/// \brief Translate SPIRV module returned by parseSpirv to LLVM module. If SymbolicSpecConsts is set, scalar
+/// specialization constants are not given values from SpecConstMap but are left as placeholders, for the caller
+/// to specialize the LLVM module later.
+/// @returns : True if succeeds.
+bool readSpirv(lgc::Builder *Builder, const Vkgc::ShaderModuleUsage *ModuleData,
+               const Vkgc::PipelineShaderOptions *ShaderOptions, SPIRV::SPIRVModule *BM,
+               spv::ExecutionModel EntryExecModel, const char *EntryName, const SPIRV::SPIRVSpecConstMap &SpecConstMap,
+               bool SymbolicSpecConsts, llvm::ArrayRef<SPIRV::ConvertingSampler> ConvertingSamplers, llvm::Module *M,
+               std::string &ErrMsg);
+
 /// \brief Regularize LLVM module by removing entities not representable by
 /// SPIRV.
 bool regularizeLlvmForSpirv(llvm::Module *M, std::string &ErrMsg);
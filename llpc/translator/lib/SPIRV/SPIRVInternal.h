@@ -222,6 +222,7 @@ const static char BufferStore[] = "spirv.BufferStore";
 const static char AccessChain[] = "spirv.AccessChain";
 const static char StorageBufferCall[] = "spirv.StorageBufferCall";
 const static char NonUniform[] = "spirv.NonUniform";
+const static char SpecConst[] = "spirv.SpecConst";
 } // namespace gSPIRVMD
 
 namespace gSPIRVName {
@@ -233,6 +234,7 @@ const static char InterpolateAtOffset[] = "interpolateAtOffset";
 const static char InterpolateAtVertexAMD[] = "InterpolateAtVertexAMD";
 const static char NonUniform[] = "spirv.NonUniform";
 const static char UnpackHalf2x16[] = "unpackHalf2x16";
+const static char SpecConstPrefix[] = "spirv.SpecConst.";
 } // namespace gSPIRVName
 
 enum SPIRVBlockTypeKind {
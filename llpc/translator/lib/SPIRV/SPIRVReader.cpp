@@ -50,6 +50,7 @@
 #include "llpcPipelineContext.h"
 #include "lgc/Pipeline.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/BinaryFormat/Dwarf.h"
 #include "llvm/IR/CFG.h"
@@ -132,10 +133,12 @@ static void dumpLLVM(Module *m, const std::string &fName) {
 }
 
 SPIRVToLLVM::SPIRVToLLVM(Module *llvmModule, SPIRVModule *theSpirvModule, const SPIRVSpecConstMap &theSpecConstMap,
-                         ArrayRef<ConvertingSampler> convertingSamplers, lgc::Builder *builder,
-                         const Vkgc::ShaderModuleUsage *moduleUsage, const Vkgc::PipelineShaderOptions *shaderOptions)
-    : m_m(llvmModule), m_builder(builder), m_bm(theSpirvModule), m_enableXfb(false), m_entryTarget(nullptr),
-      m_specConstMap(theSpecConstMap), m_convertingSamplers(convertingSamplers), m_dbgTran(m_bm, m_m, this),
+                         bool symbolicSpecConsts, ArrayRef<ConvertingSampler> convertingSamplers,
+                         lgc::Builder *builder, const Vkgc::ShaderModuleUsage *moduleUsage,
+                         const Vkgc::PipelineShaderOptions *shaderOptions)
+    : m_m(llvmModule), m_builder(builder), m_bm(theSpirvModule), m_specConstOverlay(theSpirvModule),
+      m_enableXfb(false), m_entryTarget(nullptr), m_specConstMap(theSpecConstMap),
+      m_symbolicSpecConsts(symbolicSpecConsts), m_convertingSamplers(convertingSamplers), m_dbgTran(m_bm, m_m, this),
       m_moduleUsage(reinterpret_cast<const Vkgc::ShaderModuleUsage *>(moduleUsage)),
       m_shaderOptions(reinterpret_cast<const Vkgc::PipelineShaderOptions *>(shaderOptions)) {
   assert(m_m);
@@ -3718,6 +3721,38 @@ Constant *SPIRVToLLVM::transInitializer(SPIRVValue *const spvValue, Type *const
   }
 }
 
+// =====================================================================================================================
+// Translate a scalar specialization constant that is kept symbolic, for a shader module translated before its
+// specialization is known. The constant becomes ptrtoint of an extern_weak global named after its SpecId, which LLVM
+// cannot fold: the global may be null and has no alignment, so nothing about its address is known. The global
+// records the SpecId and the default value, and the pipeline compile replaces each use with the specialized value.
+//
+// @param bv : The OpSpecConstant, OpSpecConstantTrue or OpSpecConstantFalse
+// @param ty : The LLVM type of the constant
+// @param defaultValue : The default value of the constant
+Constant *SPIRVToLLVM::transSymbolicSpecConst(SPIRVValue *bv, Type *ty, uint64_t defaultValue) {
+  IntegerType *intTy = IntegerType::get(*m_context, ty->getPrimitiveSizeInBits());
+  unsigned specId = SPIRVID_INVALID;
+  if (!bv->hasDecorate(DecorationSpecId, 0, &specId)) {
+    // Without a SpecId, the constant can never be specialized.
+    return ConstantExpr::getBitCast(ConstantInt::get(intTy, defaultValue), ty);
+  }
+
+  std::string name = (Twine(gSPIRVName::SpecConstPrefix) + Twine(specId)).str();
+  GlobalVariable *global = m_m->getNamedGlobal(name);
+  if (!global) {
+    global = new GlobalVariable(*m_m, getBuilder()->getInt8Ty(), true, GlobalValue::ExternalWeakLinkage, nullptr, name);
+    Metadata *specConstMeta[] = {ConstantAsMetadata::get(getBuilder()->getInt32(specId)),
+                                 ConstantAsMetadata::get(ConstantInt::get(intTy, defaultValue))};
+    global->setMetadata(gSPIRVMD::SpecConst, MDNode::get(*m_context, specConstMeta));
+  }
+
+  Constant *value = ConstantExpr::getPtrToInt(global, intTy);
+  if (ty != intTy)
+    value = ConstantExpr::getBitCast(value, ty);
+  return value;
+}
+
 // =====================================================================================================================
 // Handle OpVariable.
 //
@@ -3956,6 +3991,8 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *bv, Function *f, Bas
     SPIRVConstant *bConst = static_cast<SPIRVConstant *>(bv);
     SPIRVType *bt = bv->getType();
     Type *lt = transType(bt);
+    if (oc == OpSpecConstant && m_symbolicSpecConsts)
+      return mapValue(bv, transSymbolicSpecConst(bv, lt, bConst->getZExtIntValue()));
     switch (bt->getOpCode()) {
     case OpTypeBool:
     case OpTypeInt:
@@ -3991,6 +4028,8 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *bv, Function *f, Bas
     bool boolVal = oc == OpConstantTrue || oc == OpSpecConstantTrue
                        ? static_cast<SPIRVConstantTrue *>(bv)->getBoolValue()
                        : static_cast<SPIRVConstantFalse *>(bv)->getBoolValue();
+    if ((oc == OpSpecConstantTrue || oc == OpSpecConstantFalse) && m_symbolicSpecConsts)
+      return mapValue(bv, transSymbolicSpecConst(bv, getBuilder()->getInt1Ty(), boolVal));
     return boolVal ? mapValue(bv, ConstantInt::getTrue(*m_context)) : mapValue(bv, ConstantInt::getFalse(*m_context));
   }
 
@@ -4116,8 +4155,8 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *bv, Function *f, Bas
     auto lm = static_cast<SPIRVLoopMerge *>(br->getPrevious());
     if (lm && lm->getOpCode() == OpLoopMerge)
       setLLVMLoopMetadata(lm, bi);
-    else if (br->getBasicBlock()->getLoopMerge())
-      setLLVMLoopMetadata(br->getBasicBlock()->getLoopMerge(), bi);
+    else if (auto continueLm = m_continueTargetToLoopMerge.lookup(br->getBasicBlock()))
+      setLLVMLoopMetadata(continueLm, bi);
 
     recordBlockPredecessor(successor, bb);
     return mapValue(bv, bi);
@@ -4142,8 +4181,8 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *bv, Function *f, Bas
     auto lm = static_cast<SPIRVLoopMerge *>(br->getPrevious());
     if (lm && lm->getOpCode() == OpLoopMerge)
       setLLVMLoopMetadata(lm, bc);
-    else if (br->getBasicBlock()->getLoopMerge())
-      setLLVMLoopMetadata(br->getBasicBlock()->getLoopMerge(), bc);
+    else if (auto continueLm = m_continueTargetToLoopMerge.lookup(br->getBasicBlock()))
+      setLLVMLoopMetadata(continueLm, bc);
 
     recordBlockPredecessor(trueSuccessor, bb);
     recordBlockPredecessor(falseSuccessor, bb);
@@ -4202,7 +4241,7 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *bv, Function *f, Bas
   case OpLoopMerge: { // Should be translated at OpBranch or OpBranchConditional cases
     SPIRVLoopMerge *lm = static_cast<SPIRVLoopMerge *>(bv);
     auto label = m_bm->get<SPIRVBasicBlock>(lm->getContinueTarget());
-    label->setLoopMerge(lm);
+    m_continueTargetToLoopMerge[label] = lm;
     return nullptr;
   }
   case OpSwitch: {
@@ -5051,6 +5090,11 @@ Function *SPIRVToLLVM::transFunction(SPIRVFunction *bf) {
       SPIRVInstruction *bInst = bbb->getInst(bi);
       transValue(bInst, f, bb, false);
     }
+
+    // Stop once the pipeline build has been cancelled. All the blocks already exist, so the partly translated function
+    // can still be deleted along with the module.
+    if (static_cast<Llpc::Context *>(m_context)->isBuildCancelled())
+      break;
   }
 
   // Update phi nodes -- add missing incoming arcs.
@@ -6123,6 +6167,33 @@ Instruction *SPIRVToLLVM::transSPIRVBuiltinFromInst(SPIRVInstruction *bi, BasicB
   return transBuiltinFromInst(getName(bi->getOpCode()), bi, bb);
 }
 
+// =====================================================================================================================
+// Collects the functions that the specified entry-point may call, directly or indirectly, including the entry-point
+// itself.
+//
+// @param entryFunc : Entry-point function
+// @param [out] reachableFuncs : Set of reachable functions
+static void collectReachableFunctions(SPIRVFunction *entryFunc, SmallPtrSetImpl<SPIRVFunction *> &reachableFuncs) {
+  SmallVector<SPIRVFunction *, 8> worklist;
+  reachableFuncs.insert(entryFunc);
+  worklist.push_back(entryFunc);
+
+  while (!worklist.empty()) {
+    SPIRVFunction *bf = worklist.pop_back_val();
+    for (size_t i = 0, e = bf->getNumBasicBlock(); i != e; ++i) {
+      SPIRVBasicBlock *bbb = bf->getBasicBlock(i);
+      for (size_t bi = 0, be = bbb->getNumInst(); bi != be; ++bi) {
+        SPIRVInstruction *bInst = bbb->getInst(bi);
+        if (bInst->getOpCode() != OpFunctionCall)
+          continue;
+        SPIRVFunction *callee = static_cast<SPIRVFunctionCall *>(bInst)->getFunction();
+        if (reachableFuncs.insert(callee).second)
+          worklist.push_back(callee);
+      }
+    }
+  }
+}
+
 bool SPIRVToLLVM::translate(ExecutionModel entryExecModel, const char *entryName) {
   if (!transAddressingModel())
     return false;
@@ -6234,14 +6305,9 @@ bool SPIRVToLLVM::translate(ExecutionModel entryExecModel, const char *entryName
         uint64_t data = 0;
         memcpy(&data, specConstEntry.Data, specConstEntry.DataSize);
 
-        if (oc == OpSpecConstant)
-          static_cast<SPIRVConstant *>(bv)->setZExtIntValue(data);
-        else if (oc == OpSpecConstantTrue)
-          static_cast<SPIRVSpecConstantTrue *>(bv)->setBoolValue(data != 0);
-        else if (oc == OpSpecConstantFalse)
-          static_cast<SPIRVSpecConstantFalse *>(bv)->setBoolValue(data != 0);
-        else
-          llvm_unreachable("Invalid op code");
+        // The value goes in the overlay rather than the SPIR-V module, which may be shared with other
+        // translations using different specialization info.
+        m_specConstOverlay.setSpecConstValue(bv, data);
       }
     } else if (oc == OpSpecConstantOp) {
       // NOTE: Constant folding is applied to OpSpecConstantOp because at this
@@ -6249,25 +6315,48 @@ bool SPIRVToLLVM::translate(ExecutionModel entryExecModel, const char *entryName
       // get their own finalized specialization values.
       auto bi = static_cast<SPIRVSpecConstantOp *>(bv);
       bv = createValueFromSpecConstantOp(bi, m_fpControlFlags.RoundingModeRTE);
-      bi->mapToConstant(bv);
+      m_specConstOverlay.mapSpecConstantOp(bi, bv);
     }
   }
 
+  // Only translate what the targeted entry-point can reach: the functions in its call graph, the variables in its
+  // interface, and the other global variables, which are translated when a reachable function first uses them. A
+  // module with many entry-points would otherwise spend most of its translation on code that is then thrown away.
+  const bool keepUnreachable = m_moduleUsage->keepUnusedFunctions;
+  SmallPtrSet<SPIRVFunction *, 16> reachableFuncs;
+  collectReachableFunctions(m_entryTarget, reachableFuncs);
+
+  SmallPtrSet<SPIRVValue *, 16> interfaceVars;
+  auto inOuts = entryPoint->getInOuts();
+  for (SPIRVWord varId : ArrayRef<SPIRVWord>(inOuts.first, inOuts.second))
+    interfaceVars.insert(m_bm->getValue(varId));
+
   for (unsigned i = 0, e = m_bm->getNumVariables(); i != e; ++i) {
     auto bv = m_bm->getVariable(i);
-    if (bv->getStorageClass() != StorageClassFunction)
+    if (bv->getStorageClass() != StorageClassFunction && (keepUnreachable || interfaceVars.count(bv)))
       transValue(bv, nullptr, nullptr);
   }
 
   for (unsigned i = 0, e = m_bm->getNumFunctions(); i != e; ++i) {
     auto bf = m_bm->getFunction(i);
-    // Non entry-points and targeted entry-point should be translated.
+    // Reachable non entry-points and targeted entry-point should be translated.
     // Set DLLExport on targeted entry-point so we can find it later.
-    if (!m_bm->getEntryPoint(bf->getId()) || bf == m_entryTarget) {
+    if (bf == m_entryTarget || (!m_bm->getEntryPoint(bf->getId()) && (keepUnreachable || reachableFuncs.count(bf)))) {
       auto f = transFunction(bf);
       if (bf == m_entryTarget)
         f->setDLLStorageClass(GlobalValue::DLLExportStorageClass);
     }
+    if (static_cast<Llpc::Context *>(m_context)->isBuildCancelled())
+      return false;
+  }
+
+  // Global variables translated on first use were created in the order the functions use them. Move all the global
+  // variables back into the order they are declared in the SPIR-V module, so the output does not depend on which
+  // function used a variable first.
+  auto &globalList = m_m->getGlobalList();
+  for (unsigned i = m_bm->getNumVariables(); i != 0; --i) {
+    if (auto globalVar = dyn_cast_or_null<GlobalVariable>(getTranslatedValue(m_bm->getVariable(i - 1))))
+      globalList.splice(globalList.begin(), globalList, globalVar->getIterator());
   }
 
   if (!transMetadata())
@@ -8116,17 +8205,28 @@ llvm::GlobalValue::LinkageTypes SPIRVToLLVM::transLinkageType(const SPIRVValue *
 
 } // namespace SPIRV
 
+std::shared_ptr<SPIRVModule> llvm::parseSpirv(std::istream &is) {
+  std::shared_ptr<SPIRVModule> bm(SPIRVModule::createSPIRVModule());
+  is >> *bm;
+  return bm;
+}
+
 bool llvm::readSpirv(Builder *builder, const ShaderModuleUsage *shaderInfo, const PipelineShaderOptions *shaderOptions,
                      std::istream &is, spv::ExecutionModel entryExecModel, const char *entryName,
                      const SPIRVSpecConstMap &specConstMap, ArrayRef<ConvertingSampler> convertingSamplers, Module *m,
                      std::string &errMsg) {
-  assert(entryExecModel != ExecutionModelKernel && "Not support ExecutionModelKernel");
-
-  std::unique_ptr<SPIRVModule> bm(SPIRVModule::createSPIRVModule());
+  std::shared_ptr<SPIRVModule> bm = parseSpirv(is);
+  return readSpirv(builder, shaderInfo, shaderOptions, bm.get(), entryExecModel, entryName, specConstMap, false,
+                   convertingSamplers, m, errMsg);
+}
 
-  is >> *bm;
+bool llvm::readSpirv(Builder *builder, const ShaderModuleUsage *shaderInfo, const PipelineShaderOptions *shaderOptions,
+                     SPIRVModule *bm, spv::ExecutionModel entryExecModel, const char *entryName,
+                     const SPIRVSpecConstMap &specConstMap, bool symbolicSpecConsts,
+                     ArrayRef<ConvertingSampler> convertingSamplers, Module *m, std::string &errMsg) {
+  assert(entryExecModel != ExecutionModelKernel && "Not support ExecutionModelKernel");
 
-  SPIRVToLLVM btl(m, bm.get(), specConstMap, convertingSamplers, builder, shaderInfo, shaderOptions);
+  SPIRVToLLVM btl(m, bm, specConstMap, symbolicSpecConsts, convertingSamplers, builder, shaderInfo, shaderOptions);
   bool succeed = true;
   if (!btl.translate(entryExecModel, entryName)) {
     bm->getError(errMsg);
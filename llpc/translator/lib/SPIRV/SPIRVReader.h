@@ -69,7 +69,7 @@ class SPIRVToLLVMDbgTran;
 class SPIRVToLLVM {
 public:
   SPIRVToLLVM(Module *llvmModule, SPIRVModule *theSpirvModule, const SPIRVSpecConstMap &theSpecConstMap,
-              llvm::ArrayRef<ConvertingSampler> convertingSamplers, lgc::Builder *builder,
+              bool symbolicSpecConsts, llvm::ArrayRef<ConvertingSampler> convertingSamplers, lgc::Builder *builder,
               const Vkgc::ShaderModuleUsage *moduleUsage, const Vkgc::PipelineShaderOptions *shaderOptions);
 
   DebugLoc getDebugLoc(SPIRVInstruction *bi, Function *f);
@@ -89,6 +89,7 @@ public:
   Value *transValueWithoutDecoration(SPIRVValue *, Function *f, BasicBlock *, bool createPlaceHolder = true);
   Value *transAtomicRMW(SPIRVValue *, const AtomicRMWInst::BinOp);
   Constant *transInitializer(SPIRVValue *, Type *);
+  Constant *transSymbolicSpecConst(SPIRVValue *bv, Type *ty, uint64_t defaultValue);
   template <spv::Op> Value *transValueWithOpcode(SPIRVValue *);
   Value *transLoadImage(SPIRVValue *spvImageLoadPtr);
   Value *loadImageSampler(Type *elementTy, Value *base);
@@ -198,11 +199,15 @@ private:
   LLVMContext *m_context;
   lgc::Builder *m_builder;
   SPIRVModule *m_bm;
+  // Specialization of m_bm for this translation; m_bm itself is not modified, so it can be shared.
+  SPIRVSpecConstOverlay m_specConstOverlay;
   bool m_enableXfb;
   bool m_enableGatherLodNz;
   ShaderFloatControlFlags m_fpControlFlags;
   SPIRVFunction *m_entryTarget;
   const SPIRVSpecConstMap &m_specConstMap;
+  // Whether specialization constants are kept symbolic, to be specialized after translation
+  bool m_symbolicSpecConsts;
   llvm::ArrayRef<ConvertingSampler> m_convertingSamplers;
   SPIRVToLLVMTypeMap m_typeMap;
   SPIRVToLLVMValueMap m_valueMap;
@@ -216,6 +221,7 @@ private:
   DenseMap<Type *, uint64_t> m_typeToStoreSize;
   DenseMap<std::pair<SPIRVType *, unsigned>, Type *> m_overlappingStructTypeWorkaroundMap;
   DenseMap<std::pair<BasicBlock *, BasicBlock *>, unsigned> m_blockPredecessorToCount;
+  DenseMap<SPIRVBasicBlock *, SPIRVLoopMerge *> m_continueTargetToLoopMerge;
   const Vkgc::ShaderModuleUsage *m_moduleUsage;
   const Vkgc::PipelineShaderOptions *m_shaderOptions;
   unsigned m_spirvOpMetaKindId;
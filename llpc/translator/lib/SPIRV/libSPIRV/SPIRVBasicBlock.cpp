@@ -49,7 +49,7 @@
 using namespace SPIRV;
 
 SPIRVBasicBlock::SPIRVBasicBlock(SPIRVId TheId, SPIRVFunction *Func)
-  :SPIRVValue(Func->getModule(), 2, OpLabel, TheId), ParentF(Func), LoopMerge(NULL) {
+  :SPIRVValue(Func->getModule(), 2, OpLabel, TheId), ParentF(Func) {
   setAttr();
   validate();
 }
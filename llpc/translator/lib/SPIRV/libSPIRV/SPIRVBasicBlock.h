@@ -47,14 +47,13 @@ namespace SPIRV {
 class SPIRVFunction;
 class SPIRVInstruction;
 class SPIRVDecoder;
-class SPIRVLoopMerge;
 
 class SPIRVBasicBlock: public SPIRVValue {
 
 public:
   SPIRVBasicBlock(SPIRVId TheId, SPIRVFunction *Func);
 
-  SPIRVBasicBlock():SPIRVValue(OpLabel), ParentF(NULL), LoopMerge(NULL){
+  SPIRVBasicBlock():SPIRVValue(OpLabel), ParentF(NULL){
     setAttr();
   }
 
@@ -94,13 +93,10 @@ public:
     assert(ParentF && "Invalid parent function");
   }
 
-  void setLoopMerge(SPIRVLoopMerge *LM) { LoopMerge = LM; }
-  SPIRVLoopMerge *getLoopMerge() { return LoopMerge; }
 private:
   SPIRVFunction *ParentF;
   typedef std::vector<SPIRVInstruction *> SPIRVInstructionVector;
   SPIRVInstructionVector InstVec;
-  SPIRVLoopMerge *LoopMerge;
 
   SPIRVInstructionVector::const_iterator
   find(const SPIRVInstruction *Inst) const {
@@ -2446,20 +2446,14 @@ _SPIRV_OP(FragmentFetchAMD, true, 6)
 class SPIRVSpecConstantOp : public SPIRVInstTemplate<SPIRVInstTemplateBase,
   OpSpecConstantOp, true, 4, true, 0> {
 public:
-  SPIRVSpecConstantOp()
-      : MappedConst(nullptr) {}
+  // NOTE: Mapped constant is the value of OpSpecConstantOp after evaluation
+  // by constant folding. It is kept in the SPIRVSpecConstOverlay of the
+  // translation, as it depends on the specialization info.
   SPIRVValue *getMappedConstant() const {
+    SPIRVValue *MappedConst = getOverlaidMappedConstant(this);
     assert(MappedConst != nullptr && "OpSpecConstantOp not mapped");
     return MappedConst;
   }
-  void mapToConstant(SPIRVValue *Const) {
-    assert(!MappedConst && "OpSpecConstantOp mapped twice");
-    MappedConst = Const;
-  }
-protected:
-  // NOTE: Mapped constant stores the value of OpSpecConstantOp after
-  // evaluation by constant folding.
-  SPIRVValue *MappedConst;
 };
 
 #define _SPIRV_OP(x, ...) \
@@ -80,9 +80,13 @@ public:
   bool hasDebugInfo() const override { return CurrentLine.get() || !StringVec.empty() || !DebugInstVec.empty(); }
 
   // Error handling functions
-  SPIRVErrorLog &getErrorLog() override { return ErrLog; }
+  SPIRVErrorLog &getErrorLog() override {
+    if (auto Overlay = SPIRVSpecConstOverlay::getActive(this))
+      return Overlay->getErrorLog();
+    return ErrLog;
+  }
   SPIRVErrorCode getError(std::string &ErrMsg) override {
-    return ErrLog.getError(ErrMsg);
+    return getErrorLog().getError(ErrMsg);
   }
 
   // Module query functions
@@ -148,6 +152,7 @@ public:
   unsigned short getGeneratorId() const override { return GeneratorId; }
   unsigned short getGeneratorVer() const override { return GeneratorVer; }
   SPIRVWord getSPIRVVersion() const override { return SPIRVVersion; }
+  SPIRVId getIdBound() const override { return NextId; }
   const std::vector<SPIRVExtInst *> &getDebugInstVec() const override { return DebugInstVec; }
   bool isNonSemanticInfoInstSet(llvm::StringRef setName) const;
 
@@ -495,12 +500,14 @@ void SPIRVModuleImpl::addCapabilityInternal(SPIRVCapabilityKind Cap) {
 }
 
 SPIRVConstant *SPIRVModuleImpl::getLiteralAsConstant(unsigned Literal) {
-  auto Loc = LiteralMap.find(Literal);
-  if (Loc != LiteralMap.end())
+  auto Overlay = SPIRVSpecConstOverlay::getActive(this);
+  auto &Literals = Overlay ? Overlay->getLiteralMap() : LiteralMap;
+  auto Loc = Literals.find(Literal);
+  if (Loc != Literals.end())
     return Loc->second;
   auto Ty = addIntegerType(32);
   auto V = new SPIRVConstant(this, Ty, getId(), static_cast<uint64_t>(Literal));
-  LiteralMap[Literal] = V;
+  Literals[Literal] = V;
   addConstant(V);
   return V;
 }
@@ -543,6 +550,8 @@ void SPIRVModuleImpl::layoutEntry(SPIRVEntry *E) {
 // logic layout of SPIRV.
 SPIRVEntry *SPIRVModuleImpl::addEntry(SPIRVEntry *Entry) {
   assert(Entry && "Invalid entry");
+  if (auto Overlay = SPIRVSpecConstOverlay::getActive(this))
+    return Overlay->addEntry(Entry);
   if (Entry->hasId()) {
     SPIRVId Id = Entry->getId();
     assert(Entry->getId() != SPIRVID_INVALID && "Invalid id");
@@ -585,8 +594,10 @@ bool SPIRVModuleImpl::exist(SPIRVId Id) const { return exist(Id, nullptr); }
 bool SPIRVModuleImpl::exist(SPIRVId Id, SPIRVEntry **Entry) const {
   assert(Id != SPIRVID_INVALID && "Invalid Id");
   SPIRVIdToEntryMap::const_iterator Loc = IdEntryMap.find(Id);
-  if (Loc == IdEntryMap.end())
-    return false;
+  if (Loc == IdEntryMap.end()) {
+    auto Overlay = SPIRVSpecConstOverlay::getActive(this);
+    return Overlay && Overlay->exist(Id, Entry);
+  }
   if (Entry)
     *Entry = Loc->second;
   return true;
@@ -595,9 +606,11 @@ bool SPIRVModuleImpl::exist(SPIRVId Id, SPIRVEntry **Entry) const {
 // If Id is invalid, returns the next available id.
 // Otherwise returns the given id and adjust the next available id by increment.
 SPIRVId SPIRVModuleImpl::getId(SPIRVId Id, unsigned Increment) {
-  if (!isValidId(Id))
+  if (!isValidId(Id)) {
+    if (auto Overlay = SPIRVSpecConstOverlay::getActive(this))
+      return Overlay->allocateId(Increment);
     Id = NextId;
-  else
+  } else
     NextId = std::max(Id, NextId);
   NextId += Increment;
   return Id;
@@ -606,6 +619,12 @@ SPIRVId SPIRVModuleImpl::getId(SPIRVId Id, unsigned Increment) {
 SPIRVEntry *SPIRVModuleImpl::getEntry(SPIRVId Id) const {
   assert(Id != SPIRVID_INVALID && "Invalid Id");
   SPIRVIdToEntryMap::const_iterator Loc = IdEntryMap.find(Id);
+  if (Loc == IdEntryMap.end()) {
+    SPIRVEntry *Entry = nullptr;
+    auto Overlay = SPIRVSpecConstOverlay::getActive(this);
+    if (Overlay && Overlay->exist(Id, &Entry))
+      return Entry;
+  }
   assert(Loc != IdEntryMap.end() && "Id is not in map");
   return Loc->second;
 }
@@ -719,11 +738,13 @@ SPIRVTypeBool *SPIRVModuleImpl::addBoolType() {
 }
 
 SPIRVTypeInt *SPIRVModuleImpl::addIntegerType(unsigned BitWidth) {
-  auto Loc = IntTypeMap.find(BitWidth);
-  if (Loc != IntTypeMap.end())
+  auto Overlay = SPIRVSpecConstOverlay::getActive(this);
+  auto &IntTypes = Overlay ? Overlay->getIntTypeMap() : IntTypeMap;
+  auto Loc = IntTypes.find(BitWidth);
+  if (Loc != IntTypes.end())
     return Loc->second;
   auto Ty = new SPIRVTypeInt(this, getId(), BitWidth, false);
-  IntTypeMap[BitWidth] = Ty;
+  IntTypes[BitWidth] = Ty;
   return addType(Ty);
 }
 
@@ -1293,6 +1314,65 @@ std::istream &operator>>(std::istream &I, SPIRVModule &M) {
 
 SPIRVModule *SPIRVModule::createSPIRVModule() { return new SPIRVModuleImpl; }
 
+thread_local SPIRVSpecConstOverlay *SPIRVSpecConstOverlay::Active = nullptr;
+
+SPIRVSpecConstOverlay::SPIRVSpecConstOverlay(SPIRVModule *M)
+    : M(M), Previous(Active), NextId(M->getIdBound()) {
+  Active = this;
+}
+
+SPIRVSpecConstOverlay::~SPIRVSpecConstOverlay() {
+  assert(Active == this && "Overlays must be destroyed in reverse order");
+  Active = Previous;
+  for (auto I : IdEntryMap)
+    delete I.second;
+}
+
+bool SPIRVSpecConstOverlay::getSpecConstValue(const SPIRVValue *SpecConst,
+                                              uint64_t &Value) const {
+  auto Loc = SpecConstValues.find(SpecConst);
+  if (Loc == SpecConstValues.end())
+    return false;
+  Value = Loc->second;
+  return true;
+}
+
+SPIRVValue *
+SPIRVSpecConstOverlay::getMappedConstant(const SPIRVValue *SpecConstOp) const {
+  auto Loc = MappedConstants.find(SpecConstOp);
+  return Loc != MappedConstants.end() ? Loc->second : nullptr;
+}
+
+// Only constants and their types are created while an overlay is active, so
+// unlike SPIRVModuleImpl::addEntry this does not have to resolve forwards or
+// add capabilities.
+SPIRVEntry *SPIRVSpecConstOverlay::addEntry(SPIRVEntry *Entry) {
+  assert(Entry && Entry->hasId() && "Invalid entry");
+  assert(Entry->getModule() == M && "Entry belongs to another module");
+  assert(!IdEntryMap.count(Entry->getId()) && "Id used twice");
+  IdEntryMap[Entry->getId()] = Entry;
+  return Entry;
+}
+
+bool SPIRVSpecConstOverlay::exist(SPIRVId Id, SPIRVEntry **Entry) const {
+  auto Loc = IdEntryMap.find(Id);
+  if (Loc == IdEntryMap.end())
+    return false;
+  if (Entry)
+    *Entry = Loc->second;
+  return true;
+}
+
+bool getOverlaidSpecConstValue(const SPIRVValue *SpecConst, uint64_t &Value) {
+  auto Overlay = SPIRVSpecConstOverlay::getActive(SpecConst->getModule());
+  return Overlay && Overlay->getSpecConstValue(SpecConst, Value);
+}
+
+SPIRVValue *getOverlaidMappedConstant(const SPIRVValue *SpecConstOp) {
+  auto Overlay = SPIRVSpecConstOverlay::getActive(SpecConstOp->getModule());
+  return Overlay ? Overlay->getMappedConstant(SpecConstOp) : nullptr;
+}
+
 SPIRVValue *SPIRVModuleImpl::getValue(SPIRVId TheId) const {
   return get<SPIRVValue>(TheId);
 }
@@ -43,6 +43,7 @@
 #include "SPIRVEntry.h"
 
 #include <iostream>
+#include <map>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -140,6 +141,7 @@ public:
   virtual unsigned short getGeneratorId() const = 0;
   virtual unsigned short getGeneratorVer() const = 0;
   virtual SPIRVWord getSPIRVVersion() const = 0;
+  virtual SPIRVId getIdBound() const = 0;
 
   virtual const std::vector<SPIRVExtInst *> &getDebugInstVec() const = 0;
 
@@ -350,6 +352,61 @@ protected:
   bool ValidateCapability;
 };
 
+// Per-translation state layered over a parsed module, so that one parsed
+// module can be shared by concurrent translations without being modified.
+// It holds the values given to specialization constants, the constants that
+// OpSpecConstantOp instructions fold to, and the entries created by folding.
+// While an overlay is alive, the module on the same thread reads those values
+// from it and adds new entries to it instead of to itself.
+class SPIRVSpecConstOverlay {
+public:
+  explicit SPIRVSpecConstOverlay(SPIRVModule *M);
+  ~SPIRVSpecConstOverlay();
+  SPIRVSpecConstOverlay(const SPIRVSpecConstOverlay &) = delete;
+  SPIRVSpecConstOverlay &operator=(const SPIRVSpecConstOverlay &) = delete;
+
+  // Returns the overlay active on this thread for module M, if any.
+  static SPIRVSpecConstOverlay *getActive(const SPIRVModule *M) {
+    return Active && Active->M == M ? Active : nullptr;
+  }
+
+  void setSpecConstValue(const SPIRVValue *SpecConst, uint64_t Value) {
+    SpecConstValues[SpecConst] = Value;
+  }
+  bool getSpecConstValue(const SPIRVValue *SpecConst, uint64_t &Value) const;
+  void mapSpecConstantOp(const SPIRVValue *SpecConstOp, SPIRVValue *Const) {
+    assert(!MappedConstants.count(SpecConstOp) &&
+           "OpSpecConstantOp mapped twice");
+    MappedConstants[SpecConstOp] = Const;
+  }
+  SPIRVValue *getMappedConstant(const SPIRVValue *SpecConstOp) const;
+
+  // Functions used by the module to keep new entries out of itself.
+  SPIRVId allocateId(unsigned Increment) {
+    SPIRVId Id = NextId;
+    NextId += Increment;
+    return Id;
+  }
+  SPIRVEntry *addEntry(SPIRVEntry *Entry);
+  bool exist(SPIRVId Id, SPIRVEntry **Entry) const;
+  std::map<unsigned, SPIRVTypeInt *> &getIntTypeMap() { return IntTypeMap; }
+  std::map<unsigned, SPIRVConstant *> &getLiteralMap() { return LiteralMap; }
+  SPIRVErrorLog &getErrorLog() { return ErrLog; }
+
+private:
+  SPIRVModule *M;
+  SPIRVSpecConstOverlay *Previous;
+  SPIRVId NextId;
+  std::unordered_map<SPIRVId, SPIRVEntry *> IdEntryMap;
+  std::unordered_map<const SPIRVValue *, uint64_t> SpecConstValues;
+  std::unordered_map<const SPIRVValue *, SPIRVValue *> MappedConstants;
+  std::map<unsigned, SPIRVTypeInt *> IntTypeMap;
+  std::map<unsigned, SPIRVConstant *> LiteralMap;
+  SPIRVErrorLog ErrLog;
+
+  static thread_local SPIRVSpecConstOverlay *Active;
+};
+
 } // namespace SPIRV
 
 #endif
@@ -124,6 +124,12 @@ protected:
   SPIRVType *Type; // Value Type
 };
 
+// Look up the value given to a specialization constant, and the constant an
+// OpSpecConstantOp folds to, in the SPIRVSpecConstOverlay active on this
+// thread for the value's module.
+bool getOverlaidSpecConstValue(const SPIRVValue *SpecConst, uint64_t &Value);
+SPIRVValue *getOverlaidMappedConstant(const SPIRVValue *SpecConstOp);
+
 class SPIRVConstant : public SPIRVValue {
 public:
   // Complete constructor for integer constant
@@ -152,10 +158,9 @@ public:
   }
   // Incomplete constructor
   SPIRVConstant() : SPIRVValue(OpConstant), NumWords(0) {}
-  uint64_t getZExtIntValue() const { return Union.UInt64Val; }
-  float getFloatValue() const { return Union.FloatVal; }
-  double getDoubleValue() const { return Union.DoubleVal; }
-  void setZExtIntValue(uint64_t TheValue) { Union.UInt64Val = TheValue;}
+  uint64_t getZExtIntValue() const { return getUnion().UInt64Val; }
+  float getFloatValue() const { return getUnion().FloatVal; }
+  double getDoubleValue() const { return getUnion().DoubleVal; }
 protected:
   void recalculateWordCount() {
     NumWords = Type->getBitWidth() / 32;
@@ -185,6 +190,14 @@ protected:
     SPIRVWord Words[2];
     UnionType() { UInt64Val = 0; }
   } Union;
+
+  // The specialized value of OpSpecConstant lives in the overlay, not here.
+  UnionType getUnion() const {
+    UnionType Value = Union;
+    if (OpCode == OpSpecConstant)
+      getOverlaidSpecConstValue(this, Value.UInt64Val);
+    return Value;
+  }
 };
 
 template <Op OC> class SPIRVConstantEmpty : public SPIRVValue {
@@ -213,8 +226,16 @@ public:
   SPIRVConstantBool() {
     BoolVal = (OC == OpConstantTrue || OC == OpSpecConstantTrue);
   }
-  bool getBoolValue() const { return BoolVal;}
-  void setBoolValue(bool TheValue) { BoolVal = TheValue;}
+  bool getBoolValue() const {
+    // NOTE: Check the runtime op code, as callers may cast any boolean
+    // constant to SPIRVConstantTrue.
+    uint64_t Value = 0;
+    if ((this->OpCode == OpSpecConstantTrue ||
+         this->OpCode == OpSpecConstantFalse) &&
+        getOverlaidSpecConstValue(this, Value))
+      return Value != 0;
+    return BoolVal;
+  }
 protected:
   void validate() const override {
     SPIRVConstantEmpty<OC>::validate();
@@ -0,0 +1,445 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcCache.cpp
+ * @brief LLPC source file: contains implementation of class Llpc::Cache.
+ ***********************************************************************************************************************
+ */
+#include "llpcCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#define DEBUG_TYPE "llpc-cache"
+
+using namespace llvm;
+using Vkgc::EntryHandle;
+using Vkgc::HashId;
+using Vkgc::RawEntryHandle;
+
+namespace Llpc {
+
+// Magic number at the start of a cache file
+static const char CacheFileMagic[8] = {'L', 'L', 'P', 'C', 'C', 'A', 'C', 'H'};
+
+// Version of the cache file format, bumped whenever the format changes incompatibly
+static const unsigned CacheFileVersion = 2;
+
+// Header of a cache file. The values follow it, each with a CacheFileEntryHeader. The file is only valid for the build
+// of LLPC that wrote it, as a build with different code generation may produce different ELF for the same hash, and
+// for the graphics IP version and compilation options it was written with.
+struct CacheFileHeader {
+  char magic[sizeof(CacheFileMagic)]; // Magic number, CacheFileMagic
+  unsigned version;                   // Version of the file format, CacheFileVersion
+  unsigned interfaceVersion;          // LLPC interface major version
+  char buildDate[12];                 // Date LLPC was built, from __DATE__
+  char buildTime[12];                 // Time LLPC was built, from __TIME__
+  unsigned gfxIp[3];                  // Graphics IP version: major, minor, stepping
+  uint8_t optionHash[16];             // Hash code of the compilation options
+  uint64_t entryCount;                // Number of values in the file
+};
+
+// Header of a value in a cache file
+struct CacheFileEntryHeader {
+  HashId hash;       // Hash key of the entry
+  uint64_t dataLen;  // Size of the value
+  uint64_t checksum; // xxHash64 of the value, so that a truncated or corrupt file is rejected
+};
+
+// =====================================================================================================================
+// Fills in the header of a cache file written by this build of LLPC, apart from the entry count.
+//
+// @param [out] header : Header to fill in
+// @param gfxIp : Graphics IP version the cached values are compiled for
+// @param optionHash : Hash code of the compilation options the cached values are compiled with
+static void initCacheFileHeader(CacheFileHeader *header, const GfxIpVersion &gfxIp, const MetroHash::Hash &optionHash) {
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, CacheFileMagic, sizeof(CacheFileMagic));
+  header->version = CacheFileVersion;
+  header->interfaceVersion = LLPC_INTERFACE_MAJOR_VERSION;
+  memcpy(header->buildDate, __DATE__, std::min(strlen(__DATE__), sizeof(header->buildDate)));
+  memcpy(header->buildTime, __TIME__, std::min(strlen(__TIME__), sizeof(header->buildTime)));
+  header->gfxIp[0] = gfxIp.major;
+  header->gfxIp[1] = gfxIp.minor;
+  header->gfxIp[2] = gfxIp.stepping;
+  static_assert(sizeof(header->optionHash) == sizeof(optionHash.bytes), "Unexpected option hash size");
+  memcpy(header->optionHash, optionHash.bytes, sizeof(header->optionHash));
+}
+
+// =====================================================================================================================
+Cache::Cache() : m_shardBudget(0), m_gfxIp(), m_optionHash() {
+}
+
+// =====================================================================================================================
+// Saves the cache if it has a file, and frees all the entries. There must be no handle to any entry left.
+Cache::~Cache() {
+  if (!m_fileName.empty())
+    save();
+
+  for (Shard &shard : m_shards) {
+    for (auto &mapEntry : shard.entries) {
+      assert(mapEntry.second->refCount == 0 && "Cache destroyed with an entry still in use");
+      delete mapEntry.second;
+    }
+  }
+}
+
+// =====================================================================================================================
+// Initializes the cache, loading it from its file if it has one and the file exists.
+//
+// @param createInfo : Options of the cache
+// @returns : Success, or an error if the file exists but could not be loaded; the cache is then empty but usable
+Result Cache::init(const CacheCreateInfo *createInfo) {
+  if (createInfo->memoryBudget != 0)
+    m_shardBudget = std::max<size_t>(createInfo->memoryBudget / ShardCount, 1);
+  if (createInfo->fileName)
+    m_fileName = createInfo->fileName;
+  m_gfxIp = createInfo->gfxIp;
+  m_optionHash = createInfo->optionHash;
+
+  if (m_fileName.empty())
+    return Result::Success;
+  return load();
+}
+
+// =====================================================================================================================
+// Gets the total size of the values held in the cache.
+size_t Cache::getTotalSize() {
+  size_t totalSize = 0;
+  for (Shard &shard : m_shards) {
+    std::lock_guard<std::mutex> guard(shard.lock);
+    totalSize += shard.totalSize;
+  }
+  return totalSize;
+}
+
+// =====================================================================================================================
+// Obtains a cache entry for the hash. A found entry is counted as recently used.
+//
+// @param hash : The hash key for the cache entry
+// @param allocateOnMiss : If true, a new cache entry will be allocated when none is found
+// @param [out] pHandle : Handle to the cache entry on Success, NotReady, and NotFound if allocateOnMiss
+Result Cache::GetEntry(HashId hash, bool allocateOnMiss, EntryHandle *pHandle) {
+  if (!pHandle)
+    return Result::ErrorInvalidPointer;
+
+  Shard &shard = getShard(hash);
+  std::lock_guard<std::mutex> guard(shard.lock);
+
+  auto it = shard.entries.find(hash);
+  if (it != shard.entries.end()) {
+    Entry *entry = it->second;
+    ++entry->refCount;
+    *pHandle = EntryHandle(this, entry, false);
+    if (entry->state == EntryState::Pending)
+      return Result::NotReady;
+
+    shard.lru.splice(shard.lru.end(), shard.lru, entry->lruPosition);
+    return Result::Success;
+  }
+
+  if (!allocateOnMiss)
+    return Result::NotFound;
+
+  Entry *entry = new Entry();
+  entry->hash = hash;
+  entry->shard = &shard;
+  entry->state = EntryState::Pending;
+  entry->refCount = 1;
+  entry->dataLen = 0;
+  entry->lruPosition = shard.lru.end();
+  shard.entries[hash] = entry;
+  *pHandle = EntryHandle(this, entry, true);
+  return Result::NotFound;
+}
+
+// =====================================================================================================================
+// Releases a handle to a cache entry. The last release of a failed entry frees it, and the last release of a ready
+// entry makes it a candidate for eviction.
+//
+// @param rawHandle : The handle to the cache entry to be released
+void Cache::ReleaseEntry(RawEntryHandle rawHandle) {
+  Entry *entry = static_cast<Entry *>(rawHandle);
+  Shard &shard = *entry->shard;
+  std::lock_guard<std::mutex> guard(shard.lock);
+
+  assert(entry->refCount > 0);
+  assert((entry->state != EntryState::Pending || entry->refCount > 1) &&
+         "Cache entry released by its creator without SetValue");
+  if (--entry->refCount != 0)
+    return;
+
+  if (entry->state == EntryState::Failed)
+    delete entry;
+  else
+    evict(shard);
+}
+
+// =====================================================================================================================
+// Waits for a pending cache entry to be populated by its creator.
+//
+// @param rawHandle : The handle to the cache entry
+// @returns : Success if the entry is ready, or ErrorUnknown if its creator failed to populate it
+Result Cache::WaitForEntry(RawEntryHandle rawHandle) {
+  Entry *entry = static_cast<Entry *>(rawHandle);
+  Shard &shard = *entry->shard;
+  std::unique_lock<std::mutex> guard(shard.lock);
+
+  shard.entryPopulated.wait(guard, [entry] { return entry->state != EntryState::Pending; });
+  return entry->state == EntryState::Ready ? Result::Success : Result::ErrorUnknown;
+}
+
+// =====================================================================================================================
+// Copies the value of a cache entry.
+//
+// @param rawHandle : The handle to the cache entry
+// @param [out] pData : If non-null, up to *pDataLen bytes of the value are copied here
+// @param [in/out] pDataLen : Space available at pData on input, size of the value on output
+Result Cache::GetValue(RawEntryHandle rawHandle, void *pData, size_t *pDataLen) {
+  const void *data = nullptr;
+  size_t dataLen = 0;
+  Result result = GetValueZeroCopy(rawHandle, &data, &dataLen);
+  if (result != Result::Success)
+    return result;
+
+  if (pData)
+    memcpy(pData, data, std::min(*pDataLen, dataLen));
+  *pDataLen = dataLen;
+  return Result::Success;
+}
+
+// =====================================================================================================================
+// Gets a pointer to the value of a cache entry. The value of a ready entry does not change, and is not freed while the
+// handle is held, so the pointer stays valid without the lock.
+//
+// @param rawHandle : The handle to the cache entry
+// @param [out] ppData : Pointer to the value
+// @param [out] pDataLen : Size of the value
+Result Cache::GetValueZeroCopy(RawEntryHandle rawHandle, const void **ppData, size_t *pDataLen) {
+  Entry *entry = static_cast<Entry *>(rawHandle);
+  {
+    std::lock_guard<std::mutex> guard(entry->shard->lock);
+    if (entry->state == EntryState::Pending)
+      return Result::NotReady;
+    if (entry->state == EntryState::Failed)
+      return Result::ErrorUnknown;
+  }
+
+  *ppData = entry->data.get();
+  *pDataLen = entry->dataLen;
+  return Result::Success;
+}
+
+// =====================================================================================================================
+// Populates a cache entry allocated by GetEntry, and wakes up any thread waiting for it. On failure, the entry is
+// removed from the cache so that a later lookup allocates it again.
+//
+// @param rawHandle : The handle to the cache entry
+// @param success : Whether computing the value was successful
+// @param pData : The value
+// @param dataLen : Size of the value
+Result Cache::SetValue(RawEntryHandle rawHandle, bool success, const void *pData, size_t dataLen) {
+  Entry *entry = static_cast<Entry *>(rawHandle);
+  Shard &shard = *entry->shard;
+
+  // Copy the value before taking the lock.
+  std::unique_ptr<uint8_t[]> data;
+  if (success) {
+    data.reset(new uint8_t[dataLen]);
+    memcpy(data.get(), pData, dataLen);
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(shard.lock);
+    assert(entry->state == EntryState::Pending);
+    if (success) {
+      makeReady(entry, std::move(data), dataLen);
+      evict(shard);
+    } else {
+      entry->state = EntryState::Failed;
+      shard.entries.erase(entry->hash);
+    }
+  }
+  shard.entryPopulated.notify_all();
+  return Result::Success;
+}
+
+// =====================================================================================================================
+// Makes an entry ready with its value, as the most recently used entry of its shard. The shard lock must be held.
+//
+// @param entry : The entry
+// @param data : The value
+// @param dataLen : Size of the value
+void Cache::makeReady(Entry *entry, std::unique_ptr<uint8_t[]> data, size_t dataLen) {
+  Shard &shard = *entry->shard;
+  entry->data = std::move(data);
+  entry->dataLen = dataLen;
+  entry->state = EntryState::Ready;
+  entry->lruPosition = shard.lru.insert(shard.lru.end(), entry);
+  shard.totalSize += dataLen;
+}
+
+// =====================================================================================================================
+// Evicts the least recently used entries of a shard that have no handle, until it is within its budget. The shard lock
+// must be held.
+//
+// @param shard : The shard
+void Cache::evict(Shard &shard) {
+  if (m_shardBudget == 0)
+    return;
+
+  for (auto it = shard.lru.begin(); it != shard.lru.end() && shard.totalSize > m_shardBudget;) {
+    Entry *entry = *it;
+    if (entry->refCount != 0) {
+      ++it;
+      continue;
+    }
+    LLVM_DEBUG(dbgs() << "Evicting cache entry of " << entry->dataLen << " bytes\n");
+    it = shard.lru.erase(it);
+    shard.totalSize -= entry->dataLen;
+    shard.entries.erase(entry->hash);
+    delete entry;
+  }
+}
+
+// =====================================================================================================================
+// Saves the ready entries of the cache to its file. The file is written under a temporary name and then renamed, so
+// that a concurrent load never sees a partial file; of two processes saving at once, the last to finish wins.
+Result Cache::save() {
+  if (m_fileName.empty())
+    return Result::Success;
+
+  int fd = -1;
+  SmallString<256> tempName;
+  if (sys::fs::createUniqueFile(m_fileName + "-%%%%%%.tmp", fd, tempName))
+    return Result::ErrorUnavailable;
+
+  bool writeError = false;
+  {
+    raw_fd_ostream out(fd, /*shouldClose=*/true);
+    CacheFileHeader header;
+    initCacheFileHeader(&header, m_gfxIp, m_optionHash);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for (Shard &shard : m_shards) {
+      std::lock_guard<std::mutex> guard(shard.lock);
+      for (const Entry *entry : shard.lru) {
+        CacheFileEntryHeader entryHeader = {};
+        entryHeader.hash = entry->hash;
+        entryHeader.dataLen = entry->dataLen;
+        entryHeader.checksum = xxHash64(StringRef(reinterpret_cast<const char *>(entry->data.get()), entry->dataLen));
+        out.write(reinterpret_cast<const char *>(&entryHeader), sizeof(entryHeader));
+        out.write(reinterpret_cast<const char *>(entry->data.get()), entry->dataLen);
+        ++header.entryCount;
+      }
+    }
+
+    out.seek(offsetof(CacheFileHeader, entryCount));
+    out.write(reinterpret_cast<const char *>(&header.entryCount), sizeof(header.entryCount));
+    out.close();
+    writeError = out.has_error();
+    out.clear_error();
+  }
+
+  if (writeError || sys::fs::rename(tempName, m_fileName)) {
+    sys::fs::remove(tempName);
+    return Result::ErrorUnavailable;
+  }
+  return Result::Success;
+}
+
+// =====================================================================================================================
+// Loads the cache from its file. A missing file is not an error. A file written by another build of LLPC or for another
+// graphics IP version or set of options, or a file that is truncated or corrupt, is rejected as a whole.
+Result Cache::load() {
+  auto bufferOrErr = MemoryBuffer::getFile(m_fileName, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (!bufferOrErr) {
+    if (bufferOrErr.getError() == std::errc::no_such_file_or_directory)
+      return Result::Success;
+    return Result::ErrorUnavailable;
+  }
+
+  StringRef contents = (*bufferOrErr)->getBuffer();
+  CacheFileHeader expectedHeader;
+  initCacheFileHeader(&expectedHeader, m_gfxIp, m_optionHash);
+  CacheFileHeader header;
+  if (contents.size() < sizeof(header))
+    return Result::ErrorInvalidValue;
+  memcpy(&header, contents.data(), sizeof(header));
+  expectedHeader.entryCount = header.entryCount;
+  if (memcmp(&header, &expectedHeader, sizeof(header)) != 0) {
+    LLVM_DEBUG(dbgs() << "Cache file " << m_fileName
+                      << " is from another build of LLPC, graphics IP or set of options\n");
+    return Result::ErrorInvalidValue;
+  }
+
+  // Validate the whole file before adding anything to the cache.
+  std::vector<std::pair<CacheFileEntryHeader, const char *>> fileEntries;
+  size_t offset = sizeof(header);
+  for (uint64_t i = 0; i != header.entryCount; ++i) {
+    CacheFileEntryHeader entryHeader;
+    if (contents.size() - offset < sizeof(entryHeader))
+      return Result::ErrorInvalidValue;
+    memcpy(&entryHeader, contents.data() + offset, sizeof(entryHeader));
+    offset += sizeof(entryHeader);
+    if (contents.size() - offset < entryHeader.dataLen)
+      return Result::ErrorInvalidValue;
+    StringRef data = contents.substr(offset, entryHeader.dataLen);
+    if (xxHash64(data) != entryHeader.checksum)
+      return Result::ErrorInvalidValue;
+    offset += entryHeader.dataLen;
+    fileEntries.push_back({entryHeader, data.data()});
+  }
+
+  for (const auto &fileEntry : fileEntries) {
+    const CacheFileEntryHeader &entryHeader = fileEntry.first;
+    Shard &shard = getShard(entryHeader.hash);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    if (shard.entries.count(entryHeader.hash))
+      continue;
+
+    std::unique_ptr<uint8_t[]> data(new uint8_t[entryHeader.dataLen]);
+    memcpy(data.get(), fileEntry.second, entryHeader.dataLen);
+    Entry *entry = new Entry();
+    entry->hash = entryHeader.hash;
+    entry->shard = &shard;
+    entry->refCount = 0;
+    shard.entries[entry->hash] = entry;
+    makeReady(entry, std::move(data), entryHeader.dataLen);
+    evict(shard);
+  }
+  return Result::Success;
+}
+
+} // namespace Llpc
@@ -0,0 +1,143 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcCache.h
+ * @brief LLPC header file: contains declaration of class Llpc::Cache, LLPC's own implementation of Vkgc::ICache.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llpc.h"
+#include "vkgcMetroHash.h"
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Llpc {
+
+// Specifies the options of a Cache object.
+struct CacheCreateInfo {
+  size_t memoryBudget;        // Bytes of values the cache may hold, 0 for no limit
+  const char *fileName;       // File the cache is loaded from and saved to, nullptr or empty for no persistence
+  GfxIpVersion gfxIp;         // Graphics IP version the cached values are compiled for
+  MetroHash::Hash optionHash; // Hash code of the compilation options the cached values are compiled with
+};
+
+// =====================================================================================================================
+// An implementation of the Vkgc::ICache interface, for clients that have no cache of their own and for amdllpc.
+//
+// Entries are spread over shards by hash, each with its own lock, so lookups of different entries do not contend.
+// A handle is a pointer to the entry with a reference counted on it, and the value of a ready entry is never changed
+// or freed while it has a reference, so GetValueZeroCopy returns a pointer straight into the cache. When the cache is
+// over its memory budget, ready entries with no reference are evicted, least recently used first. If a file name is
+// given, the cache is loaded from that file by init and saved back to it by save and on destruction. The file records
+// the graphics IP version and option hash it was written with, and is rejected by init if they differ.
+//
+// An entry allocated on a miss is pending until its creator calls SetValue. Other lookups of it meanwhile get
+// NotReady, and WaitForEntry waits for it. If the creator fails to populate it, the entry is removed from the cache, so
+// a later lookup allocates it again, and the waiters get an error.
+class Cache : public Vkgc::ICache {
+public:
+  Cache();
+  virtual ~Cache();
+
+  Result init(const CacheCreateInfo *createInfo);
+  Result save();
+
+  // Get the total size of the values held in the cache.
+  size_t getTotalSize();
+
+  // Implementation of ICache
+  virtual Result GetEntry(Vkgc::HashId hash, bool allocateOnMiss, Vkgc::EntryHandle *pHandle) override;
+  virtual void ReleaseEntry(Vkgc::RawEntryHandle rawHandle) override;
+  virtual Result WaitForEntry(Vkgc::RawEntryHandle rawHandle) override;
+  virtual Result GetValue(Vkgc::RawEntryHandle rawHandle, void *pData, size_t *pDataLen) override;
+  virtual Result GetValueZeroCopy(Vkgc::RawEntryHandle rawHandle, const void **ppData, size_t *pDataLen) override;
+  virtual Result SetValue(Vkgc::RawEntryHandle rawHandle, bool success, const void *pData, size_t dataLen) override;
+
+private:
+  Cache(const Cache &) = delete;
+  Cache &operator=(const Cache &) = delete;
+
+  // Enumerates the states of a cache entry
+  enum class EntryState : unsigned {
+    Pending, // Allocated on a miss, waiting for its creator to populate it
+    Ready,   // Populated with its value
+    Failed,  // Its creator failed to populate it; it has been removed from the cache
+  };
+
+  struct Shard;
+
+  // A cache entry. Its state and reference count are protected by the lock of its shard.
+  struct Entry {
+    Vkgc::HashId hash;                        // Hash key of the entry
+    Shard *shard;                             // Shard the entry belongs to
+    EntryState state;                         // State of the entry
+    unsigned refCount;                        // Number of handles to the entry
+    std::unique_ptr<uint8_t[]> data;          // Value of a ready entry
+    size_t dataLen;                           // Size of the value of a ready entry
+    std::list<Entry *>::iterator lruPosition; // Position of a ready entry in the LRU list of its shard
+  };
+
+  // Hash function and equality of HashId, for the entry map.
+  struct HashIdHasher {
+    size_t operator()(const Vkgc::HashId &hash) const { return static_cast<size_t>(hash.qwords[0] ^ hash.qwords[1]); }
+  };
+  struct HashIdEqual {
+    bool operator()(const Vkgc::HashId &lhs, const Vkgc::HashId &rhs) const {
+      return lhs.qwords[0] == rhs.qwords[0] && lhs.qwords[1] == rhs.qwords[1];
+    }
+  };
+
+  typedef std::unordered_map<Vkgc::HashId, Entry *, HashIdHasher, HashIdEqual> EntryMap;
+
+  // A shard of the cache: the entries whose hash selects it.
+  struct Shard {
+    std::mutex lock;                        // Lock of the shard and its entries
+    std::condition_variable entryPopulated; // Signalled when a pending entry is populated or fails
+    EntryMap entries;                       // Entries in the cache
+    std::list<Entry *> lru;                 // Ready entries, least recently used first
+    size_t totalSize = 0;                   // Total size of the values of the ready entries
+  };
+
+  static constexpr unsigned ShardCount = 16;
+
+  Shard &getShard(const Vkgc::HashId &hash) { return m_shards[hash.bytes[0] % ShardCount]; }
+  void makeReady(Entry *entry, std::unique_ptr<uint8_t[]> data, size_t dataLen);
+  void evict(Shard &shard);
+  Result load();
+
+  Shard m_shards[ShardCount];   // Shards of the cache
+  size_t m_shardBudget;         // Bytes of values each shard may hold, 0 for no limit
+  std::string m_fileName;       // File the cache is loaded from and saved to, empty for no persistence
+  GfxIpVersion m_gfxIp;         // Graphics IP version the cached values are compiled for
+  MetroHash::Hash m_optionHash; // Hash code of the compilation options the cached values are compiled with
+};
+
+} // namespace Llpc
@@ -349,4 +349,143 @@ bool ShaderModuleHelper::isLlvmBitcode(const BinaryData *shaderBin) {
   return isLlvmBitcode;
 }
 
+// =====================================================================================================================
+// Checks whether the specialization constants of a SPIR-V module can be kept symbolic, so that the module can be
+// translated and lowered before its specialization is known. Every specialization constant must be a scalar
+// OpSpecConstant, OpSpecConstantTrue or OpSpecConstantFalse, and must only be used as an operand that the translator
+// takes as any value. A use in a type, a variable initializer, an OpSpecConstantOp, an OpSpecConstantComposite, a
+// built-in or an execution mode needs the value at translation time.
+//
+// NOTE: A literal operand of an instruction that is not known to take any value is checked as if it were an ID, so a
+// literal that happens to equal the ID of a specialization constant makes the check fail conservatively.
+//
+// @param spvBin : SPIR-V binary
+bool ShaderModuleHelper::canKeepSpecConstsSymbolic(const BinaryData *spvBin) {
+  const unsigned *code = reinterpret_cast<const unsigned *>(spvBin->pCode);
+  const unsigned *end = code + spvBin->codeSize / sizeof(unsigned);
+
+  // Skip SPIR-V header
+  const unsigned *codePos = code + sizeof(SpirvHeader) / sizeof(unsigned);
+
+  std::unordered_set<unsigned> specConstIds;
+  std::unordered_set<unsigned> builtInIds;
+  while (codePos < end) {
+    unsigned opCode = (codePos[0] & OpCodeMask);
+    unsigned wordCount = (codePos[0] >> WordCountShift);
+
+    if (wordCount == 0 || codePos + wordCount > end)
+      return false;
+
+    switch (opCode) {
+    case OpSpecConstantComposite:
+    case OpSpecConstantOp:
+    case OpExecutionModeId:
+      return false;
+
+    case OpSpecConstantTrue:
+    case OpSpecConstantFalse:
+    case OpSpecConstant:
+      specConstIds.insert(codePos[2]);
+      break;
+
+    case OpDecorate:
+      if (wordCount >= 3 && codePos[2] == DecorationBuiltIn)
+        builtInIds.insert(codePos[1]);
+      break;
+
+    // Instructions whose operands are names, or values the translator takes as any LLVM value
+    case OpName:
+    case OpMemberName:
+    case OpMemberDecorate:
+    case OpFunctionCall:
+    case OpExtInst:
+    case OpStore:
+    case OpAccessChain:
+    case OpInBoundsAccessChain:
+    case OpCompositeConstruct:
+    case OpCompositeInsert:
+    case OpSelect:
+    case OpPhi:
+    case OpBranchConditional:
+    case OpSwitch:
+    case OpReturnValue:
+    case OpSNegate:
+    case OpFNegate:
+    case OpIAdd:
+    case OpFAdd:
+    case OpISub:
+    case OpFSub:
+    case OpIMul:
+    case OpFMul:
+    case OpUDiv:
+    case OpSDiv:
+    case OpFDiv:
+    case OpUMod:
+    case OpSRem:
+    case OpSMod:
+    case OpFRem:
+    case OpFMod:
+    case OpVectorTimesScalar:
+    case OpShiftRightLogical:
+    case OpShiftRightArithmetic:
+    case OpShiftLeftLogical:
+    case OpBitwiseOr:
+    case OpBitwiseXor:
+    case OpBitwiseAnd:
+    case OpNot:
+    case OpLogicalEqual:
+    case OpLogicalNotEqual:
+    case OpLogicalOr:
+    case OpLogicalAnd:
+    case OpLogicalNot:
+    case OpIEqual:
+    case OpINotEqual:
+    case OpUGreaterThan:
+    case OpSGreaterThan:
+    case OpUGreaterThanEqual:
+    case OpSGreaterThanEqual:
+    case OpULessThan:
+    case OpSLessThan:
+    case OpULessThanEqual:
+    case OpSLessThanEqual:
+    case OpFOrdEqual:
+    case OpFUnordEqual:
+    case OpFOrdNotEqual:
+    case OpFUnordNotEqual:
+    case OpFOrdLessThan:
+    case OpFUnordLessThan:
+    case OpFOrdGreaterThan:
+    case OpFUnordGreaterThan:
+    case OpFOrdLessThanEqual:
+    case OpFUnordLessThanEqual:
+    case OpFOrdGreaterThanEqual:
+    case OpFUnordGreaterThanEqual:
+    case OpConvertFToU:
+    case OpConvertFToS:
+    case OpConvertSToF:
+    case OpConvertUToF:
+    case OpUConvert:
+    case OpSConvert:
+    case OpFConvert:
+    case OpBitcast:
+      break;
+
+    default:
+      for (unsigned i = 1; i < wordCount; ++i) {
+        if (specConstIds.count(codePos[i]) > 0)
+          return false;
+      }
+      break;
+    }
+
+    codePos += wordCount;
+  }
+
+  for (unsigned builtInId : builtInIds) {
+    if (specConstIds.count(builtInId) > 0)
+      return false;
+  }
+  return true;
+}
+
 } // namespace Llpc
@@ -67,6 +67,8 @@ public:
   static Result verifySpirvBinary(const BinaryData *spvBin);
 
   static bool isLlvmBitcode(const BinaryData *shaderBin);
+
+  static bool canKeepSpecConstsSymbolic(const BinaryData *spvBin);
 };
 
 } // namespace Llpc
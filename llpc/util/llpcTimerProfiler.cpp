@@ -54,6 +54,14 @@ opt<bool> EnableTimerProfile("enable-timer-profile", desc("profile the compile t
 
 namespace Llpc {
 
+PhaseTimes *TimerProfiler::m_phaseTimeSink = nullptr;
+
+// =====================================================================================================================
+// Check whether the timers are enabled, either for a timer report or for the phase time sink.
+bool TimerProfiler::isEnabled() {
+  return TimePassesIsEnabled || cl::EnableTimerProfile || m_phaseTimeSink;
+}
+
 // =====================================================================================================================
 //
 // @param hash64 : Hash code
@@ -61,7 +69,7 @@ namespace Llpc {
 // @param enableMask : Mask of enabled phase timers
 TimerProfiler::TimerProfiler(uint64_t hash64, const char *descriptionPrefix, unsigned enableMask)
     : m_total("", "", getDummyTimeRecords()), m_phases("", "", getDummyTimeRecords()) {
-  if (TimePassesIsEnabled || cl::EnableTimerProfile) {
+  if (isEnabled()) {
     std::string hashString;
     raw_string_ostream ostream(hashString);
     ostream << format("0x%016" PRIX64, hash64);
@@ -107,10 +115,23 @@ TimerProfiler::TimerProfiler(uint64_t hash64, const char *descriptionPrefix, uns
 
 // =====================================================================================================================
 TimerProfiler::~TimerProfiler() {
-  if (TimePassesIsEnabled || cl::EnableTimerProfile) {
+  if (isEnabled()) {
     // Stop whole timer
     m_wholeTimer.stopTimer();
   }
+
+  if (m_phaseTimeSink) {
+    m_phaseTimeSink->total += m_wholeTimer.getTotalTime().getWallTime();
+    for (unsigned timerKind = 0; timerKind < TimerCount; ++timerKind)
+      m_phaseTimeSink->phases[timerKind] += m_phaseTimers[timerKind].getTotalTime().getWallTime();
+
+    if (!TimePassesIsEnabled && !cl::EnableTimerProfile) {
+      // The times were only wanted by the sink, so clear the timers to stop them being printed in a timer report.
+      m_wholeTimer.clear();
+      for (Timer &phaseTimer : m_phaseTimers)
+        phaseTimer.clear();
+    }
+  }
 }
 
 // =====================================================================================================================
@@ -120,7 +141,7 @@ TimerProfiler::~TimerProfiler() {
 // @param timerKind : Kind of phase timer
 // @param start : Start or  stop timer
 void TimerProfiler::addTimerStartStopPass(lgc::PassManager *passMgr, TimerKind timerKind, bool start) {
-  if (TimePassesIsEnabled || cl::EnableTimerProfile)
+  if (isEnabled())
     passMgr->add(lgc::LgcContext::createStartStopTimer(&m_phaseTimers[timerKind], start));
 }
 
@@ -130,7 +151,7 @@ void TimerProfiler::addTimerStartStopPass(lgc::PassManager *passMgr, TimerKind t
 // @param timerKind : Kind of phase timer
 // @param start : Start or  stop timer
 void TimerProfiler::startStopTimer(TimerKind timerKind, bool start) {
-  if (TimePassesIsEnabled || cl::EnableTimerProfile) {
+  if (isEnabled()) {
     if (start)
       m_phaseTimers[timerKind].startTimer();
     else
@@ -139,11 +160,11 @@ void TimerProfiler::startStopTimer(TimerKind timerKind, bool start) {
 }
 
 // =====================================================================================================================
-// Gets a specific timer. Returns nullptr if TimePassesIsEnabled isn't enabled.
+// Gets a specific timer. Returns nullptr if the timers are not enabled.
 //
 // @param timerKind : Kind of phase timer
 Timer *TimerProfiler::getTimer(TimerKind timerKind) {
-  return TimePassesIsEnabled || cl::EnableTimerProfile ? &m_phaseTimers[timerKind] : nullptr;
+  return isEnabled() ? &m_phaseTimers[timerKind] : nullptr;
 }
 
 // =====================================================================================================================
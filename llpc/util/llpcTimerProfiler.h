@@ -56,6 +56,14 @@ enum TimerKind : unsigned {
   TimerCount
 };
 
+// =====================================================================================================================
+// Wall-clock times in seconds, accumulated over the compiles profiled while this is set as the phase time sink. This
+// is used by tools that measure compile time, such as the benchmark mode of amdllpc.
+struct PhaseTimes {
+  double total;              // Total time of the compiles
+  double phases[TimerCount]; // Time of each compilation phase
+};
+
 // =====================================================================================================================
 // Represents a utility class for time profile, it wraps LLVM Timer and TimerGroup in internal.
 class TimerProfiler {
@@ -72,6 +80,10 @@ public:
 
   static const llvm::StringMap<llvm::TimeRecord> &getDummyTimeRecords();
 
+  // Set the sink that the times of each profile are added to when it is destroyed, or nullptr to stop adding them.
+  // This is not thread safe, so it must only be set while no compile is running.
+  static void setPhaseTimeSink(PhaseTimes *sink) { m_phaseTimeSink = sink; }
+
   static const unsigned PipelineTimerEnableMask = ((1 << TimerCount) - 1);
   static const unsigned ShaderModuleTimerEnableMask = ((1 << TimerTranslate) | (1 << TimerLower));
 
@@ -79,6 +91,10 @@ private:
   TimerProfiler(const TimerProfiler &) = delete;
   TimerProfiler &operator=(const TimerProfiler &) = delete;
 
+  static bool isEnabled();
+
+  static PhaseTimes *m_phaseTimeSink; // Sink that the times of each profile are added to, or nullptr
+
   llvm::TimerGroup m_total;              // TimeGroup for total time
   llvm::TimerGroup m_phases;             // TimeGroup for each phase
   llvm::Timer m_wholeTimer;              // Whole timer
@@ -831,6 +831,10 @@ void PipelineDumper::dumpGraphicsPipelineInfo(std::ostream *dumpFile, const char
 // the portions of the pipeline build info that affect that stage will be included in the hash.  Otherwise, stage must
 // be ShaderStageInvalid, and all values in the build info will be included.
 //
+// For a relocatable shader, state that is only resolved when linking (vertex input formats, color export formats,
+// user data layout, static descriptor values and the device index) is left out, so that a pipeline differing from an
+// earlier one only in that state reuses its relocatable shaders and is just linked again.
+//
 // @param pipeline : Info to build a graphics pipeline
 // @param isCacheHash : TRUE if the hash is used by shader cache
 // @param isRelocatableShader : TRUE if we are building relocatable shader
@@ -869,10 +873,19 @@ MetroHash::Hash PipelineDumper::generateHashForGraphicsPipeline(const GraphicsPi
   }
 
 #if LLPC_CLIENT_INTERFACE_MAJOR_VERSION >= 41
-  updateHashForResourceMappingInfo(&pipeline->resourceMapping, &hasher, isRelocatableShader);
+  // The user data nodes are shared by all stages, so they are pruned to the descriptors referenced by any stage.
+  const PipelineShaderInfo *shaderInfos[] = {&pipeline->vs, &pipeline->tcs, &pipeline->tes, &pipeline->gs,
+                                             &pipeline->fs};
+  DescriptorBindingSet referencedBindings;
+  bool pruneUserDataNodes = collectReferencedDescriptorBindings(shaderInfos, ShaderStageGfxCount, &pipeline->options,
+                                                                &referencedBindings);
+  updateHashForResourceMappingInfo(&pipeline->resourceMapping, &hasher, isRelocatableShader,
+                                   pruneUserDataNodes ? &referencedBindings : nullptr);
 #endif
 
-  hasher.Update(pipeline->iaState.deviceIndex);
+  // The device index is a relocation in a relocatable shader.
+  if (!isRelocatableShader)
+    hasher.Update(pipeline->iaState.deviceIndex);
 
   // Relocatable shaders force an unlinked compilation.
   hasher.Update(pipeline->unlinked || isRelocatableShader);
@@ -905,10 +918,17 @@ MetroHash::Hash PipelineDumper::generateHashForComputePipeline(const ComputePipe
   updateHashForPipelineShaderInfo(ShaderStageCompute, &pipeline->cs, isCacheHash, &hasher, isRelocatableShader);
 
 #if LLPC_CLIENT_INTERFACE_MAJOR_VERSION >= 41
-  updateHashForResourceMappingInfo(&pipeline->resourceMapping, &hasher, isRelocatableShader);
+  const PipelineShaderInfo *shaderInfo = &pipeline->cs;
+  DescriptorBindingSet referencedBindings;
+  bool pruneUserDataNodes =
+      collectReferencedDescriptorBindings(&shaderInfo, 1, &pipeline->options, &referencedBindings);
+  updateHashForResourceMappingInfo(&pipeline->resourceMapping, &hasher, isRelocatableShader,
+                                   pruneUserDataNodes ? &referencedBindings : nullptr);
 #endif
 
-  hasher.Update(pipeline->deviceIndex);
+  // The device index is a relocation in a relocatable shader.
+  if (!isRelocatableShader)
+    hasher.Update(pipeline->deviceIndex);
   hasher.Update(pipeline->options.includeDisassembly);
   hasher.Update(pipeline->options.scalarBlockLayout);
   hasher.Update(pipeline->options.includeIr);
@@ -1065,8 +1085,9 @@ void PipelineDumper::updateHashForFragmentState(const GraphicsPipelineBuildInfo
     hasher->Update(cbState->alphaToCoverageEnable);
     hasher->Update(cbState->dualSourceBlendEnable);
     for (unsigned i = 0; i < MaxColorTargets; ++i) {
+      // The channel write mask is applied by the hardware and never reaches the compiler, so it is not hashed, and
+      // pipelines that differ only in it share a hash.
       if (cbState->target[i].format != VK_FORMAT_UNDEFINED) {
-        hasher->Update(cbState->target[i].channelWriteMask);
         hasher->Update(cbState->target[i].blendEnable);
         hasher->Update(cbState->target[i].blendSrcAlphaToColor);
         hasher->Update(cbState->target[i].format);
@@ -1180,15 +1201,35 @@ void PipelineDumper::updateHashForPipelineShaderInfo(ShaderStage stage, const Pi
 // =====================================================================================================================
 // Updates hash code context for resource node and static descriptor value data.
 //
+// If the descriptors the shaders reference are given, the descriptors in descriptor tables and the static descriptor
+// values that no shader references are left out, as they cannot affect the compiled pipeline. The root nodes are all
+// kept, as they lay out the user data.
+//
 // @param resourceMapping : Pipeline resource mapping data
 // @param [in,out] hasher : Haher to generate hash code
 // @param isRelocatableShader : TRUE if we are building relocatable shader
+// @param referencedBindings : Descriptors the shaders of the pipeline reference, or nullptr to hash all of them
 void PipelineDumper::updateHashForResourceMappingInfo(const ResourceMappingData* pResourceMapping,
-                                                      MetroHash64 *hasher, bool isRelocatableShader) {
-  hasher->Update(pResourceMapping->staticDescriptorValueCount);
-  if (pResourceMapping->staticDescriptorValueCount > 0) {
+                                                      MetroHash64 *hasher, bool isRelocatableShader,
+                                                      const DescriptorBindingSet *referencedBindings) {
+  // A relocatable shader is compiled without the user data nodes and static descriptor values, which are only used
+  // when linking it.
+  if (isRelocatableShader)
+    return;
+
+  unsigned staticDescriptorValueCount = 0;
+  for (unsigned i = 0; i < pResourceMapping->staticDescriptorValueCount; ++i) {
+    auto staticDescriptorValue = &pResourceMapping->pStaticDescriptorValues[i];
+    if (isReferencedDescriptor(staticDescriptorValue->set, staticDescriptorValue->binding, referencedBindings))
+      ++staticDescriptorValueCount;
+  }
+
+  hasher->Update(staticDescriptorValueCount);
+  if (staticDescriptorValueCount > 0) {
       for (unsigned i = 0; i < pResourceMapping->staticDescriptorValueCount; ++i) {
           auto staticDescriptorValue = &pResourceMapping->pStaticDescriptorValues[i];
+          if (!isReferencedDescriptor(staticDescriptorValue->set, staticDescriptorValue->binding, referencedBindings))
+            continue;
           hasher->Update(staticDescriptorValue->visibility);
           hasher->Update(staticDescriptorValue->type);
           hasher->Update(staticDescriptorValue->set);
@@ -1208,19 +1249,55 @@ void PipelineDumper::updateHashForResourceMappingInfo(const ResourceMappingData*
       }
   }
 
-  if (!isRelocatableShader) {
-    hasher->Update(pResourceMapping->userDataNodeCount);
-    if (pResourceMapping->userDataNodeCount > 0) {
-      for (unsigned i = 0; i < pResourceMapping->userDataNodeCount; ++i) {
-        auto userDataNode = &pResourceMapping->pUserDataNodes[i];
-        hasher->Update(userDataNode->visibility);
-        updateHashForResourceMappingNode(&userDataNode->node, true, hasher);
-      }
+  hasher->Update(pResourceMapping->userDataNodeCount);
+  if (pResourceMapping->userDataNodeCount > 0) {
+    for (unsigned i = 0; i < pResourceMapping->userDataNodeCount; ++i) {
+      auto userDataNode = &pResourceMapping->pUserDataNodes[i];
+      hasher->Update(userDataNode->visibility);
+      updateHashForResourceMappingNode(&userDataNode->node, true, hasher, referencedBindings);
     }
   }
 }
 #endif
 
+// =====================================================================================================================
+// Collects the descriptors that the shaders of a pipeline can reference, from the set and binding decorations of their
+// SPIR-V. Returns false if that cannot be told for the pipeline, in which case all descriptors must be hashed: a module
+// is not SPIR-V (such as a pre-lowered one), or the ELF includes the LLVM IR, which records all user data nodes.
+//
+// @param shaderInfos : Shader info of each stage of the pipeline
+// @param stageCount : Number of entries in shaderInfos
+// @param options : Pipeline options
+// @param [out] referencedBindings : Descriptors the shaders reference
+bool PipelineDumper::collectReferencedDescriptorBindings(const PipelineShaderInfo *const *shaderInfos,
+                                                         unsigned stageCount, const PipelineOptions *options,
+                                                         DescriptorBindingSet *referencedBindings) {
+  if (options->includeIr)
+    return false;
+
+  for (unsigned stage = 0; stage < stageCount; ++stage) {
+    const ShaderModuleData *moduleData = reinterpret_cast<const ShaderModuleData *>(shaderInfos[stage]->pModuleData);
+    if (!moduleData)
+      continue;
+    if (moduleData->binType != BinaryType::Spirv ||
+        !collectDescriptorBindingsFromSpirvBinary(&moduleData->binCode, referencedBindings))
+      return false;
+  }
+  return true;
+}
+
+// =====================================================================================================================
+// Checks whether a descriptor may be referenced by the shaders of the pipeline. Descriptors of the internal descriptor
+// set are referenced by the compiler itself, so they are always kept.
+//
+// @param set : Descriptor set of the descriptor
+// @param binding : Binding of the descriptor
+// @param referencedBindings : Descriptors the shaders reference, or nullptr if that is not known
+bool PipelineDumper::isReferencedDescriptor(unsigned set, unsigned binding,
+                                            const DescriptorBindingSet *referencedBindings) {
+  return !referencedBindings || set == InternalDescriptorSetId || referencedBindings->count({set, binding}) != 0;
+}
+
 // =====================================================================================================================
 // Updates hash code context for resource mapping node.
 //
@@ -1229,8 +1306,10 @@ void PipelineDumper::updateHashForResourceMappingInfo(const ResourceMappingData*
 // @param userDataNode : Resource mapping node
 // @param isRootNode : TRUE if the node is in root level
 // @param [in/out] hasher : Haher to generate hash code
+// @param referencedBindings : Descriptors the shaders reference, or nullptr to hash all nodes of descriptor tables
 void PipelineDumper::updateHashForResourceMappingNode(const ResourceMappingNode *userDataNode, bool isRootNode,
-                                                      MetroHash64 *hasher) {
+                                                      MetroHash64 *hasher,
+                                                      const DescriptorBindingSet *referencedBindings) {
   hasher->Update(userDataNode->type);
   hasher->Update(userDataNode->sizeInDwords);
   hasher->Update(userDataNode->offsetInDwords);
@@ -1247,8 +1326,30 @@ void PipelineDumper::updateHashForResourceMappingNode(const ResourceMappingNode
     break;
   }
   case ResourceMappingNodeType::DescriptorTableVaPtr: {
-    for (unsigned i = 0; i < userDataNode->tablePtr.nodeCount; ++i)
-      updateHashForResourceMappingNode(&userDataNode->tablePtr.pNext[i], false, hasher);
+    if (!referencedBindings) {
+      for (unsigned i = 0; i < userDataNode->tablePtr.nodeCount; ++i)
+        updateHashForResourceMappingNode(&userDataNode->tablePtr.pNext[i], false, hasher);
+      break;
+    }
+
+    // The set of the first node tells the middle-end which descriptor set the table holds, so it is kept even if
+    // that node is pruned.
+    const ResourceMappingNode *innerNodes = userDataNode->tablePtr.pNext;
+    unsigned nodeCount = userDataNode->tablePtr.nodeCount;
+    hasher->Update(nodeCount != 0);
+    if (nodeCount != 0)
+      hasher->Update(innerNodes[0].srdRange.set);
+
+    unsigned referencedNodeCount = 0;
+    for (unsigned i = 0; i < nodeCount; ++i) {
+      if (isReferencedDescriptor(innerNodes[i].srdRange.set, innerNodes[i].srdRange.binding, referencedBindings))
+        ++referencedNodeCount;
+    }
+    hasher->Update(referencedNodeCount);
+    for (unsigned i = 0; i < nodeCount; ++i) {
+      if (isReferencedDescriptor(innerNodes[i].srdRange.set, innerNodes[i].srdRange.binding, referencedBindings))
+        updateHashForResourceMappingNode(&innerNodes[i], false, hasher);
+    }
     break;
   }
   case ResourceMappingNodeType::IndirectUserDataVaPtr: {
@@ -32,6 +32,7 @@
 
 #include "vkgcDefs.h"
 #include "vkgcMetroHash.h"
+#include "vkgcUtil.h"
 #include <fstream>
 
 namespace Vkgc {
@@ -79,7 +80,8 @@ public:
 
 #if LLPC_CLIENT_INTERFACE_MAJOR_VERSION >= 41
   static void updateHashForResourceMappingInfo(const ResourceMappingData* pResourceMapping,
-                                               MetroHash64 *hasher, bool isRelocatableShader);
+                                               MetroHash64 *hasher, bool isRelocatableShader,
+                                               const DescriptorBindingSet *referencedBindings = nullptr);
 #endif
 
   static void updateHashForVertexInputState(const VkPipelineVertexInputStateCreateInfo *vertexInput,
@@ -125,7 +127,12 @@ private:
   static void dumpPipelineOptions(const PipelineOptions *options, std::ostream &dumpFile);
 
   static void updateHashForResourceMappingNode(const ResourceMappingNode *userDataNode, bool isRootNode,
-                                               MetroHash64 *hasher);
+                                               MetroHash64 *hasher,
+                                               const DescriptorBindingSet *referencedBindings = nullptr);
+  static bool collectReferencedDescriptorBindings(const PipelineShaderInfo *const *shaderInfos, unsigned stageCount,
+                                                  const PipelineOptions *options,
+                                                  DescriptorBindingSet *referencedBindings);
+  static bool isReferencedDescriptor(unsigned set, unsigned binding, const DescriptorBindingSet *referencedBindings);
 };
 
 } // namespace Vkgc
@@ -31,6 +31,7 @@
 #include "vkgcUtil.h"
 #include "spirv.hpp"
 #include "vkgcElfReader.h"
+#include <map>
 #include <sys/stat.h>
 
 #define DEBUG_TYPE "vkgc-util"
@@ -199,4 +200,60 @@ const char *getEntryPointNameFromSpirvBinary(const BinaryData *spvBin) {
   return entryName;
 }
 
+// =====================================================================================================================
+// Collects the descriptor (set, binding) pairs decorated on any object of the SPIR-V binary. That is a superset of the
+// descriptors that any entry-point of the module can reference. A missing set or binding decoration counts as 0, as it
+// does in the SPIR-V reader.
+//
+// Returns false if the bindings cannot be told from the decorations alone, because the binary is not valid SPIR-V or
+// applies decorations through decoration groups.
+//
+// @param spvBin : SPIR-V binary
+// @param [out] bindings : Descriptor (set, binding) pairs are added to this set
+bool collectDescriptorBindingsFromSpirvBinary(const BinaryData *spvBin, DescriptorBindingSet *bindings) {
+  if (!isSpirvBinary(spvBin))
+    return false;
+
+  const unsigned *code = reinterpret_cast<const unsigned *>(spvBin->pCode);
+  const unsigned *end = code + spvBin->codeSize / sizeof(unsigned);
+
+  // Skip SPIR-V header
+  const unsigned *codePos = code + sizeof(SpirvHeader) / sizeof(unsigned);
+
+  std::map<unsigned, std::pair<unsigned, unsigned>> decoratedBindings;
+  while (codePos < end) {
+    unsigned opCode = (codePos[0] & OpCodeMask);
+    unsigned wordCount = (codePos[0] >> WordCountShift);
+
+    if (wordCount == 0 || codePos + wordCount > end)
+      return false;
+
+    if (opCode == OpDecorationGroup || opCode == OpGroupDecorate)
+      return false;
+
+    if (opCode == OpDecorate && wordCount >= 4) {
+      if (codePos[2] == DecorationDescriptorSet)
+        decoratedBindings[codePos[1]].first = codePos[3];
+      else if (codePos[2] == DecorationBinding)
+        decoratedBindings[codePos[1]].second = codePos[3];
+    }
+
+    // A resource variable with no decorations at all is at set 0, binding 0.
+    if (opCode == OpVariable && wordCount >= 4 &&
+        (codePos[3] == StorageClassUniformConstant || codePos[3] == StorageClassUniform ||
+         codePos[3] == StorageClassStorageBuffer))
+      decoratedBindings[codePos[2]];
+
+    // All annotations are before "OpFunction"
+    if (opCode == OpFunction)
+      break;
+
+    codePos += wordCount;
+  }
+
+  for (const auto &decoratedBinding : decoratedBindings)
+    bindings->insert(decoratedBinding.second);
+  return true;
+}
+
 } // namespace Vkgc
@@ -31,6 +31,8 @@
 #pragma once
 
 #include "vkgcDefs.h"
+#include <set>
+#include <utility>
 
 namespace Vkgc {
 
@@ -46,6 +48,9 @@ struct SpirvHeader {
 // Invalid value
 static const unsigned InvalidValue = ~0u;
 
+// Set of descriptor (set, binding) pairs
+typedef std::set<std::pair<unsigned, unsigned>> DescriptorBindingSet;
+
 // Gets name string of the abbreviation for the specified shader stage.
 const char *getShaderStageAbbreviation(ShaderStage shaderStage, bool upper = false);
 
@@ -61,6 +66,9 @@ bool isSpirvBinary(const BinaryData *shaderBin);
 // Gets the entry-point name from the SPIR-V binary
 const char *getEntryPointNameFromSpirvBinary(const BinaryData *spvBin);
 
+// Collects the descriptor bindings decorated in the SPIR-V binary
+bool collectDescriptorBindingsFromSpirvBinary(const BinaryData *spvBin, DescriptorBindingSet *bindings);
+
 // =====================================================================================================================
 // Increments a pointer by nBytes by first casting it to a uint8_t*.
 //